@@ -0,0 +1,480 @@
+/**
+ * Class        AbcParser.cpp
+ *
+ * Purpose      Implements an incremental parser for tunes in ABC notation. Each call
+ *              of nextNote() advances through the text until the next note or rest
+ *              is found. Note lengths are handled in 192ths of a whole note so that
+ *              triplets are exact, and rounded to the 64ths of the musicNote.
+ *
+ * References   https://abcnotation.com/wiki/abc:standard:v2.1
+ */
+#include "AbcParser.h"
+
+#define NO_ACC 127
+
+static const uint8_t  semitone[7]   = { 0, 2, 4, 5, 7, 9, 11 };   // C D E F G A B
+static const int8_t   fifths[7]     = { 0, 2, 4, -1, 1, 3, 5 };   // position of C..B in the circle of fifths
+static const uint8_t  sharpOrder[7] = { 3, 0, 4, 1, 5, 2, 6 };    // F C G D A E B
+static const uint8_t  flatOrder[7]  = { 6, 2, 5, 1, 4, 0, 3 };    // B E A D G C F
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+static bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static bool isEndOfField(char c) { return c == '\0' || c == '\n' || c == '\r' || c == ']' || c == '%'; }
+static char toLower(char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; }
+
+static int letterIndex(char c)
+{
+    c = toLower(c);
+    return (c >= 'c' && c <= 'g') ? c - 'c' : (c == 'a' || c == 'b') ? c - 'a' + 5 : -1;
+}
+
+static uint32_t parseNumber(const char *&p)
+{
+    uint32_t n = 0;
+    while (isDigit(*p)) n = 10 * n + (*p++ - '0');
+    return n;
+}
+
+static void skipSpaces(const char *&p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+}
+
+/**
+ * Set the text of the tune and rewind
+ */
+void AbcParser::setText(const char *abc)
+{
+    _text = abc;
+    rewind();
+}
+
+/**
+ * Reset all state to the defaults and read the header
+ * up to and including the K: field
+ */
+void AbcParser::rewind()
+{
+    _pos        = _text;
+    _pass       = 1;
+    _lineStart  = true;
+    _unitSet    = false;
+    _tempo      = 0;
+    _unit       = 24;
+    _barLength  = 192;
+    _time       = 0;
+    _brokenNum  = _brokenDen = 1;
+    _tupletLeft = 0;
+    _tupletRest = 0;
+    memset(_keyAcc, 0, sizeof(_keyAcc));
+    clearBarAccidentals();
+    if (_text == nullptr) return;
+
+    // header lines look like "X:1", the body starts after the K: field
+    while ((isAlpha(_pos[0]) && _pos[1] == ':') || _pos[0] == '%')
+    {
+        char field = _pos[0];
+        if (field != '%') parseField(field, _pos + 2);
+        while (*_pos != '\0' && *_pos != '\n') _pos++;
+        if (*_pos == '\n') _pos++;
+        if (field == 'K') break;
+    }
+    _repeatStart = _pos;  // a :| without |: repeats from the beginning
+}
+
+/**
+ * Forget the accidentals of the previous bar
+ */
+void AbcParser::clearBarAccidentals()
+{
+    memset(_barAcc, NO_ACC, sizeof(_barAcc));
+}
+
+/**
+ * Interpret an information field, p points to the text after the colon
+ */
+void AbcParser::parseField(char field, const char *p)
+{
+    skipSpaces(p);
+    switch(field)
+    {
+        case 'L': parseUnitLength(p); break;
+        case 'M': parseMeter(p);      break;
+        case 'Q': parseTempo(p);      break;
+        case 'K': parseKey(p);        break;
+        default:                      break;  // X: T: C: W: w: etc. are ignored
+    }
+}
+
+/**
+ * L:1/8 sets the unit note length
+ */
+void AbcParser::parseUnitLength(const char *p)
+{
+    uint32_t num = parseNumber(p);
+    uint32_t den = (*p == '/') ? (++p, parseNumber(p)) : 1;
+    if (num == 0 || den == 0) return;
+    _unit    = 192 * num / den;
+    _unitSet = true;
+}
+
+/**
+ * M:6/8, M:C, M:C| or M:2+3/8 sets the length of a bar
+ * and the unit note length when L: was not given
+ */
+void AbcParser::parseMeter(const char *p)
+{
+    uint32_t num = 4, den = 4;
+
+    if (*p == 'C')
+    {
+        if (p[1] == '|') num = den = 2;
+    }
+    else if (isDigit(*p))
+    {
+        num = parseNumber(p);
+        while (*p == '+') { p++; num += parseNumber(p); }
+        den = (*p == '/') ? (++p, parseNumber(p)) : 1;
+        if (den == 0) return;
+    }
+    _barLength = 192 * num / den;
+    if (! _unitSet) _unit = (4 * num < 3 * den) ? 12 : 24;  // below 3/4 the unit is a 16th
+}
+
+/**
+ * Q:1/4=120, Q:3/8=60 or Q:120 (in units of L:) sets the tempo
+ * which is converted to quarter notes per minute
+ */
+void AbcParser::parseTempo(const char *p)
+{
+    uint32_t beat = 0;  // length of the beat in 192ths
+    const char *eq = p;
+
+    while (! isEndOfField(*eq) && *eq != '=') eq++;
+    if (*eq == '=')
+    {
+        // sum up the beat lengths in front of '=', quoted text is ignored
+        bool quoted = false;
+        while (p < eq)
+        {
+            if (*p == '"') quoted = ! quoted;
+            if (! quoted && isDigit(*p))
+            {
+                uint32_t num = parseNumber(p);
+                uint32_t den = (*p == '/') ? (++p, parseNumber(p)) : 1;
+                if (den != 0) beat += 192 * num / den;
+            }
+            else p++;
+        }
+        p = eq + 1;
+    }
+    else beat = _unit;  // Q:120 counts unit note lengths
+    skipSpaces(p);
+    uint32_t bpm = parseNumber(p);
+    if (bpm == 0 || beat == 0) return;
+    _tempo = (int)(bpm * beat / 48);  // 48/192 is a quarter note
+}
+
+/**
+ * K:G, K:Bb, K:F#m, K:Ddor, K:D ^c _b sets the key signature.
+ * The mode shifts the number of sharps relative to the major key
+ */
+void AbcParser::parseKey(const char *p)
+{
+    memset(_keyAcc, 0, sizeof(_keyAcc));
+    if (*p < 'A' || *p > 'G') return;  // K:none or K:HP
+
+    int sharps = fifths[letterIndex(*p++)];
+    if (*p == '#') { sharps += 7; p++; }
+    else if (*p == 'b') { sharps -= 7; p++; }
+    skipSpaces(p);
+
+    char mode[3] = { toLower(p[0]), isAlpha(p[0]) ? toLower(p[1]) : '\0', isAlpha(p[0]) && isAlpha(p[1]) ? toLower(p[2]) : '\0' };
+    if      (mode[0] == 'm' && mode[1] == 'i' && mode[2] == 'x') sharps -= 1;
+    else if (mode[0] == 'm' && mode[1] == 'a')                   sharps += 0;  // major
+    else if (mode[0] == 'm')                                     sharps -= 3;  // m, min, minor
+    else if (mode[0] == 'a' && mode[1] == 'e')                   sharps -= 3;  // aeolian
+    else if (mode[0] == 'd' && mode[1] == 'o')                   sharps -= 2;  // dorian
+    else if (mode[0] == 'p' && mode[1] == 'h')                   sharps -= 4;  // phrygian
+    else if (mode[0] == 'l' && mode[1] == 'y')                   sharps += 1;  // lydian
+    else if (mode[0] == 'l' && mode[1] == 'o')                   sharps -= 5;  // locrian
+    sharps = constrain(sharps, -7, 7);
+
+    for (int i = 0; i < sharps; i++)  _keyAcc[sharpOrder[i]] =  1;
+    for (int i = 0; i < -sharps; i++) _keyAcc[flatOrder[i]]  = -1;
+
+    // explicit accidentals like K:D ^c _b =f are whole words, clef=bass is not one
+    while (! isEndOfField(*p))
+    {
+        skipSpaces(p);
+        const char *word = p;
+        while (! isEndOfField(*p) && *p != ' ' && *p != '\t') p++;
+        int acc = (*word == '^') ? 1 : (*word == '_') ? -1 : (*word == '=') ? 0 : NO_ACC;
+        if (acc != NO_ACC && p - word == 2 && letterIndex(word[1]) >= 0) _keyAcc[letterIndex(word[1])] = acc;
+    }
+}
+
+/**
+ * Read a length multiplier like 2, 3/2, /2, / or // and apply it to len
+ */
+uint32_t AbcParser::parseLength(uint32_t len)
+{
+    uint32_t num = isDigit(*_pos) ? parseNumber(_pos) : 1;
+    uint32_t den = 1;
+    while (*_pos == '/')
+    {
+        _pos++;
+        den *= isDigit(*_pos) ? parseNumber(_pos) : 2;
+    }
+    return (den == 0) ? len : len * num / den;
+}
+
+/**
+ * Read a note like ^^c'3/2 at the current position.
+ * Returns false if there is no note. pitch is returned as 0..11
+ */
+bool AbcParser::parseNote(uint32_t &len, int &pitch, int &octave)
+{
+    const char *p = _pos;
+    int acc = NO_ACC;
+
+    while (*p == '^' || *p == '_' || *p == '=')
+    {
+        int step = (*p == '^') ? 1 : (*p == '_') ? -1 : 0;
+        acc = (acc == NO_ACC || step == 0) ? step : acc + step;
+        p++;
+    }
+    int letter = letterIndex(*p);
+    if (letter < 0) return false;
+
+    octave = (*p >= 'a') ? 5 : 4;
+    p++;
+    while (*p == '\'' || *p == ',') octave += (*p++ == '\'') ? 1 : -1;
+    octave = constrain(octave, 0, 8);
+
+    if (acc != NO_ACC) _barAcc[octave][letter] = acc;  // valid until the end of the bar
+    else acc = (_barAcc[octave][letter] != NO_ACC) ? _barAcc[octave][letter] : _keyAcc[letter];
+
+    pitch = semitone[letter] + acc;
+    if (pitch < 0)   { pitch += 12; octave--; }
+    if (pitch >= 12) { pitch -= 12; octave++; }
+
+    _pos = p;
+    len = parseLength(_unit);
+    return true;
+}
+
+/**
+ * Handle a bar line at the current position, which
+ * may start or end a repeat or start an ending
+ */
+void AbcParser::parseBar()
+{
+    int  colons      = 0;
+    bool bar         = false;
+    bool repeatStart = false;
+
+    while (*_pos == ':') { _pos++; colons++; }
+    while (*_pos == '|' || *_pos == '[' || *_pos == ']')
+    {
+        if (*_pos == '[' && ! isDigit(_pos[1]) && _pos[1] != '|') break;  // a chord or inline field follows
+        _pos++;
+        bar = true;
+    }
+    if (*_pos == ':')
+    {
+        while (*_pos == ':') _pos++;
+        repeatStart = true;
+    }
+    if (colons >= 2 && ! bar) repeatStart = true;  // :: ends and starts a repeat
+    bool repeatEnd = (colons > 0);
+    clearBarAccidentals();
+
+    if (repeatEnd && _pass == 1)
+    {
+        _pos  = _repeatStart;  // play the section a second time
+        _pass = 2;
+        return;
+    }
+    if (repeatEnd || repeatStart)
+    {
+        _repeatStart = _pos;
+        _pass = 1;
+    }
+    if (isDigit(*_pos))
+    {
+        // first or second ending
+        if (*_pos == '1' && _pass == 2) skipToSecondEnding();
+        else while (isDigit(*_pos) || *_pos == ',' || *_pos == '-') _pos++;
+    }
+}
+
+/**
+ * On the second pass skip the first ending up to the bar line starting
+ * the second ending, e.g. from |1 to :|2
+ */
+void AbcParser::skipToSecondEnding()
+{
+    while (*_pos != '\0')
+    {
+        if (*_pos == ':' && (_pos[1] == '|' || _pos[1] == ':'))
+        {
+            while (*_pos == ':' || *_pos == '|' || *_pos == ']' || *_pos == '[' || *_pos == ' ') _pos++;
+            while (isDigit(*_pos) || *_pos == ',' || *_pos == '-') _pos++;
+            break;
+        }
+        _pos++;
+    }
+    _repeatStart = _pos;  // the repeat is done
+    _pass = 1;
+    clearBarAccidentals();
+}
+
+/**
+ * Convert len from 192ths to 64ths, carrying the rounding error into the next note
+ */
+bool AbcParser::emit(musicNote &n, int pitch, int octave, uint32_t len)
+{
+    uint32_t len64 = (_time + len) / 3 - _time / 3;
+    _time += len;
+    if (len64 == 0) return false;
+    n.note   = (note_t)pitch;
+    n.octave = (uint8_t)constrain(octave, 0, 8);
+    n.value  = (N_LEN)len64;
+    return true;
+}
+
+/**
+ * Deliver the next note or rest of the tune.
+ * Returns false at the end of the tune, which is the end of the text,
+ * an empty line or the X: field of the next tune
+ */
+bool AbcParser::nextNote(musicNote &n)
+{
+    if (_pos == nullptr) return false;
+
+    while (*_pos != '\0')
+    {
+        char c = *_pos;
+
+        if (_lineStart && isAlpha(c) && _pos[1] == ':')
+        {
+            if (c == 'X') return false;
+            parseField(c, _pos + 2);
+            while (*_pos != '\0' && *_pos != '\n') _pos++;
+            continue;
+        }
+        _lineStart = false;
+
+        int pitch  = REST;
+        int octave = 4;
+        uint32_t len = 0;
+        bool chord = false;
+
+        switch(c)
+        {
+            case '\n':
+                _pos++;
+                _lineStart = true;
+                skipSpaces(_pos);
+                if (*_pos == '\n' || *_pos == '\r') return false;  // an empty line ends the tune
+                continue;
+            case '%':  // comment
+                while (*_pos != '\0' && *_pos != '\n') _pos++;
+                continue;
+            case '"':  // chord symbol or annotation
+            case '!':  // decoration !trill!
+            case '+':  // decoration +trill+
+            case '{':  // grace notes
+            {
+                char end = (c == '{') ? '}' : c;
+                do _pos++; while (*_pos != '\0' && *_pos != end && *_pos != '\n');
+                if (*_pos == end) _pos++;
+                continue;
+            }
+            case '(':
+                _pos++;
+                if (isDigit(*_pos))
+                {
+                    static const uint8_t tupletQ[10] = { 0, 1, 3, 2, 3, 2, 2, 2, 3, 2 };
+                    _tupletP    = (uint8_t)parseNumber(_pos);
+                    _tupletQ    = (_tupletP < 10) ? tupletQ[_tupletP] : 2;
+                    _tupletLeft = _tupletP;
+                    _tupletRest = 0;
+                    if (*_pos == ':') { _pos++; if (isDigit(*_pos)) _tupletQ    = (uint8_t)parseNumber(_pos); }
+                    if (*_pos == ':') { _pos++; if (isDigit(*_pos)) _tupletLeft = (uint8_t)parseNumber(_pos); }
+                    if (_tupletP == 0) _tupletLeft = 0;
+                }
+                continue;  // otherwise a slur
+            case '[':
+                if (isAlpha(_pos[1]) && _pos[2] == ':')  // inline field [K:G]
+                {
+                    parseField(_pos[1], _pos + 3);
+                    while (*_pos != '\0' && *_pos != ']' && *_pos != '\n') _pos++;
+                    if (*_pos == ']') _pos++;
+                    continue;
+                }
+                if (isDigit(_pos[1]) || _pos[1] == '|')
+                {
+                    parseBar();
+                    continue;
+                }
+                _pos++;
+                chord = true;
+                break;
+            case '|':
+            case ':':
+                parseBar();
+                continue;
+            case 'z':
+            case 'x':
+                _pos++;
+                len = parseLength(_unit);
+                break;
+            case 'Z':  // multi measure rest
+                _pos++;
+                len = _barLength * (isDigit(*_pos) ? parseNumber(_pos) : 1);
+                break;
+            default:
+                break;
+        }
+
+        if (len == 0 && ! parseNote(len, pitch, octave))
+        {
+            _pos++;  // spaces, ties, slurs, decorations like ~ . and everything unknown
+            continue;
+        }
+        if (chord)
+        {
+            // only the first note of a chord is played, its length may be multiplied after ]
+            while (*_pos != '\0' && *_pos != ']' && *_pos != '\n') _pos++;
+            if (*_pos == ']') _pos++;
+            len = parseLength(len);
+        }
+
+        // broken rhythm and tuplets
+        len = len * _brokenNum / _brokenDen;
+        _brokenNum = _brokenDen = 1;
+        const char *p = _pos;
+        skipSpaces(p);
+        if (*p == '>' || *p == '<')
+        {
+            char dir = *p;
+            uint8_t den = 1;
+            while (*p == dir) { den *= 2; p++; }
+            if (dir == '>') { len = len * (2 * den - 1) / den; _brokenDen = den; }
+            else            { len = len / den; _brokenNum = 2 * den - 1; _brokenDen = den; }
+            _pos = p;
+        }
+        if (_tupletLeft > 0)
+        {
+            uint32_t scaled = len * _tupletQ + _tupletRest;
+            len         = scaled / _tupletP;
+            _tupletRest = scaled % _tupletP;
+            _tupletLeft--;
+        }
+
+        if (emit(n, pitch, octave, len)) return true;
+    }
+    return false;
+}
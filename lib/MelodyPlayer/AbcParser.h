@@ -0,0 +1,65 @@
+/**
+ * Header       AbcParser.h
+ *
+ * Purpose      Declaration of the class AbcParser which reads a tune written in ABC
+ *              notation (https://abcnotation.com) and delivers its notes one by one
+ *              to the MelodyPlayer. The text is parsed while playing, only the state
+ *              needed for the current note is kept, nothing is allocated.
+ *
+ *              Supported are the header fields L: (unit note length), M: (meter),
+ *              Q: (tempo) and K: (key with mode and explicit accidentals), also as
+ *              inline fields [K:...]. In the tune body notes, rests (z x Z),
+ *              accidentals, broken rhythm (> <), tuplets, chords (the first note is
+ *              played), repeats |: :| :: and first and second endings |1 :|2 [1 [2.
+ *              Decorations, grace notes, chord symbols, slurs, ties and lyrics are skipped.
+ *
+ * Constructor
+ * arguments    abc         NUL terminated text of the tune, must stay valid while playing
+ */
+#ifndef _ABCPARSER_H_
+#define _ABCPARSER_H_
+#include "NoteSource.h"
+
+class AbcParser : public NoteSource
+{
+    public:
+        AbcParser(const char *abc = nullptr) { setText(abc); };
+        void setText(const char *abc);
+        bool nextNote(musicNote &n) override;
+        void rewind() override;
+        int  tempo() override { return _tempo; };
+        int  barLength() override { return _barLength / 3; };
+
+    private:
+        void parseField(char field, const char *p);
+        void parseUnitLength(const char *p);
+        void parseMeter(const char *p);
+        void parseTempo(const char *p);
+        void parseKey(const char *p);
+        uint32_t parseLength(uint32_t len);
+        bool parseNote(uint32_t &len, int &pitch, int &octave);
+        void parseBar();
+        void skipToSecondEnding();
+        void clearBarAccidentals();
+        bool emit(musicNote &n, int pitch, int octave, uint32_t len);
+
+        const char *_text        = nullptr;
+        const char *_pos         = nullptr;
+        const char *_repeatStart = nullptr;
+        uint8_t  _pass       = 1;       // 1 = first, 2 = second pass through a repeated section
+        bool     _lineStart  = true;
+        bool     _unitSet    = false;   // L: given explicitly
+        int      _tempo      = 0;       // quarter notes per minute, 0 = not given
+        uint32_t _unit       = 24;      // unit note length in 192ths of a whole note
+        uint32_t _barLength  = 192;     // length of a bar in 192ths
+        uint32_t _time       = 0;       // position in 192ths, used to round lengths to 64ths without drift
+        uint8_t  _brokenNum  = 1;       // length factor for the note following > or <
+        uint8_t  _brokenDen  = 1;
+        uint8_t  _tupletP    = 0;       // p notes in the time of q
+        uint8_t  _tupletQ    = 0;
+        uint8_t  _tupletLeft = 0;       // notes left in the current tuplet
+        uint32_t _tupletRest = 0;       // remainder of len * q / p, carried so a tuplet has its exact length
+        int8_t   _keyAcc[7];            // semitones added to C D E F G A B by the key signature
+        int8_t   _barAcc[9][7];         // accidentals set in the current bar per octave and letter
+};
+#endif
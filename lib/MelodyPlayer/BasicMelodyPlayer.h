@@ -0,0 +1,714 @@
+/**
+ * Header       BasicMelodyPlayer.h
+ *
+ * Purpose      Declaration and implementation of the class template BasicMelodyPlayer,
+ *              a nonblocking melody player. You have to call playMelody() in the main 
+ *              loop of your program. 
+ *
+ *              The player is independent of the hardware. Time is taken from the Clock 
+ *              policy (see Clocks.h), the notes are played by the Output policy:
+ *
+ *              void begin()                                    set up the hardware
+ *              void setLevel(uint32_t volume, TIMBRE timbre)   volume 0..100 and timbre
+ *              void noteOn(note_t note, uint8_t octave, 
+ *                          uint32_t ms, uint32_t msDuration)   start a note (REST = silence)
+ *              void noteOff(uint32_t ms)                       stop the note
+ *
+ *              ms is the time of the event from the clock. Outputs are LedcOutput, 
+ *              DacOutput, WavOutput, NullOutput and RecordingOutput. The calls are 
+ *              resolved at compile time, there are no virtual functions.
+ *
+ *              Callbacks (see PlayerEvents.h) are called on note on and note off
+ *              (not for rests), at the start of each bar and at the end of the 
+ *              melody. A poll raises at most 3 events (bar, note on and melody 
+ *              end or note off), each costs at most PLAYER_CALLBACKS calls, or one
+ *              copy into the queue when the events are deferred.
+ *              play() returns a PlayHandle which tells when the melody is done, also to
+ *              other FreeRTOS tasks (see Completion.h). It and the Beats returned by 
+ *              beats() can be awaited by a Sequence (Sequence.h): their method poll() 
+ *              plays a step and returns true when done.
+ *              saveState() and restoreState() keep the position in a PlayerState, e.g.
+ *              in RTC memory to resume after deep sleep (see PlayerState.h).
+ *              With -DPLAYER_TRACE note on and note off are traced (see PlayerTrace.h).
+ *              MelodyPlayer (MelodyPlayer.h) is the player with ArduinoClock and LedcOutput.
+ *
+ *              The constructor does not touch the hardware, begin() sets up the output,
+ *              otherwise the first note does it.
+ *
+ * Constructor
+ * arguments    args        arguments of the constructor of the Output, e.g. pin and channel
+ */
+#ifndef _BASICMELODYPLAYER_H_
+#define _BASICMELODYPLAYER_H_
+#include <utility>
+#include "MelodyTypes.h"
+#include "NoteSource.h"
+#include "VolumeTaper.h"
+#include "PlayerEvents.h"
+#include "Completion.h"
+#include "PlayerTrace.h"
+#include "PlayerState.h"
+
+class TuningTable;
+class GlideEngine;
+class Lfo;
+
+template <class Clock, class Output>
+class BasicMelodyPlayer
+{
+    public:
+        /**
+         * Handle of a melody started with play(). It is done when the melody has
+         * ended or another melody has been set. poll() plays a step, so the handle
+         * can be awaited by a Sequence
+         */
+        class PlayHandle
+        {
+            public:
+                PlayHandle(BasicMelodyPlayer *player, uint32_t id) : _player(player), _id(id) {};
+                bool isDone() { return _player->_completion.isDone(_id); };
+                bool waitFor(uint32_t ms) { return _player->_completion.waitFor(_id, ms); };
+                void notify(void *task) { _player->_completion.notify(_id, task); };
+                bool poll()
+                {
+                    if (! isDone()) _player->playMelody(false);
+                    return isDone();
+                };
+                uint32_t id() { return _id; };
+
+            private:
+                BasicMelodyPlayer *_player;
+                uint32_t _id;
+        };
+
+        /**
+         * Awaitable returned by beats(), is done after n beats
+         */
+        class Beats
+        {
+            public:
+                Beats(BasicMelodyPlayer *player, uint32_t n) : _player(player), _left(n) {};
+                bool poll()
+                {
+                    if (_left == 0) return true;
+                    if (! _started)
+                    {
+                        _player->endNote();         // a sounding note of a melody ends
+                        _player->_started = false;  // start with a new beat
+                        _started = true;
+                    }
+                    bool wasStarted = _player->_started;
+                    _player->playBeats();
+                    if (wasStarted && ! _player->_started) _left--;  // a beat has passed
+                    return _left == 0;
+                };
+
+            private:
+                BasicMelodyPlayer *_player;
+                uint32_t _left;
+                bool     _started = false;
+        };
+
+        template <typename... Args>
+        BasicMelodyPlayer(Args&&... args) : _output(std::forward<Args>(args)...) {};
+        void begin();
+        bool begun() { return _begun; };
+        void setVolume(uint32_t volume);
+        void setTimbre(TIMBRE timbre);
+        void setTempo(TEMPO tempo);
+        void setTempo(int tempo);
+        int  getTempo() { return (int)_tempo; };
+        uint32_t getPosition() { return _position; };  // 64ths of the melody up to the end of the sounding note
+        uint32_t getPlayPosition();
+        uint16_t getBar() { return _bar; };
+        void setLegato(uint32_t msNoteGab);
+        uint32_t getLegato() { return _msNoteGap; };
+        void setMelody(musicNote m[], int len);
+        void setMelody(NoteSource &source);
+        void setRandomMode();
+        void setNormalMode();
+        void mute();
+        void playNote(musicNote n);
+        void playMelody(musicNote m[], int len, bool repeat = false);
+        void playMelody(bool repeat = false);
+        void playSource(NoteSource &source, bool repeat = false);
+        void playBeats();
+        void rearmNoteAfter(uint32_t msWait);
+        PlayHandle play(musicNote m[], int len);
+        PlayHandle play(NoteSource &source);
+        Beats      beats(uint32_t n) { return Beats(this, n); };
+        void saveState(PlayerState &state, uint16_t melodyId);
+        bool restoreState(const PlayerState &state);
+        void setBarLength(uint32_t len);
+        bool addCallback(PlayerCallback callback, void *arg = nullptr, uint8_t mask = EVENT_ALL);
+        void removeCallback(PlayerCallback callback, void *arg = nullptr);
+        void setDeferredEvents(bool deferred) { _deferred = deferred; };
+        int  dispatchEvents();
+        uint32_t lostEvents() { return _queue.lost(); };
+        Clock  &clock()  { return _clock; };
+        Output &output() { return _output; };
+
+        // Only for outputs which support them (LedcOutput)
+        void setTuning(TuningTable *tuning) { _output.setTuning(tuning); };
+        void setPortamento(GlideEngine *glide, uint32_t msPortamento) { _output.setPortamento(glide, msPortamento); };
+        void setLfo(Lfo *lfo) { _output.setLfo(lfo); };
+        bool playGlide(float from, float to, uint32_t ms, GLIDE curve = GLIDE::EXPONENTIAL, bool pingPong = false)
+        {
+            if (! _begun) begin();
+            return _output.glide(from, to, ms, curve, pingPong);
+        };
+        
+    private:
+        void startNote(const musicNote &n);
+        void endNote();
+        void endMelody();
+        void emit(PLAYER_EVENT type, const musicNote &n);
+        void deliver(const PlayerEvent &event);
+
+        Clock    _clock;
+        Output   _output;
+        uint32_t _volume      = 0; // 0..100
+        TIMBRE   _timbre      = TIMBRE::PULSE_50;
+        uint32_t _msStart     = 0;
+        uint32_t _msDuration  = 0; // length of the playing note in ms
+        uint32_t _msNoteGap   = 10;
+        uint32_t _msPrevious  = 0;
+        int      _noteCounter = 0;
+        bool     _begun       = false; // the output has been set up
+        bool     _started     = false;
+        bool     _beatOn      = false; // the click of playBeats() is sounding
+        bool     _beating     = false; // _started belongs to a beat, not to a note
+        bool     _notePlayed  = false;
+        bool     _random      = false;
+        bool     _haveNote    = false; // _sourceNote holds a note fetched from a NoteSource
+        int      _melodyLength;
+        TEMPO    _tempo = TEMPO::MODERATO;
+        musicNote *_melody = nullptr;    
+        NoteSource *_source = nullptr;
+        musicNote  _sourceNote;
+        musicNote  _note;                 // the sounding note
+        uint32_t   _barLength   = 64;     // length of a bar in 64ths, 0 = no bar events
+        uint32_t   _position    = 0;      // position in the melody in 64ths
+        uint16_t   _bar         = 0;      // number of the actual bar
+        bool       _ended       = false;  // MELODY_END has been sent
+        bool       _deferred    = false;  // events go into the queue
+        uint8_t    _nbrCallbacks = 0;
+        struct { PlayerCallback callback; void *arg; uint8_t mask; } _callback[PLAYER_CALLBACKS];
+        PlayerEventQueue _queue;
+        Completion _completion;
+};
+
+/**
+ * Set up the output (e.g. the ledc channel and its pin). The constructor does not 
+ * touch the hardware, so a global player costs nothing before setup(). Without 
+ * begin() the output is set up with the first note
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::begin()
+{
+    _output.begin();
+    _output.setLevel(_volume, _timbre);
+    _begun = true;
+}
+
+/**
+ * Set the perceived volume of the tone in the range 0..100
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setVolume(uint32_t volume)
+{
+    _volume = (volume < VOLUME_MAX) ? volume : VOLUME_MAX;
+    if (_begun) _output.setLevel(_volume, _timbre);
+}
+
+/**
+ * Set the timbre by the pulse width of the tone: 12.5%, 25% or 50%.
+ * The volume scales the pulse width, so both can be set independently.
+ * A playing note changes its timbre immediately
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setTimbre(TIMBRE timbre)
+{
+    _timbre = timbre;
+    if (_begun) _output.setLevel(_volume, _timbre);
+}
+
+/**
+ * Set the tempo to a predefined tempo
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setTempo(TEMPO tempo)
+{
+    _tempo = tempo;
+}
+
+/**
+ * Set the gap between played notes in ms (0..100)
+ * 0 means no gap --> legato
+ * Default value is 10 ms
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setLegato(uint32_t msNoteGap)
+{
+
+    _msNoteGap = (msNoteGap <= 100) ? msNoteGap : 100;
+}
+
+/**
+ * Set the tempo to n beats per minute
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setTempo(int nBeats)
+{
+    _tempo = (TEMPO)nBeats;
+}
+
+/**
+ * Set the melody to be played, a sounding note is stopped
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setMelody(musicNote m[], int len)
+{
+    if (_started) mute();
+    _melody = m;
+    _melodyLength = len;
+    _source = nullptr;
+    _haveNote = false;
+    _started  = false;
+    _noteCounter = 0;
+    _position = _bar = 0;
+    _ended  = false;
+    _completion.start();
+}
+
+/**
+ * Set a NoteSource (e.g. an AbcParser) as the melody to be played.
+ * The source is rewound and delivers its notes while playing, a sounding 
+ * note is stopped.
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setMelody(NoteSource &source)
+{
+    if (_started) mute();
+    _source = &source;
+    _source->rewind();
+    _haveNote = false;
+    _started  = false;
+    _position = _bar = 0;
+    _ended    = false;
+    _completion.start();
+}
+
+/**
+ * Start to play the melody once, playMelody() has to be called in the loop 
+ * (or the handle polled by a Sequence). The handle tells when it is done
+ */
+template <class Clock, class Output>
+typename BasicMelodyPlayer<Clock, Output>::PlayHandle BasicMelodyPlayer<Clock, Output>::play(musicNote m[], int len)
+{
+    setMelody(m, len);
+    return PlayHandle(this, _completion.id());
+}
+
+/**
+ * Start to play the notes of the source once
+ */
+template <class Clock, class Output>
+typename BasicMelodyPlayer<Clock, Output>::PlayHandle BasicMelodyPlayer<Clock, Output>::play(NoteSource &source)
+{
+    setMelody(source);
+    return PlayHandle(this, _completion.id());
+}
+
+/**
+ * Turns the output signal off
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::mute()
+{
+    if (_begun) _output.noteOff(_clock.millis());
+}
+
+/**
+ * Set normal playing mode so that the notes
+ * of the melody are played  in order
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setNormalMode()
+{
+    _random = false;
+}
+
+/**
+ * Set random mode so tha the notes
+ * of the melody are played randomly
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setRandomMode()
+{
+    _random = true;
+}
+
+/**
+ * Plays a single music note n with the set tempo
+ * The duration is given by N_LEN.
+ * A musicNote is defined like {NOTE_C, octave, N_LEN::N4}
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::playNote(musicNote n)
+{
+    if (_notePlayed) return; // play the note only once
+    if (! _started)
+    {
+        _msDuration = 60000 * (uint32_t)n.value / N4_LEN / (uint32_t)_tempo;  // note length in ms
+        _msStart = _clock.millis();  // remember the start time
+        if (! _begun) begin();       // the hardware is set up with the first note
+        _output.noteOn(n.note, n.octave, _msStart, _msDuration);
+        _note = n;
+        _beating = false;
+        TRACE_EVENT(TRACE::NOTE_ON, n.note | n.octave << 4, _msDuration);
+        _started = true;      // set the started flag
+        startNote(n);         // position and bar are kept also without callbacks
+        return;    
+    }
+
+    uint32_t now = _clock.millis();
+    if ((now - _msStart) > _msDuration) // is the note length reached?
+    {
+        _output.noteOff(now);   // stop the tone
+        TRACE_EVENT(TRACE::NOTE_OFF, n.note | n.octave << 4, now - _msStart - _msDuration);  // late by ms
+        if (_nbrCallbacks && _note.note != REST) emit(PLAYER_EVENT::NOTE_OFF, _note);
+        _started    = false;    // reset the started flag
+        _notePlayed = true;     // set the played flag
+        _clock.delay(_msNoteGap);  // wait some ms to separate notes (set the ms with the function setLegato())
+    }
+}
+
+/**
+ * Play the melody, passed as array of notes
+ * Call it in the main loop
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::playMelody(musicNote m[], int len, bool repeat)
+{
+    _notePlayed = false;
+    if (_noteCounter >= len) 
+    { 
+        endMelody();
+        if (repeat) _noteCounter = 0; // reset the note counter to repeat the melody
+        return; 
+    }
+    if (! _random) 
+      playNote(m[_noteCounter]);
+    else
+      playNote(m[_clock.random(len)]);
+    if (_notePlayed) _noteCounter++;  // take next note in melody
+}
+
+/**
+ * Play the melody which was set with setMelody()
+ * Call it in the main loop
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::playMelody(bool repeat)
+{
+    if (_source != nullptr) 
+    {
+        playSource(*_source, repeat);
+        return;
+    }
+    if (_melody == nullptr) return;
+    playMelody(_melody, _melodyLength, repeat);
+}
+
+/**
+ * Play the notes delivered by a NoteSource. The next note is fetched
+ * only when the current one has been played, so the source never has to 
+ * hold more than one note. Random mode does not apply to sources.
+ * Call it in the main loop
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::playSource(NoteSource &source, bool repeat)
+{
+    if (! _haveNote)
+    {
+        if (! source.nextNote(_sourceNote))
+        {
+            endMelody();
+            if (repeat) source.rewind();  // start over with the first note
+            return;
+        }
+        if (source.tempo() > 0)   _tempo  = (TEMPO)source.tempo();
+        if (source.barLength() > 0) _barLength = source.barLength();
+        if (source.volume() >= 0) setVolume(source.volume());
+        _haveNote = true;
+    }
+    _notePlayed = false;
+    playNote(_sourceNote);
+    if (_notePlayed) _haveNote = false;  // fetch the next note
+}
+
+/**
+ * End the sounding note of a melody at once, as if its length was reached but 
+ * without the gap: the output is turned off, NOTE_OFF is sent and the melody 
+ * continues with the next note
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::endNote()
+{
+    if (! _started || _beating) return;
+    _output.noteOff(_clock.millis());
+    if (_nbrCallbacks && _note.note != REST) emit(PLAYER_EVENT::NOTE_OFF, _note);
+    _started    = false;
+    _notePlayed = true;
+    if (_source != nullptr) _haveNote = false;  // fetch the next note
+    else _noteCounter++;
+}
+
+/**
+ * Beats the beat at the set tempo 
+ * Call it in the main loop
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::playBeats()
+{
+    if (! _started)
+    {
+        _msStart = _clock.millis();
+        if (! _begun) begin();
+        _output.noteOn(NOTE_A, 7, _msStart, 4);
+        _started = true;
+        _beating = true;
+        _beatOn  = true;
+    }
+    uint32_t now = _clock.millis();
+    if (_beatOn && (now - _msStart) > 4)
+    {
+        _output.noteOff(now);
+        _beatOn = false;
+    }
+    if ((now - _msStart) > 60000 / (uint32_t)_tempo) _started = false;
+}
+
+/**
+ * Rearm player to play note again after msWait milliseconds
+ * To be used after calling playNote()
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::rearmNoteAfter(uint32_t msWait)
+{
+    uint32_t now = _clock.millis();
+    if (now - _msPrevious >= msWait)
+    {
+        _msPrevious = now;
+        _notePlayed = false;
+    }
+}
+
+/**
+ * Save the position in the melody and the settings into state, with the melodyId
+ * of the application. Cheap enough to be called every few ms
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::saveState(PlayerState &state, uint16_t melodyId)
+{
+    int index = _noteCounter;
+    if (_source != nullptr)
+    {
+        index = _source->position();
+        if (index > 0 && _haveNote) index--;  // the sounding note has been read already
+    }
+    state.version    = PLAYER_STATE_VERSION;
+    state.melodyId   = melodyId;
+    state.noteIndex  = (index > 0) ? index : 0;
+    state.msIntoNote = _started ? min(_clock.millis() - _msStart, (uint32_t)UINT16_MAX) : 0;
+    state.note       = _note.note;
+    state.octave     = _note.octave;
+    state.value      = (uint16_t)_note.value;
+    state.flags      = (_random ? STATE_RANDOM : 0) | (_started ? STATE_SOUNDING : 0);
+    state.tempo      = (uint16_t)_tempo;
+    state.volume     = (uint8_t)_volume;
+    state.timbre     = (uint8_t)_timbre;
+    state.reserved[0] = state.reserved[1] = state.reserved[2] = 0;
+    state.seed       = _clock.seed();
+    state.position   = _position;
+    state.checksum   = stateChecksum(state);
+}
+
+/**
+ * Continue the melody where the state was saved. The application must have set 
+ * the melody given by state.melodyId. Nothing is read or parsed, a NoteSource must 
+ * support seek(). The sounding note continues for the rest of its length and 
+ * is reported with NOTE_ON.
+ * Returns false when the state is not valid or does not fit the melody
+ */
+template <class Clock, class Output>
+bool BasicMelodyPlayer<Clock, Output>::restoreState(const PlayerState &state)
+{
+    if (! stateValid(state)) return false;
+    if (_source != nullptr) 
+    {
+        if (! _source->seek(state.noteIndex)) return false;
+    }
+    else if (_melody == nullptr || state.noteIndex >= _melodyLength) return false;
+
+    _tempo  = (TEMPO)state.tempo;
+    _random = state.flags & STATE_RANDOM;
+    _timbre = (TIMBRE)state.timbre;
+    setVolume(state.volume);
+    _clock.setSeed(state.seed);
+    _noteCounter = state.noteIndex;
+    _position    = state.position;
+    _bar         = (_barLength && _position > 0) ? (_position - min(_position, (uint32_t)state.value)) / _barLength + 1 : 0;
+    _started = _notePlayed = false;
+    _haveNote = false;
+    if (state.flags & STATE_SOUNDING)
+    {
+        _note = { (note_t)state.note, state.octave, (N_LEN)state.value };
+        _beating = false;
+        if (_source != nullptr)
+        {
+            _source->seek(state.noteIndex + 1);
+            _sourceNote = _note;
+            _haveNote   = true;
+        }
+        uint32_t now = _clock.millis();
+        _msDuration  = 60000 * (uint32_t)state.value / N4_LEN / (uint32_t)_tempo;
+        _msStart     = now - state.msIntoNote;
+        if (! _begun) begin();
+        if (state.msIntoNote < _msDuration) 
+        {
+            _output.noteOn(_note.note, _note.octave, now, _msDuration - state.msIntoNote);
+            if (_nbrCallbacks && _note.note != REST) emit(PLAYER_EVENT::NOTE_ON, _note);
+        }
+        _started = true;
+    }
+    return true;
+}
+
+/**
+ * Set the length of a bar in 64ths for the BAR events, e.g. 48 for 3/4, 0 = no BAR events.
+ * A NoteSource which knows the meter (AbcParser) sets it itself
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::setBarLength(uint32_t len)
+{
+    _barLength = len;
+}
+
+/**
+ * Call callback(event, arg) for the events given by mask, e.g. 
+ * EVENT_MASK(PLAYER_EVENT::BAR). Returns false when all places are taken
+ */
+template <class Clock, class Output>
+bool BasicMelodyPlayer<Clock, Output>::addCallback(PlayerCallback callback, void *arg, uint8_t mask)
+{
+    if (_nbrCallbacks >= PLAYER_CALLBACKS) return false;
+    _callback[_nbrCallbacks] = { callback, arg, mask };
+    _nbrCallbacks++;
+    return true;
+}
+
+/**
+ * Remove a callback registered with addCallback()
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::removeCallback(PlayerCallback callback, void *arg)
+{
+    for (int i = 0; i < _nbrCallbacks; i++)
+    {
+        if (_callback[i].callback == callback && _callback[i].arg == arg)
+        {
+            _nbrCallbacks--;
+            _callback[i] = _callback[_nbrCallbacks];
+            break;
+        }
+    }
+}
+
+/**
+ * Call the callbacks for the deferred events, e.g. in the loop of the display task.
+ * Returns the number of events delivered
+ */
+template <class Clock, class Output>
+int BasicMelodyPlayer<Clock, Output>::dispatchEvents()
+{
+    PlayerEvent event;
+    int n = 0;
+    while (_queue.get(event))
+    {
+        deliver(event);
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Position of the melody now in 1/256 of a 64th, it moves on while a note sounds
+ * and stands at the end of the note in the gap before the next one
+ */
+template <class Clock, class Output>
+uint32_t BasicMelodyPlayer<Clock, Output>::getPlayPosition()
+{
+    uint32_t end = _position << 8;
+    if (! _started || _msDuration == 0 || _position < (uint32_t)_note.value) return end;  // no note of the melody sounds
+    uint32_t len     = (uint32_t)_note.value << 8;
+    uint32_t elapsed = min(_clock.millis() - _msStart, _msDuration);
+    return end - len + (uint32_t)((uint64_t)len * elapsed / _msDuration);
+}
+
+/**
+ * Advance position and bar, raise the BAR event when the note is the first 
+ * one in a new bar, then NOTE_ON
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::startNote(const musicNote &n)
+{
+    _ended = false;
+    uint16_t bar = _barLength ? _position / _barLength + 1 : 0;
+    if (bar != _bar)  // the first note in a new bar, a long note may cover several bars
+    {
+        _bar = bar;
+        if (_nbrCallbacks) emit(PLAYER_EVENT::BAR, n);
+    }
+    _position += (uint32_t)n.value;
+    if (_nbrCallbacks && n.note != REST) emit(PLAYER_EVENT::NOTE_ON, n);
+}
+
+/**
+ * Raise MELODY_END once and restart counting the bars
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::endMelody()
+{
+    if (_ended) return;
+    _completion.complete();
+    _ended    = true;
+    if (_nbrCallbacks) emit(PLAYER_EVENT::MELODY_END, _note);
+    _position = _bar = 0;
+}
+
+/**
+ * Pass the event to the callbacks or into the queue
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::emit(PLAYER_EVENT type, const musicNote &n)
+{
+    PlayerEvent event = { type, n, _clock.millis(), _bar };
+    if (_deferred) _queue.put(event);
+    else deliver(event);
+}
+
+/**
+ * Call the callbacks registered for the event
+ */
+template <class Clock, class Output>
+void BasicMelodyPlayer<Clock, Output>::deliver(const PlayerEvent &event)
+{
+    uint8_t bit = EVENT_MASK(event.type);
+    for (int i = 0; i < _nbrCallbacks; i++)
+    {
+        if (_callback[i].mask & bit) _callback[i].callback(event, _callback[i].arg);
+    }
+}
+#endif
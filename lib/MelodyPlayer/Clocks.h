@@ -0,0 +1,72 @@
+/**
+ * Header       Clocks.h
+ *
+ * Purpose      Clock policies of the BasicMelodyPlayer. A clock delivers the time in
+ *              ms, waits and draws random numbers for the random mode:
+ *
+ *              uint32_t millis()           time in ms
+ *              void     delay(uint32_t ms) wait ms milliseconds
+ *              long     random(long n)     random number 0..n-1
+ *              uint32_t seed()             state of the random numbers
+ *              void     setSeed(uint32_t)  restore the state of the random numbers
+ *
+ *              ArduinoClock uses the time functions of the Arduino core and its own
+ *              generator, seeded once by the hardware generator (esp_random()), so
+ *              saveState() keeps the state of the random mode and restoreState() 
+ *              continues the same sequence. VirtualClock only advances when it is 
+ *              told to, so melodies can be played on the host or in a benchmark 
+ *              faster than real time. With -DPLAYER_TRACE it also sets the time
+ *              of the trace.
+ */
+#ifndef _CLOCKS_H_
+#define _CLOCKS_H_
+#include "MelodyTypes.h"
+#include "PlayerTrace.h"
+
+#ifdef ARDUINO
+class ArduinoClock
+{
+    public:
+        uint32_t millis() { return ::millis(); };
+        void     delay(uint32_t ms) { ::delay(ms); };
+        long     random(long n) 
+        {
+            _seed = seed() * 1664525 + 1013904223;  // linear congruential generator
+            return (long)((_seed >> 8) % (uint32_t)n);
+        };
+        uint32_t seed() 
+        { 
+            if (_seed == 0) _seed = esp_random() | 1;  // seeded with the first use
+            return _seed; 
+        };
+        void     setSeed(uint32_t seed) { _seed = seed; };
+
+    private:
+        uint32_t _seed = 0;     // 0 = not seeded yet
+};
+#endif
+
+class VirtualClock
+{
+    public:
+        uint32_t millis() { return _ms; };
+        void     delay(uint32_t ms) { set(_ms + ms); };
+        long     random(long n) 
+        {
+            _seed = _seed * 1664525 + 1013904223;  // linear congruential generator
+            return (long)((_seed >> 8) % (uint32_t)n);
+        };
+        uint32_t seed() { return _seed; };
+        void     setSeed(uint32_t seed) { _seed = seed; };
+        void     advance(uint32_t ms) { set(_ms + ms); };
+        void     set(uint32_t ms) 
+        { 
+            _ms = ms; 
+            TRACE_TIME(ms);  // time stamps of the trace with -DPLAYER_TRACE
+        };
+
+    private:
+        uint32_t _ms   = 0;
+        uint32_t _seed = 1;
+};
+#endif
@@ -0,0 +1,100 @@
+/**
+ * Class        Completion.cpp
+ *
+ * Purpose      Implements the completion of a playback. The player calls start() 
+ *              when a melody is set and complete() when it ends, other tasks wait 
+ *              on the event bit of the playback id.
+ *
+ * References   https://www.freertos.org/xEventGroupCreateStatic.html
+ *              https://www.freertos.org/xTaskNotifyGive.html
+ */
+#include "Completion.h"
+
+#define COMPLETION_BIT(id) ((uint32_t)1 << ((id) % COMPLETION_BITS))
+
+Completion::Completion()
+{
+#ifdef ARDUINO
+    _group = xEventGroupCreateStatic(&_buffer);
+#endif
+}
+
+/**
+ * Start the next playback. The previous one is done, if it has not ended
+ * it has been replaced
+ */
+void Completion::start()
+{
+    uint32_t next = _id + 1;
+#ifdef ARDUINO
+    xEventGroupClearBits(_group, COMPLETION_BIT(next));
+#endif
+    complete();
+    _id = next;
+}
+
+/**
+ * The actual playback has ended, mark it as done and wake the waiting tasks
+ */
+void Completion::complete()
+{
+    if (isDone(_id)) return;
+#ifdef ARDUINO
+    portENTER_CRITICAL(&_mux);
+    void *task = nullptr;
+    _done = _id;
+    if (_task != nullptr && isDone(_taskId))  // a task waiting for a later playback keeps waiting
+    {
+        task  = _task;
+        _task = nullptr;
+    }
+    portEXIT_CRITICAL(&_mux);
+    xEventGroupSetBits(_group, COMPLETION_BIT(_done));
+    if (task != nullptr) xTaskNotifyGive((TaskHandle_t)task);
+#else
+    _done = _id;
+#endif
+}
+
+/**
+ * Block the calling task until the playback id is done, at most ms milliseconds
+ * (UINT32_MAX = no limit). Returns true when it is done. Must not be called by 
+ * the task which plays
+ */
+bool Completion::waitFor(uint32_t id, uint32_t ms)
+{
+#ifdef ARDUINO
+    TickType_t start = xTaskGetTickCount();
+    TickType_t ticks = (ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(ms);
+    while (! isDone(id))
+    {
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (ticks != portMAX_DELAY && waited >= ticks) return false;
+        // the bit may still be set from the playback COMPLETION_BITS ids ago, isDone() decides
+        xEventGroupWaitBits(_group, COMPLETION_BIT(id), pdFALSE, pdTRUE, 
+                            (ticks == portMAX_DELAY) ? portMAX_DELAY : ticks - waited);
+    }
+#endif
+    return isDone(id);
+}
+
+/**
+ * Send a task notification to task (a TaskHandle_t) when the playback id is done,
+ * the task receives it with ulTaskNotifyTake(). The notification is sent only
+ * for this id, not when an earlier playback is done. One task at a time, a later
+ * call replaces the task and its id
+ */
+void Completion::notify(uint32_t id, void *task)
+{
+#ifdef ARDUINO
+    portENTER_CRITICAL(&_mux);
+    bool done = isDone(id);
+    if (! done)
+    {
+        _task   = task;
+        _taskId = id;
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (done) xTaskNotifyGive((TaskHandle_t)task);
+#endif
+}
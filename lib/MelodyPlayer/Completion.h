@@ -0,0 +1,48 @@
+/**
+ * Header       Completion.h
+ *
+ * Purpose      Declaration of the class Completion, which tells other FreeRTOS tasks
+ *              when a melody started with play() has finished. Each setMelody() 
+ *              starts a new playback with the next id; the playback is done when 
+ *              the melody has ended or another melody has been set.
+ *
+ *              On the ESP32 the done flags are bits of a statically allocated event
+ *              group, so waitFor() blocks the waiting task without polling and any
+ *              number of tasks can wait. notify() additionally sends a task 
+ *              notification (xTaskNotifyGive) to one task when the playback is done.
+ *              Without the Arduino core waitFor() only returns the state.
+ */
+#ifndef _COMPLETION_H_
+#define _COMPLETION_H_
+#include "MelodyTypes.h"
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+#endif
+
+#define COMPLETION_BITS 24  // usable bits of an event group, one per playback id
+
+class Completion
+{
+    public:
+        Completion();
+        void     start();
+        void     complete();
+        uint32_t id() { return _id; };
+        bool     isDone(uint32_t id) { return (int32_t)(_done - id) >= 0; };
+        bool     waitFor(uint32_t id, uint32_t ms);
+        void     notify(uint32_t id, void *task);
+
+    private:
+        volatile uint32_t _id   = 0;  // id of the actual playback
+        volatile uint32_t _done = 0;  // id of the last playback which is done
+        void    *_task = nullptr;     // task to notify when _taskId is done
+        uint32_t _taskId = 0;
+#ifdef ARDUINO
+        portMUX_TYPE       _mux = portMUX_INITIALIZER_UNLOCKED;
+        StaticEventGroup_t _buffer;
+        EventGroupHandle_t _group;
+#endif
+};
+#endif
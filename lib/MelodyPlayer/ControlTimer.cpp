@@ -0,0 +1,125 @@
+/**
+ * Class        ControlTimer.cpp
+ *
+ * Purpose      Implements the control rate timer. The timer counts microseconds
+ *              and raises an interrupt every 1000000 / rate us, which calls the
+ *              attached tasks in the order they were attached.
+ */
+#ifdef ARDUINO   // drives the ESP32 hardware, not part of the native build
+#include "ControlTimer.h"
+
+hw_timer_t *ControlTimer::_timer  = nullptr;
+uint32_t    ControlTimer::_rateHz = 0;
+volatile uint8_t ControlTimer::_nbrTasks = 0;
+ControlTask ControlTimer::_task[CONTROL_TASKS];
+void       *ControlTimer::_arg[CONTROL_TASKS];
+volatile uint32_t ControlTimer::_ticks     = 0;
+volatile uint32_t ControlTimer::_cycles    = 0;
+volatile uint32_t ControlTimer::_maxCycles = 0;
+
+static portMUX_TYPE controlMux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * Start the timer with rateHz interrupts per second (100..10000).
+ * Calling it again while running changes the rate
+ */
+bool ControlTimer::begin(uint32_t rateHz)
+{
+    _rateHz = constrain(rateHz, 100U, 10000U);
+    if (_timer == nullptr)
+    {
+        _timer = timerBegin(CONTROL_TIMER, 80, true);  // 80 MHz / 80 = 1 MHz
+        if (_timer == nullptr) return false;
+        timerAttachInterrupt(_timer, &ControlTimer::tick, true);
+    }
+    timerAlarmWrite(_timer, 1000000 / _rateHz, true);
+    timerAlarmEnable(_timer);
+    return true;
+}
+
+/**
+ * Stop the timer and release it
+ */
+void ControlTimer::end()
+{
+    if (_timer == nullptr) return;
+    timerAlarmDisable(_timer);
+    timerDetachInterrupt(_timer);
+    timerEnd(_timer);
+    _timer = nullptr;
+}
+
+/**
+ * Call task(arg) at the control rate. Returns false when all places are taken
+ */
+bool ControlTimer::attach(ControlTask task, void *arg)
+{
+    bool done = false;
+    portENTER_CRITICAL(&controlMux);
+    if (_nbrTasks < CONTROL_TASKS)
+    {
+        _task[_nbrTasks] = task;
+        _arg[_nbrTasks]  = arg;
+        _nbrTasks++;
+        done = true;
+    }
+    portEXIT_CRITICAL(&controlMux);
+    return done;
+}
+
+/**
+ * Stop calling task(arg)
+ */
+void ControlTimer::detach(ControlTask task, void *arg)
+{
+    portENTER_CRITICAL(&controlMux);
+    for (int i = 0; i < _nbrTasks; i++)
+    {
+        if (_task[i] == task && _arg[i] == arg)
+        {
+            _nbrTasks--;
+            _task[i] = _task[_nbrTasks];
+            _arg[i]  = _arg[_nbrTasks];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&controlMux);
+}
+
+/**
+ * Return the average cpu cycles spent per tick since resetStats()
+ */
+uint32_t ControlTimer::cyclesPerTick()
+{
+    uint32_t ticks = _ticks;
+    return ticks ? _cycles / ticks : 0;
+}
+
+/**
+ * Restart the measurement of the cycles per tick
+ */
+void ControlTimer::resetStats()
+{
+    portENTER_CRITICAL(&controlMux);
+    _ticks     = 0;
+    _cycles    = 0;
+    _maxCycles = 0;
+    portEXIT_CRITICAL(&controlMux);
+}
+
+/**
+ * Interrupt of the timer, calls the attached tasks
+ * and measures the cycles spent in them
+ */
+void IRAM_ATTR ControlTimer::tick()
+{
+    uint32_t start = ESP.getCycleCount();
+    portENTER_CRITICAL_ISR(&controlMux);
+    for (int i = 0; i < _nbrTasks; i++) _task[i](_arg[i]);
+    uint32_t cycles = ESP.getCycleCount() - start;
+    _ticks++;
+    _cycles += cycles;
+    if (cycles > _maxCycles) _maxCycles = cycles;
+    portEXIT_CRITICAL_ISR(&controlMux);
+}
+#endif
@@ -0,0 +1,46 @@
+/**
+ * Header       ControlTimer.h
+ *
+ * Purpose      Declaration of the class ControlTimer, a hardware timer which calls
+ *              up to CONTROL_TASKS functions at the control rate (e.g. 1000 Hz).
+ *              Glides (GlideEngine) and LFOs update the ledc output from it, so
+ *              they run at a steady rate, whatever the main loop is doing.
+ *
+ *              The tasks are called in the interrupt. They must be short and
+ *              placed in IRAM (IRAM_ATTR), they must not print or allocate.
+ *              The cpu cycles spent per tick are measured (cyclesPerTick()).
+ */
+#ifndef _CONTROLTIMER_H_
+#define _CONTROLTIMER_H_
+#include <Arduino.h>
+
+#define CONTROL_TASKS 12  // e.g. Lfo and GlideEngine for several voices
+#define CONTROL_TIMER 0  // hardware timer 0..3
+
+typedef void (*ControlTask)(void *arg);
+
+class ControlTimer
+{
+    public:
+        static bool begin(uint32_t rateHz = 1000);
+        static void end();
+        static bool attach(ControlTask task, void *arg);
+        static void detach(ControlTask task, void *arg);
+        static uint32_t rate() { return _rateHz; };
+        static uint32_t cyclesPerTick();
+        static uint32_t maxCyclesPerTick() { return _maxCycles; };
+        static void resetStats();
+
+    private:
+        static void tick();
+
+        static hw_timer_t *_timer;
+        static uint32_t    _rateHz;
+        static volatile uint8_t _nbrTasks;
+        static ControlTask _task[CONTROL_TASKS];
+        static void       *_arg[CONTROL_TASKS];
+        static volatile uint32_t _ticks;      // ticks since resetStats()
+        static volatile uint32_t _cycles;     // cpu cycles spent in these ticks
+        static volatile uint32_t _maxCycles;
+};
+#endif
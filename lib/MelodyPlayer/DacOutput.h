@@ -0,0 +1,40 @@
+/**
+ * Header       DacOutput.h
+ *
+ * Purpose      Declaration of the class DacOutput, an output policy of the 
+ *              BasicMelodyPlayer which plays the notes on a voice of the DacSynth.
+ *              Call synth.begin() in setup() and synth.pump() in the main loop.
+ *
+ *              BasicMelodyPlayer<ArduinoClock, DacOutput> dacPlayer(synth, 0);
+ *
+ * Constructor
+ * arguments    synth       the DacSynth which outputs the voice
+ *              voice       voice 0..DAC_VOICES-1
+ */
+#ifndef _DACOUTPUT_H_
+#define _DACOUTPUT_H_
+#include "DacSynth.h"
+
+class DacOutput
+{
+    public:
+        DacOutput(DacSynth &synth, uint8_t voice = 0) : _synth(synth), _voice(voice) {};
+        void begin() {};
+        void setLevel(uint32_t volume, TIMBRE timbre)
+        {
+            static const uint8_t width[3] = { 12, 25, 50 };  // pulse width in % of the timbres
+            _volume = (uint8_t)volume;
+            _synth.setPulseWidth(_voice, width[(int)timbre]);
+        };
+        void noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration) 
+        { 
+            _synth.noteOn(_voice, note, octave, _volume);
+        };
+        void noteOff(uint32_t ms) { _synth.noteOff(_voice); };
+
+    private:
+        DacSynth &_synth;
+        uint8_t   _voice;
+        uint8_t   _volume = 0;
+};
+#endif
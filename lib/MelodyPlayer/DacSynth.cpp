@@ -0,0 +1,248 @@
+/**
+ * Class        DacSynth.cpp
+ *
+ * Purpose      Implements a software synthesizer which outputs its voices with the 
+ *              built-in DAC. The samples are rendered just in time, one DMA buffer
+ *              at a time, so the latency is below DAC_BLOCK / sampleRate seconds
+ *              (8 ms at 32 kHz).
+ *
+ * Remarks      Uses i2s_driver_install() in I2S_MODE_DAC_BUILT_IN mode with the
+ *              right channel, which is the DAC on GPIO25
+ *
+ * References   https://docs.espressif.com/projects/esp-idf/en/v4.4/esp32/api-reference/peripherals/i2s.html
+ */
+#include "DacSynth.h"
+#include "VolumeTaper.h"
+#ifdef ARDUINO
+#include <driver/i2s.h>
+#endif
+
+// Note frequencies of octave 8 in Hz, the same as used by ledcWriteNote()
+static const float noteFrequency8[12] = { 4186.01, 4434.92, 4698.64, 4978.03, 5274.04, 5587.65, 
+                                          5919.91, 6271.93, 6644.88, 7040.00, 7458.62, 7902.13 };
+
+/**
+ * Install the I2S driver with the built-in DAC and
+ * precompute the phase increments of the notes.
+ * On the host only the voices are prepared, render() computes the samples
+ */
+bool DacSynth::begin()
+{
+    for (int i = 0; i < 12; i++)
+    {
+        _noteInc[i] = (uint32_t)(noteFrequency8[i] / _sampleRate * 4294967296.0f);
+    }
+    DrumVoice::prepareKit(_sampleRate);
+    _sequencer.setTempo(_tempo, _sampleRate);
+
+#ifdef ARDUINO
+    i2s_config_t config = {};
+    config.mode                 = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN);
+    config.sample_rate          = _sampleRate;
+    config.bits_per_sample      = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format       = I2S_CHANNEL_FMT_ONLY_RIGHT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_MSB;
+    config.dma_buf_count        = 2;
+    config.dma_buf_len          = DAC_BLOCK;
+    if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK) return false;
+    i2s_set_pin(I2S_NUM_0, NULL);
+    i2s_set_dac_mode(I2S_DAC_CHANNEL_RIGHT_EN);  // GPIO25
+#endif
+    _running = true;
+    return true;
+}
+
+/**
+ * Stop the output and release the I2S driver
+ */
+void DacSynth::end()
+{
+    if (! _running) return;
+#ifdef ARDUINO
+    i2s_driver_uninstall(I2S_NUM_0);
+#endif
+    _running = false;
+}
+
+/**
+ * Start a note on voice 0..DAC_VOICES-1 with the perceived volume 0..100
+ * A REST switches the voice off
+ */
+void DacSynth::noteOn(uint8_t voice, note_t note, uint8_t octave, uint8_t volume)
+{
+    if (voice >= DAC_VOICES) return;
+    if (note >= REST || octave > 8) 
+    {
+        noteOff(voice);
+        return;
+    }
+    _voice[voice].setIncrement(_noteInc[note] >> (8 - octave));
+    _voice[voice].setLevel((int32_t)(volumeTaper[min(volume, (uint8_t)VOLUME_MAX)] >> 1) / DAC_VOICES);
+}
+
+/**
+ * Switch off voice 0..DAC_VOICES-1
+ */
+void DacSynth::noteOff(uint8_t voice)
+{
+    if (voice < DAC_VOICES) _voice[voice].setLevel(0);
+}
+
+/**
+ * Set the pulse width of a voice 1..99%
+ */
+void DacSynth::setPulseWidth(uint8_t voice, uint8_t percent)
+{
+    if (voice < DAC_VOICES) _voice[voice].setPulseWidth(percent);
+}
+
+/**
+ * Play a sound clip on sample voice 0..DAC_SAMPLE_VOICES-1 with volume 0..100
+ */
+void DacSynth::playSample(uint8_t voice, const SampleClip &clip, uint8_t volume, bool loop)
+{
+    if (voice < DAC_SAMPLE_VOICES) _sample[voice].play(clip, volume, loop);
+}
+
+/**
+ * Stop the clip playing on a sample voice
+ */
+void DacSynth::stopSample(uint8_t voice)
+{
+    if (voice < DAC_SAMPLE_VOICES) _sample[voice].stop();
+}
+
+/**
+ * Returns true while a clip is playing on the sample voice
+ */
+bool DacSynth::isSamplePlaying(uint8_t voice)
+{
+    return voice < DAC_SAMPLE_VOICES && _sample[voice].isPlaying();
+}
+
+/**
+ * Start a drum on percussion voice 0..DAC_DRUM_VOICES-1 with volume 0..100
+ */
+void DacSynth::triggerDrum(uint8_t voice, DRUM drum, uint8_t volume)
+{
+    if (voice < DAC_DRUM_VOICES) _drum[voice].trigger(drum, volume);
+}
+
+/**
+ * Set the drum pattern of the step sequencer
+ */
+void DacSynth::setPattern(const DrumPattern &pattern)
+{
+    _sequencer.setPattern(pattern, DAC_DRUM_VOICES);
+    _sequencer.setTempo(_tempo, _sampleRate);
+}
+
+/**
+ * Set the tempo of the step sequencer in quarter notes per minute. To keep
+ * drums and melody together call follow(player) instead
+ */
+void DacSynth::setTempo(int bpm)
+{
+    _tempo = bpm;
+    _sequencer.setTempo(_tempo, _sampleRate);
+}
+
+/**
+ * Lock the sequencer to a melody which is at position now, its sounding note
+ * ends at until (both in 1/256 of a 64th) and it plays at bpm. The position is
+ * written as a seqlock, render() in another task takes it only when complete
+ */
+void DacSynth::follow(uint32_t position, uint32_t until, int bpm)
+{
+    if (bpm != _tempo) setTempo(bpm);
+    uint32_t seq = _followSeq.load(std::memory_order_relaxed);
+    _followSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _followPos.store(position, std::memory_order_relaxed);
+    _followUntil.store(until, std::memory_order_relaxed);
+    _followSeq.store(seq + 2, std::memory_order_release);
+}
+
+/**
+ * Sync the sequencer to the position last passed to follow()
+ */
+void DacSynth::syncSequencer()
+{
+    uint32_t seq = _followSeq.load(std::memory_order_acquire);
+    if (seq == _followSeen || (seq & 1)) return;
+    uint32_t position = _followPos.load(std::memory_order_relaxed);
+    uint32_t until    = _followUntil.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_followSeq.load(std::memory_order_relaxed) != seq) return;  // overwritten meanwhile, take the next one
+    _sequencer.sync(position, until);
+    _followSeen = seq;
+}
+
+/**
+ * Add all voices to the mix buffer
+ */
+void DacSynth::mix(int32_t *mix, int n)
+{
+    for (int v = 0; v < DAC_VOICES; v++) _voice[v].render(mix, n);
+    for (int v = 0; v < DAC_SAMPLE_VOICES; v++) _sample[v].render(mix, n, _sampleRate);
+    for (int v = 0; v < DAC_DRUM_VOICES; v++) _drum[v].render(mix, n);
+}
+
+/**
+ * Render n samples into buf in the format of the built-in DAC:
+ * unsigned with the 8 significant bits in the high byte
+ */
+void DacSynth::render(int16_t *buf, int n)
+{
+    int32_t acc[DAC_BLOCK];
+
+    syncSequencer();
+    while (n > 0)
+    {
+        int len = min(n, DAC_BLOCK);
+        if (_sequencer.isRunning() && ! _sequencer.isHeld())
+        {
+            // play the drums of a step exactly at its first sample
+            if (_sequencer.samplesToNextStep() == 0)
+            {
+                uint8_t count;
+                const SeqEvent *e = _sequencer.nextStep(count);
+                for (uint8_t i = 0; i < count; i++) _drum[e[i].voice].trigger(e[i].drum, e[i].volume);
+            }
+            len = min((uint32_t)len, _sequencer.samplesToNextStep());
+            _sequencer.elapse(len);
+        }
+        memset(acc, 0, len * sizeof(int32_t));
+        mix(acc, len);
+        for (int i = 0; i < len; i++)
+        {
+            int32_t s = constrain(acc[i], -32768, 32767);
+            buf[i] = (int16_t)((s + 32768) & 0xFF00);
+        }
+        buf += len;
+        n   -= len;
+    }
+}
+
+/**
+ * Feed the DMA with the next block of samples as soon as it has room.
+ * Never blocks, call it often enough to keep the DMA buffers filled
+ */
+void DacSynth::pump()
+{
+#ifdef ARDUINO
+    if (! _running) return;
+
+    if (_pending == 0)
+    {
+        uint32_t start = ESP.getCycleCount();
+        render(_block, DAC_BLOCK);
+        _cyclesPerSample    = (ESP.getCycleCount() - start) / DAC_BLOCK;
+        _maxCyclesPerSample = max(_maxCyclesPerSample, _cyclesPerSample);
+        _pending = sizeof(_block);
+    }
+    size_t written = 0;
+    i2s_write(I2S_NUM_0, (const char *)_block + sizeof(_block) - _pending, _pending, &written, 0);
+    _pending -= written;
+#endif
+}
@@ -0,0 +1,86 @@
+/**
+ * Header       DacSynth.h
+ *
+ * Purpose      Declaration of the class DacSynth, a software synthesizer with up to 
+ *              DAC_VOICES band-limited pulse voices and DAC_SAMPLE_VOICES sample voices 
+ *              (see SampleVoice.h) and DAC_DRUM_VOICES percussion voices played by a
+ *              step sequencer (see StepSequencer.h) which are mixed and output with 
+ *              the built-in 8 bit DAC of the ESP32 through I2S DMA. This is an 
+ *              alternative to the ledc pwm output for cleaner sound and polyphony.
+ *              The DAC output is GPIO25, the same pin as the speaker of the demo, 
+ *              so it can't be used at the same time as the ledc output on this pin.
+ *
+ *              Call pump() in the main loop or from a task, it renders a block of
+ *              samples whenever the DMA has room for it.
+ *
+ *              The drums follow a melody player when follow(player) is called
+ *              together with pump(): it passes the position of the melody and the
+ *              end of its sounding note to the sequencer, which is synced to them
+ *              when the next block is rendered. A step sounds at most one block 
+ *              after the note it belongs to, even when the melody falls behind 
+ *              its tempo by the gaps between the notes.
+ *
+ * Constructor
+ * arguments    sampleRate  samples per second, 32000 by default
+ */
+#ifndef _DACSYNTH_H_
+#define _DACSYNTH_H_
+#include <atomic>
+#include "MelodyTypes.h"
+#include "PulseOscillator.h"
+#include "SampleVoice.h"
+#include "StepSequencer.h"
+
+#define DAC_VOICES 8
+#define DAC_SAMPLE_VOICES 2
+#define DAC_DRUM_VOICES   4
+#define DAC_BLOCK  256  // samples per DMA buffer
+
+class DacSynth
+{
+    public:
+        DacSynth(uint32_t sampleRate = 32000) : _sampleRate(sampleRate) {};
+        bool begin();
+        void end();
+        void noteOn(uint8_t voice, note_t note, uint8_t octave, uint8_t volume = 100);
+        void noteOff(uint8_t voice);
+        void setPulseWidth(uint8_t voice, uint8_t percent);
+        void playSample(uint8_t voice, const SampleClip &clip, uint8_t volume = 100, bool loop = false);
+        void stopSample(uint8_t voice);
+        bool isSamplePlaying(uint8_t voice);
+        void triggerDrum(uint8_t voice, DRUM drum, uint8_t volume = 100);
+        void setPattern(const DrumPattern &pattern);
+        void setTempo(int bpm);
+        void startPattern() { _sequencer.start(); };
+        void stopPattern()  { _sequencer.stop(); };
+        void follow(uint32_t position, uint32_t until, int bpm);
+        template <class Player>
+        void follow(Player &player) { follow(player.getPlayPosition(), player.getPosition() << 8, player.getTempo()); };
+        void render(int16_t *buf, int n);
+        void pump();
+        uint32_t sampleRate()      { return _sampleRate; };
+        uint32_t cyclesPerSample() { return _cyclesPerSample; };
+        uint32_t maxCyclesPerSample() { return _maxCyclesPerSample; };
+
+    protected:
+        void mix(int32_t *mix, int n);
+        void syncSequencer();
+
+        uint32_t _sampleRate;
+        uint32_t _noteInc[12];          // phase increments of the notes in octave 8
+        PulseOscillator _voice[DAC_VOICES];
+        SampleVoice _sample[DAC_SAMPLE_VOICES];
+        DrumVoice   _drum[DAC_DRUM_VOICES];
+        StepSequencer _sequencer;
+        int      _tempo = (int)TEMPO::MODERATO;
+        std::atomic<uint32_t> _followSeq { 0 };     // odd while follow() writes the position
+        std::atomic<uint32_t> _followPos { 0 };
+        std::atomic<uint32_t> _followUntil { 0 };
+        uint32_t _followSeen = 0;           // _followSeq of the last sync
+        int16_t  _block[DAC_BLOCK];
+        size_t   _pending = 0;          // bytes of _block not yet written to the DMA
+        bool     _running = false;
+        uint32_t _cyclesPerSample    = 0;
+        uint32_t _maxCyclesPerSample = 0;
+};
+#endif
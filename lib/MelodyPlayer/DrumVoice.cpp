@@ -0,0 +1,113 @@
+/**
+ * Class        DrumVoice.cpp
+ *
+ * Purpose      Implements the percussion voices of the DacSynth
+ */
+#include "DrumVoice.h"
+#include "VolumeTaper.h"
+#include <math.h>
+
+typedef struct 
+{ 
+    float toneHz;       // start frequency of the tone
+    float pitchMs;      // time for the pitch to fall by 1/e
+    float toneMix;      // 0..1
+    float noiseMix;     // 0..1
+    float noiseHz;      // clock of the LFSR
+    bool  metallic;     // short LFSR sequence
+    float decayMs;      // time for the level to fall by 1/e
+} DrumSpec;
+
+static const DrumSpec drumSpec[(int)DRUM::NBR_DRUMS] = 
+{
+    { 150.0,  25.0, 1.0, 0.0,      0.0, false, 180.0 },  // KICK
+    { 220.0,  60.0, 0.4, 0.7,  12000.0, false, 100.0 },  // SNARE
+    {   0.0,   0.0, 0.0, 1.0,  32000.0, true,   25.0 },  // HIHAT
+    {   0.0,   0.0, 0.0, 1.0,  32000.0, true,  200.0 },  // OPEN_HIHAT
+    { 120.0, 150.0, 1.0, 0.1,   6000.0, false, 250.0 },  // TOM
+    {2500.0,   0.0, 1.0, 0.0,      0.0, false,  15.0 },  // CLAVE
+};
+
+typedef struct { uint32_t toneInc, noiseInc; int32_t toneMix, noiseMix, decay, pitchDecay; bool metallic; } DrumParams;
+static DrumParams drumKit[(int)DRUM::NBR_DRUMS];
+
+/**
+ * Compute the phase increments and decay factors
+ * of all drums for the sample rate
+ */
+void DrumVoice::prepareKit(uint32_t sampleRate)
+{
+    for (int i = 0; i < (int)DRUM::NBR_DRUMS; i++)
+    {
+        const DrumSpec &s = drumSpec[i];
+        DrumParams &p = drumKit[i];
+        float period  = (float)DRUM_CONTROL_RATE / sampleRate * 1000.0f;  // ms
+        p.toneInc     = (uint32_t)(s.toneHz / sampleRate * 4294967296.0f);
+        p.noiseInc    = (uint32_t)min(s.noiseHz / sampleRate * 4294967296.0f, 4294967295.0f);
+        p.toneMix     = (int32_t)(s.toneMix * 32767);
+        p.noiseMix    = (int32_t)(s.noiseMix * 32767);
+        p.decay       = (int32_t)(expf(-period / s.decayMs) * 32768);
+        p.pitchDecay  = (s.pitchMs > 0) ? (int32_t)(expf(-period / s.pitchMs) * 32768) : 32768;
+        p.metallic    = s.metallic;
+    }
+}
+
+/**
+ * Start a drum with the perceived volume 0..100
+ */
+void DrumVoice::trigger(DRUM drum, uint8_t volume)
+{
+    if (drum >= DRUM::NBR_DRUMS) return;
+    const DrumParams &p = drumKit[(int)drum];
+    _level      = 0;  // keep the renderer quiet while switching
+    _tonePhase  = 0;
+    _toneInc    = p.toneInc;
+    _noiseInc   = p.noiseInc;
+    _toneMix    = p.toneMix;
+    _noiseMix   = p.noiseMix;
+    _decay      = p.decay;
+    _pitchDecay = p.pitchDecay;
+    _metallic   = p.metallic;
+    _count      = DRUM_CONTROL_RATE;
+    _level      = volumeTaper[min(volume, (uint8_t)VOLUME_MAX)] >> 1;
+}
+
+/**
+ * Update envelope and pitch once per control period
+ */
+void DrumVoice::control()
+{
+    _level   = (_level * _decay) >> 15;
+    _toneInc = (uint32_t)(((uint64_t)_toneInc * _pitchDecay) >> 15);
+    if (_level < 16) _level = 0;
+    _count = DRUM_CONTROL_RATE;
+}
+
+/**
+ * Add n samples to the mix buffer
+ */
+void DrumVoice::render(int32_t *mix, int n)
+{
+    for (int i = 0; i < n && _level > 0; i++)
+    {
+        // triangle tone
+        int32_t p    = (int32_t)(_tonePhase >> 16);
+        int32_t tone = (p < 32768) ? 2 * p - 32768 : 98303 - 2 * p;
+        _tonePhase  += _toneInc;
+
+        // LFSR noise, clocked when the noise phase overflows
+        uint32_t prev = _noisePhase;
+        _noisePhase  += _noiseInc;
+        if (_noisePhase < prev)
+        {
+            uint16_t bit = (_lfsr ^ (_lfsr >> 1)) & 1;
+            _lfsr = (_lfsr >> 1) | (bit << 14);
+            if (_metallic) _lfsr = (_lfsr & ~(1 << 6)) | (bit << 6);
+        }
+        int32_t noise = (_lfsr & 1) ? 32767 : -32767;
+
+        int32_t s = ((tone * _toneMix) >> 15) + ((noise * _noiseMix) >> 15);
+        mix[i] += (s * _level) >> 17;  // a drum uses a quarter of the full scale
+        if (--_count == 0) control();
+    }
+}
@@ -0,0 +1,43 @@
+/**
+ * Header       DrumVoice.h
+ *
+ * Purpose      Declaration of the class DrumVoice, a percussion voice of the DacSynth.
+ *              A drum is a mix of a triangle tone with falling pitch and the noise of a
+ *              15 bit LFSR (linear feedback shift register, as in the noise channel of 
+ *              8 bit game consoles), shaped by an exponential decay. The parameters of
+ *              all drums are precomputed for the sample rate by prepareKit(), so 
+ *              triggering a drum only copies a few values.
+ */
+#ifndef _DRUMVOICE_H_
+#define _DRUMVOICE_H_
+#include "MelodyTypes.h"
+
+enum class DRUM : uint8_t { KICK, SNARE, HIHAT, OPEN_HIHAT, TOM, CLAVE, NBR_DRUMS };
+
+#define DRUM_CONTROL_RATE 32  // envelope and pitch are updated every 32 samples
+
+class DrumVoice
+{
+    public:
+        static void prepareKit(uint32_t sampleRate);
+        void trigger(DRUM drum, uint8_t volume = 100);
+        bool isActive() { return _level > 0; };
+        void render(int32_t *mix, int n);
+
+    private:
+        void control();
+
+        uint32_t _tonePhase  = 0;
+        uint32_t _toneInc    = 0;
+        uint32_t _noisePhase = 0;
+        uint32_t _noiseInc   = 0;
+        uint16_t _lfsr       = 1;
+        bool     _metallic   = false;   // short LFSR sequence of 127 steps
+        int32_t  _level      = 0;       // envelope Q15
+        int32_t  _toneMix    = 0;       // Q15
+        int32_t  _noiseMix   = 0;       // Q15
+        int32_t  _decay      = 0;       // envelope factor per control period Q15
+        int32_t  _pitchDecay = 0;       // tone increment factor per control period Q15
+        uint8_t  _count      = 0;       // samples until the next control update
+};
+#endif
@@ -0,0 +1,138 @@
+/**
+ * Class        GlideEngine.cpp
+ *
+ * Purpose      Implements the glides of the ledc output. The value of the timer 
+ *              configuration register (duty resolution, clock divider and clock
+ *              source) is computed for each step by prepare(), the interrupt only 
+ *              copies it into the register and moves to the next step (advance()).
+ *              Only glide() and the interrupt drive the hardware.
+ *
+ * References   ESP32 Technical Reference Manual, chapter LED PWM Controller
+ */
+#include <math.h>
+#include "GlideEngine.h"
+#include "TuningTable.h"
+#ifdef ARDUINO
+#include "ControlTimer.h"
+#endif
+
+GlideEngine::GlideEngine(uint8_t channel)
+{
+    _channel = channel;
+#ifdef ARDUINO
+    _reg     = TuningTable::timerRegister(channel);
+#endif
+}
+
+#ifdef ARDUINO
+/**
+ * Sweep from frequency from to frequency to (Hz) in ms milliseconds.
+ * EXPONENTIAL sweeps in equal steps of pitch, LINEAR in equal steps of frequency.
+ * With pingPong the sweep turns at both ends until stop() is called.
+ * Returns false if the control timer can't be started
+ */
+bool GlideEngine::glide(float from, float to, uint32_t ms, GLIDE curve, bool pingPong)
+{
+    if (ControlTimer::rate() == 0 && ! ControlTimer::begin()) return false;
+
+    _active = false;  // the interrupt leaves the table alone while it is rebuilt
+    prepare(from, to, ms * ControlTimer::rate() / 1000, curve, pingPong);
+    if (! _attached) _attached = ControlTimer::attach(&GlideEngine::tick, this);
+    _active   = _attached;
+    return _attached;
+}
+#endif
+
+/**
+ * Compute the register values of a sweep from frequency from to frequency to
+ * which takes ticks ticks of the control timer and start at the first step,
+ * advance() then moves along the steps
+ */
+void GlideEngine::prepare(float from, float to, uint32_t ticks, GLIDE curve, bool pingPong)
+{
+    ticks  = max(2U, ticks);
+    _steps = min(ticks, (uint32_t)GLIDE_STEPS);
+
+    from = max(from, 1.0f);
+    to   = max(to, 1.0f);
+    float ratio = powf(to / from, 1.0f / (_steps - 1));
+    float delta = (to - from) / (_steps - 1);
+    float f     = from;
+    for (int i = 0; i < _steps; i++)
+    {
+        _conf[i] = TuningTable::timerConfig(TuningTable::divider(f), _channel);
+        f = (curve == GLIDE::EXPONENTIAL) ? f * ratio : f + delta;
+    }
+    _conf[_steps - 1] = TuningTable::timerConfig(TuningTable::divider(to), _channel);  // no rounding error at the end
+
+    _pingPong = pingPong;
+    _index    = -1;
+    _pos      = 0;
+    _end      = (_steps - 1) << 16;
+    _inc      = _end / (int32_t)(ticks - 1);
+    _active   = true;
+}
+
+/**
+ * Stop the glide, the frequency of the last step is kept
+ */
+void GlideEngine::stop()
+{
+    _active = false;
+}
+
+/**
+ * Return the frequency in Hz of a step of the actual glide
+ */
+float GlideEngine::frequency(int step)
+{
+    if (step < 0 || step >= _steps) return 0.0f;
+    return TuningTable::frequency(TuningTable::configDivider(_conf[step]));
+}
+
+/**
+ * Move one tick along the table. Returns the step to write into the register
+ * when it is reached, -1 when the register keeps its value
+ */
+int IRAM_ATTR GlideEngine::advance()
+{
+    if (! _active) return -1;
+
+    int index = _pos >> 16;
+    int write = (index != _index) ? index : -1;
+    _index = index;
+
+    int32_t pos = _pos + _inc;
+    if (pos > _end)
+    {
+        if (_pingPong)
+        {
+            pos  = 2 * _end - pos;  // turn at the upper end
+            _inc = -_inc;
+        }
+        else
+        {
+            pos = _end;
+            if (index == _steps - 1) _active = false;  // last step written
+        }
+    }
+    else if (pos < 0)
+    {
+        pos  = -pos;                // turn at the lower end
+        _inc = -_inc;
+    }
+    _pos = pos;
+    return write;
+}
+
+#ifdef ARDUINO
+/**
+ * Called by the ControlTimer, writes the register when the next step is reached
+ */
+void IRAM_ATTR GlideEngine::tick(void *arg)
+{
+    GlideEngine *g = (GlideEngine *)arg;
+    int index = g->advance();
+    if (index >= 0) *g->_reg = g->_conf[index];
+}
+#endif
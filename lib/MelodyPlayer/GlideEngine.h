@@ -0,0 +1,51 @@
+/**
+ * Header       GlideEngine.h
+ *
+ * Purpose      Declaration of the class GlideEngine which sweeps the frequency of a
+ *              ledc channel continuously from one frequency to another, linear or
+ *              exponential (equal steps in pitch), once or back and forth like a
+ *              siren. The MelodyPlayer uses it for portamento between notes.
+ *
+ *              glide() computes the configuration register of the ledc timer for
+ *              every step in advance (prepare()). The steps are output by the 
+ *              ControlTimer interrupt, each step is a single register write of the
+ *              step returned by advance(). prepare() and advance() also run on the
+ *              host, so the sweep can be simulated tick by tick.
+ *
+ * Constructor
+ * arguments    channel     ESP32 pwm channel, set up with 10 bit resolution
+ */
+#ifndef _GLIDEENGINE_H_
+#define _GLIDEENGINE_H_
+#include "MelodyTypes.h"
+
+#define GLIDE_STEPS 512  // steps of the longest glide, longer glides hold each step for several ticks
+
+class GlideEngine
+{
+    public:
+        GlideEngine(uint8_t channel);
+        bool  glide(float from, float to, uint32_t ms, GLIDE curve = GLIDE::EXPONENTIAL, bool pingPong = false);
+        void  prepare(float from, float to, uint32_t ticks, GLIDE curve, bool pingPong);
+        int   advance();
+        void  stop();
+        bool  isGliding() { return _active; };
+        int   steps() { return _steps; };
+        float frequency(int step);
+
+    private:
+        static void tick(void *arg);
+
+        volatile uint32_t *_reg = nullptr;  // configuration register of the ledc timer
+        uint8_t  _channel;
+        bool     _attached  = false;
+        bool     _pingPong  = false;
+        volatile bool _active = false;
+        int      _steps     = 0;
+        int      _index     = -1;       // step written into the register
+        int32_t  _pos       = 0;        // position in the table in Q16
+        int32_t  _inc       = 0;        // steps per tick in Q16, negative when sweeping back
+        int32_t  _end       = 0;        // position of the last step
+        uint32_t _conf[GLIDE_STEPS];    // register value of each step
+};
+#endif
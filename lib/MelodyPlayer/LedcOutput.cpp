@@ -0,0 +1,139 @@
+/**
+ * Class        LedcOutput.cpp
+ *
+ * Purpose      Implements the ledc output of the MelodyPlayer.
+ * 
+ * Remarks      Uses ledcSetup(channel, frequency, resolution)   to initialize the ledc pwm subsystem
+ *                   ledcAttachPin(pin, channel)                 to attach the output pin to the pwm channel
+ *                   ledcWrite(channel, dutyCycle)               to set the pwm duty cycle (volume and timbre)
+ *                   ledcWriteNote(channel, note, octave)        to set the output frequency
+ */
+#ifdef ARDUINO   // drives the ESP32 hardware, not part of the native build
+#include "LedcOutput.h"
+
+/**
+ * Set up the channel and attach the pin
+ */
+void LedcOutput::begin()
+{
+    ledcSetup(_channel, 20000, _resolution);
+    ledcAttachPin(_pin, _channel);
+    ledcWrite(_channel, 0);
+}
+
+/**
+ * Combine the perceived volume 0..100 and the timbre into the pulse width as 
+ * fraction of the period. The volume follows a log taper, so that equal steps
+ * sound equally loud. As the duty cycle is relative to the period, the volume
+ * is the same for all pitches. A volume above 0 has at least one step of
+ * the timer (see VolumeTaper.h). A playing note changes immediately
+ */
+void LedcOutput::setLevel(uint32_t volume, TIMBRE timbre)
+{
+    _level = pulseLevel(volume, timbre);
+    if (_sounding) 
+    {
+        _duty = pulseDuty(_level, _resolution);
+        ledcWrite(_channel, _duty);
+        if (_lfo) _lfo->setDuty(_duty);
+    }
+}
+
+/**
+ * Play the notes with the frequencies of a TuningTable,
+ * nullptr returns to the fixed table of ledcWriteNote()
+ */
+void LedcOutput::setTuning(TuningTable *tuning)
+{
+    _tuning = tuning;
+}
+
+/**
+ * Slide from note to note within msPortamento, the glide
+ * must use the same channel. nullptr or 0 ms switches it off
+ */
+void LedcOutput::setPortamento(GlideEngine *glide, uint32_t msPortamento)
+{
+    _glide        = glide;
+    _msPortamento = msPortamento;
+}
+
+/**
+ * Add vibrato and tremolo of the Lfo to the notes, the Lfo
+ * must use the same channel. nullptr switches it off
+ */
+void LedcOutput::setLfo(Lfo *lfo)
+{
+    if (_lfo) _lfo->noteOff();
+    _lfo = lfo;
+}
+
+/**
+ * Sweep the tone from frequency from to frequency to (Hz), e.g. for a siren.
+ * Needs the GlideEngine given with setPortamento(), noteOff() stops it
+ */
+bool LedcOutput::glide(float from, float to, uint32_t ms, GLIDE curve, bool pingPong)
+{
+    if (_glide == nullptr || ledcWriteTone(_channel, from) == 0) return false;
+    if (_lfo) _lfo->noteOff();  // vibrato would fight with the glide
+    _resolution = LEDC_NOTE_RESOLUTION;
+    _duty       = pulseDuty(_level, _resolution);
+    _sounding   = true;
+    _frequency  = 0.0f;
+    ledcWrite(_channel, _duty);
+    return _glide->glide(from, to, ms, curve, pingPong);
+}
+
+/**
+ * Start the note, a REST silences the channel. msDuration 
+ * limits the portamento to the length of the note
+ */
+void LedcOutput::noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration)
+{
+    // Caveat: ledcWriteNote() sets the resolution to 10 bit. 
+    //         That's why the duty cycle is derived from the level here
+    
+    // ledcWriteNote() returns 0 when note is a REST, so we switch off the channel
+    // by setting the dyty cycle to 0, otherwise we set it for volume and timbre.
+    // A TuningTable writes its precomputed clock divider instead
+    float f = 0.0f;
+    if (_glide) _glide->stop();  // a glide must not overwrite the new note
+
+    // portamento: slide from the previous note, a note after a rest starts on its pitch.
+    // The timer still plays the previous note, where the glide starts, so the new
+    // note is not written before (it would sound as a blip of the target pitch)
+    bool slide = _glide && _msPortamento > 0 && _frequency > 0.0f && note < NOTE_MAX;
+    if (slide)
+    {
+        f = _tuning ? _tuning->achieved(note, octave) : TuningTable::ledcNote(note, octave);
+        slide = _glide->glide(_frequency, f, min(_msPortamento, msDuration));
+    }
+    if (slide) _sounding = true;
+    else if (_tuning)
+    {
+        _sounding = _tuning->writeNote(_channel, note, octave);
+        f = _sounding ? _tuning->achieved(note, octave) : 0.0f;
+    }
+    else
+    {
+        f = ledcWriteNote(_channel, note, octave);
+        _sounding = (f != 0.0f);
+    }
+    _resolution = LEDC_NOTE_RESOLUTION;
+    _duty       = _sounding ? pulseDuty(_level, _resolution) : 0;
+    ledcWrite(_channel, _duty);
+    _frequency = f;
+    if (_lfo) _lfo->noteOn(f, _duty);  // vibrato and tremolo, a REST stops them
+}
+
+/**
+ * Stop the tone
+ */
+void LedcOutput::noteOff(uint32_t ms)
+{
+    if (_lfo) _lfo->noteOff();
+    ledcWrite(_channel, 0);
+    if (_glide) _glide->stop();
+    _sounding = false;
+}
+#endif
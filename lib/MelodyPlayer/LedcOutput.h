@@ -0,0 +1,47 @@
+/**
+ * Header       LedcOutput.h
+ *
+ * Purpose      Declaration of the class LedcOutput, the output policy of the 
+ *              MelodyPlayer which plays the notes as pulse wave with the ledc pwm
+ *              subsystem of the ESP32. Optionally the notes are tuned by a
+ *              TuningTable, slide with a GlideEngine and swing with an Lfo.
+ *
+ * Constructor
+ * arguments    pin         ESP32 pin which outputs the tone
+ *              channel     ESP32 pwm channel
+ */
+#ifndef _LEDCOUTPUT_H_
+#define _LEDCOUTPUT_H_
+#include "MelodyTypes.h"
+#include "VolumeTaper.h"
+#include "TuningTable.h"
+#include "GlideEngine.h"
+#include "Lfo.h"
+
+class LedcOutput
+{
+    public:
+        LedcOutput(uint8_t pin, uint8_t channel) : _pin(pin), _channel(channel) {};
+        void begin();
+        void setLevel(uint32_t volume, TIMBRE timbre);
+        void noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration);
+        void noteOff(uint32_t ms);
+        void setTuning(TuningTable *tuning);
+        void setPortamento(GlideEngine *glide, uint32_t msPortamento);
+        void setLfo(Lfo *lfo);
+        bool glide(float from, float to, uint32_t ms, GLIDE curve, bool pingPong);
+
+    private:
+        uint8_t  _pin;
+        uint8_t  _channel;
+        uint32_t _level       = 0; // pulse width for volume and timbre as fraction of the period Q16
+        uint32_t _duty        = 0; // duty cycle of the playing note
+        uint8_t  _resolution  = LEDC_NOTE_RESOLUTION;
+        bool     _sounding    = false; // a note (not a rest) is playing
+        TuningTable *_tuning  = nullptr;  // nullptr plays the notes with ledcWriteNote()
+        GlideEngine *_glide   = nullptr;
+        Lfo         *_lfo     = nullptr;
+        uint32_t   _msPortamento = 0;
+        float      _frequency = 0.0f;    // frequency of the previous note, 0 after a rest
+};
+#endif
@@ -0,0 +1,174 @@
+/**
+ * Class        Lfo.cpp
+ *
+ * Purpose      Implements vibrato and tremolo of a ledc channel. The interrupt
+ *              writes the swung divider into the timer configuration register
+ *              and the swung duty cycle into the duty register of the channel,
+ *              the register values are prepared by noteOn().
+ *
+ * References   ESP32 Technical Reference Manual, chapter LED PWM Controller
+ */
+#ifdef ARDUINO   // drives the ESP32 hardware, not part of the native build
+#include <math.h>
+#include <soc/ledc_reg.h>
+#include "Lfo.h"
+#include "TuningTable.h"
+#include "ControlTimer.h"
+
+#define CHANNEL_STRIDE 0x14  // bytes between the registers of two channels
+#define DUTY_UPDATE    (LEDC_DUTY_START_HSCH0 | LEDC_DUTY_INC_HSCH0 | (1 << LEDC_DUTY_NUM_HSCH0_S) | (1 << LEDC_DUTY_CYCLE_HSCH0_S))
+
+// One period of the sine in Q15, read in the interrupt, so it must be in RAM
+static const DRAM_ATTR int16_t sine[256] =
+{
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+      6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+     18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+     27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+     32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+     32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+     27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+     18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+      6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+     -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+    -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+    -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+    -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+     -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804
+};
+
+Lfo::Lfo(uint8_t channel) : _channel(channel)
+{
+    uint32_t offset = CHANNEL_STRIDE * (channel % 8);
+    _timerReg = TuningTable::timerRegister(channel);
+    _conf0Reg = (volatile uint32_t *)(((channel >= 8) ? LEDC_LSCH0_CONF0_REG : LEDC_HSCH0_CONF0_REG) + offset);
+    _dutyReg  = (volatile uint32_t *)(((channel >= 8) ? LEDC_LSCH0_DUTY_REG  : LEDC_HSCH0_DUTY_REG)  + offset);
+    _conf1Reg = (volatile uint32_t *)(((channel >= 8) ? LEDC_LSCH0_CONF1_REG : LEDC_HSCH0_CONF1_REG) + offset);
+}
+
+/**
+ * Start the control timer if necessary and attach the LFO
+ */
+bool Lfo::begin()
+{
+    if (_attached) return true;
+    if (ControlTimer::rate() == 0 && ! ControlTimer::begin()) return false;
+    _attached = ControlTimer::attach(&Lfo::tick, this);
+    return _attached;
+}
+
+/**
+ * Detach the LFO from the control timer
+ */
+void Lfo::end()
+{
+    _active = false;
+    if (_attached) ControlTimer::detach(&Lfo::tick, this);
+    _attached = false;
+}
+
+/**
+ * Return the phase increment per tick of the control timer for rateHz
+ */
+uint32_t Lfo::phaseIncrement(float rateHz)
+{
+    return (uint32_t)((double)constrain(rateHz, 0.1f, 20.0f) * 4294967296.0 / ControlTimer::rate());
+}
+
+/**
+ * Swing the frequency rateHz times per second by cents up and down, 0 cents = off
+ */
+void Lfo::setVibrato(float rateHz, uint16_t cents)
+{
+    if (! begin()) return;
+    _vibInc   = phaseIncrement(rateHz);
+    _vibDepth = (int32_t)lroundf((exp2f(min(cents, (uint16_t)LFO_MAX_CENTS) / 1200.0f) - 1.0f) * 65536.0f);
+}
+
+/**
+ * Reduce the volume rateHz times per second by up to percent of the duty cycle, 0 = off
+ */
+void Lfo::setTremolo(float rateHz, uint8_t percent)
+{
+    if (! begin()) return;
+    _tremInc   = phaseIncrement(rateHz);
+    _tremDepth = min(percent, (uint8_t)100) * 32767 / 100;
+}
+
+/**
+ * Modulate the note with frequency (Hz) and duty cycle duty (10 bit)
+ * which the player has written to the channel. A REST has duty 0
+ */
+void Lfo::noteOn(float frequency, uint32_t duty)
+{
+    _active = false;
+    if (frequency <= 0.0f || duty == 0) return;
+
+    uint32_t div = TuningTable::divider(frequency);
+    _div      = div & ~TUNING_REF_TICK;
+    _confBase = TuningTable::timerConfig(div, _channel) & ~(LEDC_DIV_NUM_HSTIMER0_V << LEDC_DIV_NUM_HSTIMER0_S);
+    _duty     = duty;
+    _active   = _attached;
+}
+
+/**
+ * Change the duty cycle of the sounding note, e.g. for a new timbre
+ */
+void Lfo::setDuty(uint32_t duty)
+{
+    _duty = duty;
+}
+
+/**
+ * Stop modulating before the player switches off the note
+ */
+void Lfo::noteOff()
+{
+    _active = false;
+}
+
+/**
+ * Called by the ControlTimer, advances the phases and writes 
+ * the swung divider and duty cycle
+ */
+void IRAM_ATTR Lfo::tick(void *arg)
+{
+    Lfo *l = (Lfo *)arg;
+    if (! l->_active) return;
+
+    if (l->_vibDepth)
+    {
+        l->_vibPhase += l->_vibInc;
+        int32_t  swing = (sine[l->_vibPhase >> 24] * l->_vibDepth) >> 15;  // fraction of the divider in Q16
+        uint32_t div   = l->_div + (((int32_t)l->_div * swing) >> 16);
+        *l->_timerReg  = l->_confBase | (min(div, (uint32_t)LEDC_DIV_NUM_HSTIMER0_V) << LEDC_DIV_NUM_HSTIMER0_S);
+    }
+    if (l->_tremDepth)
+    {
+        l->_tremPhase += l->_tremInc;
+        int32_t  cut  = (l->_tremDepth * (32767 - sine[l->_tremPhase >> 24])) >> 16;  // 0..depth in Q15
+        uint32_t duty = l->_duty - ((l->_duty * cut) >> 15);
+        *l->_dutyReg  = duty << 4;  // the duty register has 4 fraction bits
+        *l->_conf1Reg = DUTY_UPDATE;
+        if (l->_channel >= 8) *l->_conf0Reg |= LEDC_PARA_UP_LSCH0;
+    }
+}
+#endif
@@ -0,0 +1,58 @@
+/**
+ * Header       Lfo.h
+ *
+ * Purpose      Declaration of the class Lfo, a low frequency oscillator which adds
+ *              vibrato (the frequency swings around the note) and tremolo (the
+ *              volume swings) to the tone of a ledc channel. Each channel (voice)
+ *              has its own Lfo, all are driven by the ControlTimer interrupt, so
+ *              the modulation is steady whatever the main loop is doing.
+ *
+ *              Both LFOs walk a sine table in fixed point with a 32 bit phase, 
+ *              a tick costs a few multiplications and a register write per LFO.
+ *              noteOn() gets frequency and duty cycle of the note from the 
+ *              MelodyPlayer and converts them to the timer divider once.
+ *              Don't combine vibrato with portamento, both write the timer.
+ *
+ * Constructor
+ * arguments    channel     ESP32 pwm channel, set up with 10 bit resolution
+ */
+#ifndef _LFO_H_
+#define _LFO_H_
+#include "MelodyTypes.h"
+
+#define LFO_MAX_CENTS   100  // deepest vibrato, a semitone up and down
+
+class Lfo
+{
+    public:
+        Lfo(uint8_t channel);
+        bool begin();
+        void end();
+        void setVibrato(float rateHz, uint16_t cents);
+        void setTremolo(float rateHz, uint8_t percent);
+        void noteOn(float frequency, uint32_t duty);
+        void setDuty(uint32_t duty);
+        void noteOff();
+
+    private:
+        static void tick(void *arg);
+        uint32_t phaseIncrement(float rateHz);
+
+        uint8_t  _channel;
+        volatile uint32_t *_timerReg;    // configuration register of the ledc timer
+        volatile uint32_t *_dutyReg;     // duty register of the ledc channel
+        volatile uint32_t *_conf0Reg;    // configuration registers of the ledc channel
+        volatile uint32_t *_conf1Reg;
+        volatile bool _active  = false;  // a note is sounding
+        bool     _attached     = false;
+        uint32_t _vibPhase     = 0;      // phase 0..2^32 for 0..360 degrees
+        uint32_t _vibInc       = 0;      // phase increment per tick
+        int32_t  _vibDepth     = 0;      // swing of the divider in Q16
+        uint32_t _tremPhase    = 0;
+        uint32_t _tremInc      = 0;
+        int32_t  _tremDepth    = 0;      // reduction of the duty cycle at the lowest point in Q15
+        uint32_t _div          = 0;      // divider of the note without the clock source flag
+        uint32_t _confBase     = 0;      // timer configuration of the note without the divider
+        uint32_t _duty         = 0;      // duty cycle of the note
+};
+#endif
@@ -0,0 +1,386 @@
+/**
+ * Class        MelodyArena.cpp
+ *
+ * Purpose      Implements the melody arena, its reference counted handles and the
+ *              NoteSource ArenaMelody. Blocks and entries are taken from and given
+ *              back to their free lists under a spinlock, so handles may be copied
+ *              and released in other tasks. The notes of a melody are appended by
+ *              one task before it is played.
+ */
+#include "MelodyArena.h"
+#include "Songbook.h"
+
+// Kind of a control word, its value is in the length byte
+#define CONTROL_TEMPO   0   // 0..3, the kind holds bits 8 and 9 of the tempo
+#define CONTROL_VOLUME  4
+#define CONTROL_BAR     5
+#define PACKED_MAX_LEN  255 // longest note of a packed note
+
+MelodyArena::MelodyArena()
+{
+    for (int i = 0; i < ARENA_BLOCKS; i++) _block[i].next = (i + 1 < ARENA_BLOCKS) ? i + 1 : ARENA_NONE;
+    for (int i = 0; i < ARENA_MELODIES; i++) _entry[i].first = (i + 1 < ARENA_MELODIES) ? i + 1 : ARENA_NONE;
+}
+
+void MelodyArena::lock()
+{
+#ifdef ARDUINO
+    portENTER_CRITICAL(&_mux);
+#endif
+}
+
+void MelodyArena::unlock()
+{
+#ifdef ARDUINO
+    portEXIT_CRITICAL(&_mux);
+#endif
+}
+
+/**
+ * Create an empty melody, its notes are added with append().
+ * Returns an invalid handle when all entries are in use
+ */
+MelodyHandle MelodyArena::create()
+{
+    lock();
+    uint16_t slot = _freeEntry;
+    if (slot == ARENA_NONE)
+    {
+        _stats.failed++;
+        unlock();
+        return MelodyHandle();
+    }
+    _freeEntry = _entry[slot].first;
+    _entry[slot] = { ARENA_NONE, ARENA_NONE, 0, 1, 0, -1, 0 };
+    _stats.loads++;
+    _stats.melodies++;
+    if (_stats.melodies > _stats.melodiesHigh) _stats.melodiesHigh = _stats.melodies;
+    unlock();
+    return MelodyHandle(this, slot);
+}
+
+/**
+ * Copy all notes of the source into a new melody, with the tempo, volume and
+ * bar length the source reports after its first note. Changes reported after
+ * a later note are stored as control words before it. Returns an invalid
+ * handle when the melody does not fit, nothing is kept of it then
+ */
+MelodyHandle MelodyArena::load(NoteSource &source)
+{
+    MelodyHandle melody = create();
+    musicNote    n;
+
+    if (! melody.valid()) return melody;
+    source.rewind();
+    Entry &e = _entry[melody._slot];
+    int tempo = 0, volume = -1, barLength = 0;
+    while (source.nextNote(n))
+    {
+        bool first = (melody.length() == 0);
+        bool ok    = true;
+        if (source.tempo() > 0 && source.tempo() != tempo)
+        {
+            tempo = min(source.tempo(), 1023);
+            if (first) e.tempo = tempo;
+            else ok = appendControl(melody._slot, CONTROL_TEMPO + (tempo >> 8), tempo & 0xFF);
+        }
+        if (source.volume() >= 0 && source.volume() != volume)
+        {
+            volume = min(source.volume(), 100);
+            if (first) e.volume = volume;
+            else ok = ok && appendControl(melody._slot, CONTROL_VOLUME, volume);
+        }
+        if (source.barLength() > 0 && source.barLength() != barLength)
+        {
+            barLength = min(source.barLength(), 255);
+            if (first) e.barLength = barLength;
+            else ok = ok && appendControl(melody._slot, CONTROL_BAR, barLength);
+        }
+        if (! ok || ! melody.append(n))
+        {
+            melody.release();
+            break;
+        }
+    }
+    source.rewind();
+    return melody;
+}
+
+/**
+ * Copy the array of len notes into a new melody
+ */
+MelodyHandle MelodyArena::load(const musicNote m[], int len, int tempo)
+{
+    MelodyHandle melody = create();
+
+    if (! melody.valid()) return melody;
+    _entry[melody._slot].tempo = max(tempo, 0);
+    for (int i = 0; i < len; i++)
+    {
+        if (! melody.append(m[i]))
+        {
+            melody.release();
+            break;
+        }
+    }
+    return melody;
+}
+
+/**
+ * Return the percentage of the note places in the blocks in use which are
+ * not used, the unused part of the last block of each melody
+ */
+uint32_t MelodyArena::wastePercent()
+{
+    ArenaStats s = _stats;
+    return s.blocks ? 100 - s.notes * 100 / ((uint32_t)s.blocks * ARENA_BLOCK_NOTES) : 0;
+}
+
+/**
+ * Start the high-water marks at the actual use
+ */
+void MelodyArena::resetHighWater()
+{
+    lock();
+    _stats.blocksHigh   = _stats.blocks;
+    _stats.melodiesHigh = _stats.melodies;
+    unlock();
+}
+
+void MelodyArena::retain(uint16_t slot)
+{
+    lock();
+    _entry[slot].refs++;
+    unlock();
+}
+
+/**
+ * Drop a reference. The last one gives the chain of blocks back to the free
+ * list at once and the entry to the free entries
+ */
+void MelodyArena::release(uint16_t slot)
+{
+    lock();
+    Entry &e = _entry[slot];
+    if (--e.refs == 0)
+    {
+        if (e.first != ARENA_NONE)
+        {
+            _block[e.last].next = _freeBlock;
+            _freeBlock = e.first;
+            _stats.blocks -= (e.length + ARENA_BLOCK_NOTES - 1) / ARENA_BLOCK_NOTES;
+            _stats.notes  -= e.length;
+        }
+        e.first    = _freeEntry;
+        _freeEntry = slot;
+        _stats.melodies--;
+    }
+    unlock();
+}
+
+/**
+ * Add a note to the end of the melody. A note longer than PACKED_MAX_LEN is 
+ * split into parts. Returns false when the arena is full
+ */
+bool MelodyArena::append(uint16_t slot, musicNote n)
+{
+    uint32_t len = (uint32_t)n.value;
+    if (len > PACKED_MAX_LEN && n.note != REST)
+    {
+        lock();
+        _stats.failed++;    // the note is struck again for each part
+        unlock();
+    }
+    for (; len > PACKED_MAX_LEN; len -= PACKED_MAX_LEN)
+    {
+        musicNote part = { n.note, n.octave, (N_LEN)PACKED_MAX_LEN };
+        if (! appendPacked(slot, PACK_NOTE(part))) return false;
+    }
+    n.value = (N_LEN)len;
+    return appendPacked(slot, PACK_NOTE(n));
+}
+
+/**
+ * Add a change of tempo, volume or bar length to the end of the melody
+ */
+bool MelodyArena::appendControl(uint16_t slot, uint8_t kind, uint16_t value)
+{
+    return appendPacked(slot, (uint16_t)(value << 8 | kind << 4 | PACKED_CONTROL));
+}
+
+/**
+ * Add a packed word to the end of the melody, takes a new block when the last 
+ * one is full. Returns false when the arena is full
+ */
+bool MelodyArena::appendPacked(uint16_t slot, uint16_t p)
+{
+    Entry   &e      = _entry[slot];
+    uint16_t offset = e.length % ARENA_BLOCK_NOTES;
+
+    if (e.length == UINT16_MAX) return false;
+    if (offset == 0)
+    {
+        lock();
+        uint16_t b = _freeBlock;
+        if (b == ARENA_NONE)
+        {
+            _stats.failed++;
+            unlock();
+            return false;
+        }
+        _freeBlock     = _block[b].next;
+        _block[b].next = ARENA_NONE;
+        if (e.first == ARENA_NONE) e.first = b;
+        else _block[e.last].next = b;
+        e.last = b;
+        _stats.blocks++;
+        if (_stats.blocks > _stats.blocksHigh) _stats.blocksHigh = _stats.blocks;
+        unlock();
+    }
+    _block[e.last].note[offset] = p;
+    lock();
+    e.length++;
+    _stats.notes++;
+    unlock();
+    return true;
+}
+
+MelodyHandle::MelodyHandle(const MelodyHandle &other) : _arena(other._arena), _slot(other._slot)
+{
+    if (_arena) _arena->retain(_slot);
+}
+
+MelodyHandle &MelodyHandle::operator=(const MelodyHandle &other)
+{
+    MelodyArena *arena = other._arena;  // other may be this
+    uint16_t     slot  = other._slot;
+    if (arena) arena->retain(slot);
+    release();
+    _arena = arena;
+    _slot  = slot;
+    return *this;
+}
+
+MelodyHandle &MelodyHandle::operator=(MelodyHandle &&other)
+{
+    if (this != &other)
+    {
+        release();
+        _arena = other._arena;
+        _slot  = other._slot;
+        other._arena = nullptr;
+    }
+    return *this;
+}
+
+/**
+ * Drop the reference to the melody, the handle is invalid afterwards
+ */
+void MelodyHandle::release()
+{
+    if (_arena) _arena->release(_slot);
+    _arena = nullptr;
+}
+
+bool MelodyHandle::append(musicNote n)
+{
+    return _arena ? _arena->append(_slot, n) : false;
+}
+
+uint16_t MelodyHandle::length() const
+{
+    return _arena ? _arena->_entry[_slot].length : 0;
+}
+
+int MelodyHandle::tempo() const
+{
+    return _arena ? _arena->_entry[_slot].tempo : 0;
+}
+
+int MelodyHandle::volume() const
+{
+    return _arena ? _arena->_entry[_slot].volume : -1;
+}
+
+int MelodyHandle::barLength() const
+{
+    return _arena ? _arena->_entry[_slot].barLength : 0;
+}
+
+/**
+ * Play another melody of the arena, the previous one is released
+ */
+void ArenaMelody::setMelody(const MelodyHandle &melody)
+{
+    _melody = melody;
+    rewind();
+}
+
+/**
+ * Take the next packed word and move on to the next block at the end of a block
+ */
+uint16_t ArenaMelody::take()
+{
+    const MelodyArena::Block &block = _melody._arena->_block[_block];
+    uint16_t p = block.note[_index++ % ARENA_BLOCK_NOTES];
+    if (_index % ARENA_BLOCK_NOTES == 0) _block = block.next;
+    return p;
+}
+
+/**
+ * Apply a control word
+ */
+void ArenaMelody::control(uint16_t p)
+{
+    uint8_t kind = PACKED_OCTAVE(p);
+    if (kind <= CONTROL_TEMPO + 3) _tempo = (kind - CONTROL_TEMPO) << 8 | PACKED_LEN(p);
+    else if (kind == CONTROL_VOLUME) _volume = PACKED_LEN(p);
+    else if (kind == CONTROL_BAR)    _barLength = PACKED_LEN(p);
+}
+
+/**
+ * Unpack the next note, control words before it change tempo, volume or bar
+ * length. Returns false at the end of the melody
+ */
+bool ArenaMelody::nextNote(musicNote &n)
+{
+    while (_index < _melody.length())
+    {
+        uint16_t p = take();
+        if ((p & 0x0F) == PACKED_CONTROL)
+        {
+            control(p);
+            continue;
+        }
+        n.note   = PACKED_NOTE(p);
+        n.octave = PACKED_OCTAVE(p);
+        n.value  = (N_LEN)PACKED_LEN(p);
+        return true;
+    }
+    return false;
+}
+
+void ArenaMelody::rewind()
+{
+    _index     = 0;
+    _block     = _melody.valid() ? _melody._arena->_entry[_melody._slot].first : ARENA_NONE;
+    _tempo     = _melody.tempo();
+    _volume    = _melody.volume();
+    _barLength = _melody.barLength();
+}
+
+/**
+ * Continue with the note at index. Reads the words before it for the tempo,
+ * volume and bar length which apply there
+ */
+bool ArenaMelody::seek(int index)
+{
+    if (index < 0 || index > _melody.length()) return false;
+    rewind();
+    while (_index < index)
+    {
+        uint16_t p = take();
+        if ((p & 0x0F) == PACKED_CONTROL) control(p);
+    }
+    return true;
+}
@@ -0,0 +1,156 @@
+/**
+ * Header       MelodyArena.h
+ *
+ * Purpose      Declaration of the class MelodyArena, a fixed memory for melodies which
+ *              are loaded at runtime (from Serial, a file or a parser), so that
+ *              loading and replacing melodies never fragments the heap.
+ *
+ *              The arena is a static array of ARENA_BLOCKS blocks of 32 bytes, each
+ *              holds ARENA_BLOCK_NOTES packed notes (see Songbook.h). A melody is a
+ *              chain of blocks, free blocks are kept in a free list. Taking a block
+ *              and giving back the whole chain of a melody are O(1), and as all
+ *              blocks have the same size a melody fits as long as there are enough
+ *              free blocks (no external fragmentation). What is lost is the unused
+ *              part of the last block of each melody, stats() reports it.
+ *
+ *              load(NoteSource &) keeps what the source reports before its first note
+ *              in the entry of the melody, a later change of tempo, volume or bar
+ *              length (MML T and V, ABC Q: and M:) as a control word in the chain
+ *              of notes, which ArenaMelody applies when it reaches it. A note longer
+ *              than a packed note (255 64ths) is split, a rest exactly, a sounding
+ *              note is struck again for each part and counted in stats().failed.
+ *
+ *              A MelodyHandle counts the references to its melody, the blocks are
+ *              given back when the last handle is released. ArenaMelody plays a
+ *              melody of the arena and holds a handle, so a melody can be replaced
+ *              while it is still playing.
+ */
+#ifndef _MELODYARENA_H_
+#define _MELODYARENA_H_
+#include "NoteSource.h"
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#endif
+
+#define ARENA_BLOCKS      64    // blocks of the arena
+#define ARENA_BLOCK_NOTES 15    // packed notes per block, a block has 32 bytes
+#define ARENA_MELODIES    16    // melodies in the arena at the same time
+#define ARENA_NONE        0xFFFF
+
+typedef struct
+{
+    uint16_t blocks;        // blocks in use
+    uint16_t blocksHigh;    // most blocks in use at the same time
+    uint16_t melodies;      // melodies in use
+    uint16_t melodiesHigh;  // most melodies in use at the same time
+    uint32_t notes;         // notes and control words stored in the blocks in use
+    uint32_t loads;         // melodies created
+    uint32_t failed;        // melodies or notes which did not fit, notes which were split
+} ArenaStats;
+
+class MelodyArena;
+
+class MelodyHandle
+{
+    public:
+        MelodyHandle() {};
+        MelodyHandle(const MelodyHandle &other);
+        MelodyHandle(MelodyHandle &&other) : _arena(other._arena), _slot(other._slot) { other._arena = nullptr; };
+        MelodyHandle &operator=(const MelodyHandle &other);
+        MelodyHandle &operator=(MelodyHandle &&other);
+        ~MelodyHandle() { release(); };
+        bool     valid() const { return _arena != nullptr; };
+        bool     append(musicNote n);
+        uint16_t length() const;
+        int      tempo() const;
+        int      volume() const;
+        int      barLength() const;
+        void     release();
+
+    private:
+        friend class MelodyArena;
+        friend class ArenaMelody;
+        MelodyHandle(MelodyArena *arena, uint16_t slot) : _arena(arena), _slot(slot) {};
+
+        MelodyArena *_arena = nullptr;
+        uint16_t     _slot  = ARENA_NONE;
+};
+
+class MelodyArena
+{
+    public:
+        MelodyArena();
+        MelodyHandle create();
+        MelodyHandle load(NoteSource &source);
+        MelodyHandle load(const musicNote m[], int len, int tempo = 0);
+        ArenaStats   stats() { return _stats; };
+        uint32_t     freeNotes() { return (uint32_t)(ARENA_BLOCKS - _stats.blocks) * ARENA_BLOCK_NOTES; };
+        uint32_t     wastePercent();
+        void         resetHighWater();
+
+    private:
+        friend class MelodyHandle;
+        friend class ArenaMelody;
+
+        typedef struct
+        {
+            uint16_t next;                      // next block of the melody or of the free list
+            uint16_t note[ARENA_BLOCK_NOTES];   // packed notes
+        } Block;
+
+        typedef struct
+        {
+            uint16_t first;     // first block, next free entry when the entry is free
+            uint16_t last;      // last block
+            uint16_t length;    // number of notes
+            uint16_t refs;      // handles to the melody
+            int16_t  tempo;     // as reported by the source, 0 = keep the player's tempo
+            int8_t   volume;    // -1 = keep the player's volume
+            uint8_t  barLength;
+        } Entry;
+
+        void     retain(uint16_t slot);
+        void     release(uint16_t slot);
+        bool     append(uint16_t slot, musicNote n);
+        bool     appendControl(uint16_t slot, uint8_t kind, uint16_t value);
+        bool     appendPacked(uint16_t slot, uint16_t p);
+        void     lock();
+        void     unlock();
+
+        Block    _block[ARENA_BLOCKS];
+        Entry    _entry[ARENA_MELODIES];
+        uint16_t _freeBlock = 0;
+        uint16_t _freeEntry = 0;
+        ArenaStats _stats   = { 0 };
+#ifdef ARDUINO
+        portMUX_TYPE _mux   = portMUX_INITIALIZER_UNLOCKED;
+#endif
+};
+
+class ArenaMelody : public NoteSource
+{
+    public:
+        ArenaMelody() {};
+        ArenaMelody(const MelodyHandle &melody) : _melody(melody) { rewind(); };
+        void setMelody(const MelodyHandle &melody);
+        const MelodyHandle &melody() { return _melody; };
+        bool nextNote(musicNote &n) override;
+        void rewind() override;
+        int  tempo() override { return _tempo; };
+        int  volume() override { return _volume; };
+        int  barLength() override { return _barLength; };
+        int  position() override { return _index; };
+        bool seek(int index) override;
+
+    private:
+        uint16_t take();
+        void     control(uint16_t p);
+
+        MelodyHandle _melody;
+        uint16_t     _block  = ARENA_NONE;  // block of the next note
+        uint16_t     _index  = 0;           // index of the next note or control word
+        int16_t      _tempo  = 0;           // as changed by the control words up to _index
+        int8_t       _volume = -1;
+        uint8_t      _barLength = 0;
+};
+#endif
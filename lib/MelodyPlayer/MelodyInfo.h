@@ -0,0 +1,100 @@
+/**
+ * Header       MelodyInfo.h
+ *
+ * Purpose      Metadata of a melody computed at compile time: number of notes and
+ *              rests, length in 64ths, pitch range. The constexpr functions work on
+ *              constexpr arrays of musicNote, packedInfo() in Songbook.h on packed
+ *              melodies. The songbook holds a MelodyInfo of each melody in flash,
+ *              so nothing has to be played to know e.g. how long a melody lasts
+ *              at a tempo.
+ *
+ *              The functions are written for C++11 (one return statement), they
+ *              split the array into halves, so the recursion is only log2 of the
+ *              number of notes deep.
+ *
+ * Example      constexpr musicNote tune[] = { { NOTE_A, 4, N_LEN::N4 }, { REST, 4, N_LEN::N4 } };
+ *              constexpr MelodyInfo info = melodyInfo(tune);
+ *              static_assert(info.length64 == 32, "two quarters");
+ *              uint32_t ms = melodyMs(info, 114, player.getLegato());
+ */
+#ifndef _MELODYINFO_H_
+#define _MELODYINFO_H_
+#include "MelodyTypes.h"
+
+#define INFO_PITCH(note, octave)  ((uint8_t)((octave) * 12 + (note)))  // semitones from C0
+#define INFO_NOTE(pitch)          ((note_t)((pitch) % 12))
+#define INFO_OCTAVE(pitch)        ((uint8_t)((pitch) / 12))
+#define INFO_NO_PITCH             255   // lowest of a melody without notes
+
+typedef struct
+{
+    uint32_t length64;  // duration in 64ths
+    uint32_t rest64;    // 64ths of rests
+    uint16_t notes;     // notes and rests
+    uint16_t rests;
+    uint8_t  lowest;    // INFO_PITCH() of the lowest note, INFO_NO_PITCH when there is none
+    uint8_t  highest;   // INFO_PITCH() of the highest note, 0 when there is none
+} MelodyInfo;
+
+constexpr MelodyInfo emptyInfo() { return MelodyInfo{ 0, 0, 0, 0, INFO_NO_PITCH, 0 }; }
+
+/**
+ * Info of a single note given by its code (REST or NOTE_x), octave and length in 64ths
+ */
+constexpr MelodyInfo noteInfo(uint8_t note, uint8_t octave, uint32_t len64)
+{
+    return note == REST ? MelodyInfo{ len64, len64, 1, 1, INFO_NO_PITCH, 0 }
+                        : MelodyInfo{ len64, 0, 1, 0, INFO_PITCH(note, octave), INFO_PITCH(note, octave) };
+}
+
+/**
+ * Info of the melody a followed by b
+ */
+constexpr MelodyInfo joinInfo(MelodyInfo a, MelodyInfo b)
+{
+    return MelodyInfo{ a.length64 + b.length64, a.rest64 + b.rest64,
+                       (uint16_t)(a.notes + b.notes), (uint16_t)(a.rests + b.rests),
+                       a.lowest < b.lowest ? a.lowest : b.lowest, a.highest > b.highest ? a.highest : b.highest };
+}
+
+/**
+ * Info of the notes m[from] up to m[to - 1]
+ */
+constexpr MelodyInfo melodyInfo(const musicNote m[], int from, int to)
+{
+    return to - from <= 0 ? emptyInfo()
+         : to - from == 1 ? noteInfo(m[from].note, m[from].octave, (uint32_t)m[from].value)
+         : joinInfo(melodyInfo(m, from, (from + to) / 2), melodyInfo(m, (from + to) / 2, to));
+}
+
+template <int N>
+constexpr MelodyInfo melodyInfo(const musicNote (&m)[N]) { return melodyInfo(m, 0, N); }
+
+/**
+ * Duration in ms of the melody at tempo quarter notes per minute as the player
+ * plays it with setLegato(msGap): each note and rest is followed by the gap and
+ * ends 1 ms after its length, because the player stops it only when the length
+ * is exceeded. The player truncates the length of each note to whole ms, so the
+ * melody may be up to 1 ms per note shorter than computed.
+ */
+constexpr uint32_t melodyMs(MelodyInfo info, uint32_t tempo, uint32_t msGap = 10)
+{
+    return tempo ? (uint32_t)((uint64_t)info.length64 * 60000 / N4_LEN / tempo) + info.notes * (msGap + 1) : 0;
+}
+
+/**
+ * Percentage of the duration which is rests
+ */
+constexpr uint32_t restPercent(MelodyInfo info)
+{
+    return info.length64 ? info.rest64 * 100 / info.length64 : 0;
+}
+
+/**
+ * Pitch range in semitones, 0 for a melody without notes
+ */
+constexpr uint8_t pitchRange(MelodyInfo info)
+{
+    return info.highest >= info.lowest ? info.highest - info.lowest : 0;
+}
+#endif
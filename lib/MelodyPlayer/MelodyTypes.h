@@ -0,0 +1,46 @@
+/**
+ * Header       MelodyTypes.h
+ * Author       2021-08-28 Charles Geiser (https://www.dodeka.ch)
+ * 
+ * Purpose      Types to write down melodies: tempo, note values and the musicNote.
+ *              Without the Arduino core (ARDUINO not defined) note_t, IRAM_ATTR and
+ *              the helpers min, max and constrain are defined here.
+ */
+#ifndef _MELODYTYPES_H_
+#define _MELODYTYPES_H_
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+// Host build (e.g. benchmarks on the PC): the types and helpers of the Arduino core which are used
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define IRAM_ATTR
+typedef enum { NOTE_C, NOTE_Cs, NOTE_D, NOTE_Eb, NOTE_E, NOTE_F, NOTE_Fs, NOTE_G, NOTE_Gs, NOTE_A, NOTE_Bb, NOTE_B, NOTE_MAX } note_t;
+#endif
+
+#define REST NOTE_MAX
+
+// Tempo given as number of quarter notes per minute
+enum class TEMPO   { LARGO=50, LARGHETTO=63, ADAGIO=71, ANDANTE=92, MODERATO=114, ALLEGRO=144, PRESTO=184, PRESTISSIMO=204 };
+
+// Note values (example: N4d is a dotted quarter note, N2 is a half note)
+enum class N_LEN { N64=1, N32=2, N32d=3, N16=4, N16d=6, N8=8, N8d=12, N4=16, N4d=24, N2=32, N2d=48, N1=64, N1d=96 };
+const uint32_t N4_LEN = 16;
+
+// Timbre of the ledc output given by the pulse width of the square wave (chip-tune style)
+enum class TIMBRE { PULSE_12, PULSE_25, PULSE_50 };
+// Curve of a glide (see GlideEngine.h): equal steps in frequency or in pitch
+enum class GLIDE { LINEAR, EXPONENTIAL };
+
+#define LEDC_NOTE_RESOLUTION 10  // ledcWriteNote() sets the timer to 10 bit
+
+// A musicNote is defined as a NOTE_x, in octave octave, 
+// with duration defined as its weight in 64ths.
+// Example: { NOTE_A, 4, N_LEN::N4d } is the concert pitch 440 Hz as a dotted quarter note
+typedef struct { note_t note; uint8_t octave; N_LEN value; } musicNote;
+#endif
@@ -0,0 +1,166 @@
+/**
+ * Class        MmlInterpreter.cpp
+ *
+ * Purpose      Implements an interpreter for the Music Macro Language. Each call of
+ *              nextNote() executes the commands up to the next note or rest. Loops
+ *              are executed by jumping back in the text, so only the loop start and
+ *              the remaining count are kept per nesting level.
+ *
+ * References   https://en.wikipedia.org/wiki/Music_Macro_Language
+ */
+#include "MmlInterpreter.h"
+#include "VolumeTaper.h"
+
+#define LOOP_OPEN 255  // the count of a loop is not known before its ] is reached
+
+static const uint8_t semitone[7] = { 9, 11, 0, 2, 4, 5, 7 };  // A B C D E F G
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+static char toUpper(char c) { return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c; }
+
+static uint32_t parseNumber(const char *&p, uint32_t dflt, uint32_t limit = UINT16_MAX)
+{
+    if (! isDigit(*p)) return dflt;
+    uint32_t n = 0;
+    while (isDigit(*p)) n = 10 * n + (*p++ - '0');
+    return (n < limit) ? n : limit;
+}
+
+/**
+ * Set the MML text and rewind
+ */
+void MmlInterpreter::setText(const char *mml)
+{
+    _text = mml;
+    rewind();
+}
+
+/**
+ * Reset octave, length, tempo and volume and
+ * start again with the first command
+ */
+void MmlInterpreter::rewind()
+{
+    _pos    = _text;
+    _octave = 4;
+    _length = 4;
+    _volume = 255;
+    _tempo  = 0;
+    _time   = 0;
+    _depth  = 0;
+}
+
+/**
+ * Map V0..15 to the volume range 0..100 of the player
+ */
+int MmlInterpreter::volume()
+{
+    return (_volume == 255) ? -1 : _volume * VOLUME_MAX / 15;
+}
+
+/**
+ * Read an optional length and dots following a note or rest.
+ * Returns the length in 192ths of a whole note
+ */
+uint32_t MmlInterpreter::parseLength()
+{
+    uint32_t n   = parseNumber(_pos, _length, 64);
+    uint32_t len = 192 / (n ? n : 1);
+    uint32_t dot = len;
+
+    while (*_pos == '.')
+    {
+        dot /= 2;
+        len += dot;
+        _pos++;
+    }
+    return len;
+}
+
+/**
+ * Convert len from 192ths to 64ths, carrying the rounding error into the next note
+ */
+bool MmlInterpreter::emit(musicNote &n, int pitch, int octave, uint32_t len)
+{
+    uint32_t len64 = (_time + len) / 3 - _time / 3;
+    _time += len;
+    if (len64 == 0) return false;
+    n.note   = (note_t)pitch;
+    n.octave = (uint8_t)constrain(octave, 0, 8);
+    n.value  = (N_LEN)len64;
+    return true;
+}
+
+/**
+ * Execute the commands up to the next note or rest.
+ * Returns false at the end of the text
+ */
+bool MmlInterpreter::nextNote(musicNote &n)
+{
+    if (_pos == nullptr) return false;
+
+    while (*_pos != '\0')
+    {
+        char c = toUpper(*_pos++);
+        int  pitch  = REST;
+        int  octave = _octave;
+
+        switch(c)
+        {
+            case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+                pitch = semitone[c - 'A'];
+                while (*_pos == '+' || *_pos == '#' || *_pos == '-')
+                {
+                    pitch += (*_pos++ == '-') ? -1 : 1;
+                }
+                if (pitch < 0)   { pitch += 12; octave--; }
+                if (pitch >= 12) { pitch -= 12; octave++; }
+                if (emit(n, pitch, octave, parseLength())) return true;
+                break;
+            case 'R':
+            case 'P':
+                if (emit(n, REST, octave, parseLength())) return true;
+                break;
+            case 'N':
+            {
+                uint32_t number = parseNumber(_pos, 0, 107);
+                uint32_t len    = 192 / _length;
+                if (number > 0 && emit(n, number % 12, number / 12, len)) return true;
+                if (number == 0 && emit(n, REST, octave, len)) return true;  // N0 is a rest
+                break;
+            }
+            case 'O': _octave = parseNumber(_pos, _octave, 8);       break;
+            case '>': if (_octave < 8) _octave++;                   break;
+            case '<': if (_octave > 0) _octave--;                   break;
+            case 'L': _length = max(1u, parseNumber(_pos, 4, 64));  break;
+            case 'T': _tempo  = max(20u, parseNumber(_pos, 120, 255)); break;
+            case 'V': _volume = parseNumber(_pos, 8, 15);           break;
+            case '[':
+                if (_depth < MML_LOOP_DEPTH)
+                {
+                    _loop[_depth].start = _pos;
+                    _loop[_depth].left  = LOOP_OPEN;
+                }
+                _depth++;  // loops nested too deep are played once
+                break;
+            case ']':
+            {
+                uint32_t count = parseNumber(_pos, 2, 254);
+                if (_depth == 0) break;
+                if (_depth > MML_LOOP_DEPTH) { _depth--; break; }
+                Loop &loop = _loop[_depth - 1];
+                if (loop.left == LOOP_OPEN) loop.left = (count > 0) ? count - 1 : 0;
+                if (loop.left > 0)
+                {
+                    loop.left--;
+                    _pos = loop.start;
+                }
+                else _depth--;
+                break;
+            }
+            default:
+                break;  // spaces and unknown commands are skipped
+        }
+    }
+    return false;
+}
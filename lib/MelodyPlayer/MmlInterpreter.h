@@ -0,0 +1,54 @@
+/**
+ * Header       MmlInterpreter.h
+ *
+ * Purpose      Declaration of the class MmlInterpreter which plays melodies written 
+ *              in Music Macro Language, e.g. "T120 O4 L8 CDEFGAB>C". The notes are
+ *              produced one by one while playing. The state of the interpreter has
+ *              a fixed size and nothing is allocated.
+ *
+ *              Commands    C D E F G A B   note, followed by + # (sharp) or - (flat),
+ *                                          an optional length 1..64 and dots
+ *                          R P             rest with optional length and dots
+ *                          N0..95          note by number, N48 is C4
+ *                          O0..8  > <      set octave, octave up, octave down
+ *                          L1..64          default note length, L4 is a quarter note
+ *                          T20..255        tempo in quarter notes per minute
+ *                          V0..15          volume
+ *                          [ ... ]n        repeat n times, up to MML_LOOP_DEPTH nested loops
+ *
+ * Constructor
+ * arguments    mml         NUL terminated MML text, must stay valid while playing
+ */
+#ifndef _MMLINTERPRETER_H_
+#define _MMLINTERPRETER_H_
+#include "NoteSource.h"
+
+#define MML_LOOP_DEPTH 4
+
+class MmlInterpreter : public NoteSource
+{
+    public:
+        MmlInterpreter(const char *mml = nullptr) { setText(mml); };
+        void setText(const char *mml);
+        bool nextNote(musicNote &n) override;
+        void rewind() override;
+        int  tempo() override { return _tempo; };
+        int  volume() override;
+
+    private:
+        uint32_t parseLength();
+        bool emit(musicNote &n, int pitch, int octave, uint32_t len);
+
+        typedef struct { const char *start; uint8_t left; } Loop;
+
+        const char *_text   = nullptr;
+        const char *_pos    = nullptr;
+        uint8_t  _octave    = 4;
+        uint8_t  _length    = 4;        // default note length, 4 = quarter note
+        uint8_t  _volume    = 255;      // 0..15, 255 = not given
+        int      _tempo     = 0;        // 0 = not given
+        uint32_t _time      = 0;        // position in 192ths, used to round lengths to 64ths without drift
+        uint8_t  _depth     = 0;        // number of open loops
+        Loop     _loop[MML_LOOP_DEPTH];
+};
+#endif
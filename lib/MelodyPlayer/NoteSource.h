@@ -0,0 +1,31 @@
+/**
+ * Header       NoteSource.h
+ *
+ * Purpose      Declaration of the interface NoteSource. A NoteSource delivers the
+ *              notes of a melody one after the other, so the MelodyPlayer can play
+ *              melodies which are not stored as an array of musicNotes (e.g. text
+ *              in ABC notation which is parsed while playing).
+ */
+#ifndef _NOTESOURCE_H_
+#define _NOTESOURCE_H_
+#include "MelodyTypes.h"
+
+class NoteSource
+{
+    public:
+        // Deliver the next note in n, returns false when the melody is finished
+        virtual bool nextNote(musicNote &n) = 0;
+        // Restart the melody from the beginning
+        virtual void rewind() = 0;
+        // Tempo in quarter notes per minute requested by the source, 0 = keep the player's tempo
+        virtual int  tempo() { return 0; }
+        // Volume requested by the source, -1 = keep the player's volume
+        virtual int  volume() { return -1; }
+        // Length of a bar in 64ths, 0 = not known (the player keeps its bar length)
+        virtual int  barLength() { return 0; }
+        // Index of the next note, -1 = the source can't seek
+        virtual int  position() { return -1; }
+        // Continue with the note at index without reading the notes before, false = not supported
+        virtual bool seek(int index) { return false; }
+};
+#endif
@@ -0,0 +1,29 @@
+/**
+ * Header       NullOutput.h
+ *
+ * Purpose      Declaration of the class NullOutput, an output policy of the 
+ *              BasicMelodyPlayer which discards all notes and only counts them. 
+ *              It runs the player without any hardware, e.g. on the host or to
+ *              measure the cost of the scheduling alone.
+ */
+#ifndef _NULLOUTPUT_H_
+#define _NULLOUTPUT_H_
+#include "MelodyTypes.h"
+
+class NullOutput
+{
+    public:
+        void begin() {};
+        void setLevel(uint32_t volume, TIMBRE timbre) {};
+        void noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration) { _noteOns++; };
+        void noteOff(uint32_t ms) { _noteOffs++; };
+        uint32_t noteOns()  { return _noteOns; };
+        uint32_t noteOffs() { return _noteOffs; };
+        uint32_t events()   { return _noteOns + _noteOffs; };
+        void clear() { _noteOns = 0; _noteOffs = 0; };
+
+    private:
+        uint32_t _noteOns  = 0;
+        uint32_t _noteOffs = 0;
+};
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Header       PlayerEvents.h
+ *
+ * Purpose      Events of the BasicMelodyPlayer: note on, note off, start of a bar and
+ *              end of the melody, which are passed to callbacks registered with
+ *              addCallback(), e.g. to synchronize LEDs or a display with the music.
+ *
+ *              When the player runs in its own task, the events can be deferred: 
+ *              they are put into the PlayerEventQueue, a ring buffer with a fixed
+ *              number of places, and the callbacks are called by dispatchEvents()
+ *              in the task of the display. The queue has one writer (the player)
+ *              and one reader, so it needs no lock: the writer publishes an event
+ *              with a release store of the head after it has been written, the
+ *              reader loads the head with acquire before it reads the event (and
+ *              the other way round for the tail). Nothing is allocated.
+ */
+#ifndef _PLAYEREVENTS_H_
+#define _PLAYEREVENTS_H_
+#include <atomic>
+#include "MelodyTypes.h"
+
+#define PLAYER_CALLBACKS   4   // callbacks per player
+#define PLAYER_EVENT_QUEUE 16  // deferred events, must be a power of 2
+
+enum class PLAYER_EVENT { NOTE_ON, NOTE_OFF, BAR, MELODY_END };
+
+#define EVENT_MASK(type)  (1 << (int)(type))
+#define EVENT_ALL         0x0F
+
+typedef struct 
+{
+    PLAYER_EVENT type;
+    musicNote    note;      // the note of NOTE_ON and NOTE_OFF
+    uint32_t     ms;        // time of the event
+    uint16_t     bar;       // number of the bar, starting with 1
+} PlayerEvent;
+
+typedef void (*PlayerCallback)(const PlayerEvent &event, void *arg);
+
+class PlayerEventQueue
+{
+    public:
+        /**
+         * Add the event, returns false and counts it as lost when the queue is full
+         */
+        bool put(const PlayerEvent &event)
+        {
+            uint8_t head = _head.load(std::memory_order_relaxed);
+            if ((uint8_t)(head - _tail.load(std::memory_order_acquire)) >= PLAYER_EVENT_QUEUE) 
+            {
+                _lost++;
+                return false;
+            }
+            _event[head % PLAYER_EVENT_QUEUE] = event;
+            _head.store(head + 1, std::memory_order_release);  // publish the event after it has been written
+            return true;
+        };
+        /**
+         * Take the oldest event, returns false when the queue is empty
+         */
+        bool get(PlayerEvent &event)
+        {
+            uint8_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail == _head.load(std::memory_order_acquire)) return false;
+            event = _event[tail % PLAYER_EVENT_QUEUE];
+            _tail.store(tail + 1, std::memory_order_release);  // the place may be written again
+            return true;
+        };
+        uint32_t lost() { return _lost; };
+
+    private:
+        PlayerEvent _event[PLAYER_EVENT_QUEUE];
+        std::atomic<uint8_t> _head { 0 };  // written by the player only
+        std::atomic<uint8_t> _tail { 0 };  // written by the reader only
+        uint32_t _lost = 0;
+};
+#endif
@@ -0,0 +1,68 @@
+/**
+ * Header       PlayerState.h
+ *
+ * Purpose      Declaration of PlayerState, the compact state of a BasicMelodyPlayer
+ *              (32 bytes) to resume a melody after deep sleep or a reset: melody,
+ *              index and sounding note, the ms already played of it, the position
+ *              in 64ths, tempo, volume, timbre, mode and the state of the random
+ *              numbers.
+ *
+ *              Keep it in RTC slow memory, e.g. RTC_NOINIT_ATTR PlayerState state;
+ *              which survives deep sleep and resets but not power-on. The checksum
+ *              (FNV-1a) and the version detect garbage and stale layouts, so the 
+ *              state is only used when stateValid() is true.
+ *
+ *              The melody is identified by melodyId, chosen by the application,
+ *              which has to set the same melody again before restoreState().
+ */
+#ifndef _PLAYERSTATE_H_
+#define _PLAYERSTATE_H_
+#include "MelodyTypes.h"
+
+#define PLAYER_STATE_VERSION  0x5303
+
+#define STATE_RANDOM    0x01  // random mode
+#define STATE_SOUNDING  0x02  // a note was sounding
+
+typedef struct
+{
+    uint16_t version;       // PLAYER_STATE_VERSION
+    uint16_t melodyId;      // chosen by the application
+    uint16_t noteIndex;     // index of the sounding or next note
+    uint16_t msIntoNote;    // ms played of the sounding note
+    uint16_t value;         // of the sounding note in 64ths, a NoteSource may exceed 255
+    uint16_t tempo;
+    uint8_t  note;          // the sounding note
+    uint8_t  octave;
+    uint8_t  flags;         // STATE_RANDOM, STATE_SOUNDING
+    uint8_t  volume;
+    uint8_t  timbre;
+    uint8_t  reserved[3];   // 0, no padding is left to the checksum
+    uint32_t seed;          // state of the random numbers of the clock
+    uint32_t position;      // 64ths up to the end of the sounding note
+    uint32_t checksum;      // over all fields above
+} PlayerState;
+
+static_assert(sizeof(PlayerState) == 32, "PlayerState has no padding");
+
+/**
+ * Return the FNV-1a hash of the fields of the state before the checksum
+ */
+inline uint32_t stateChecksum(const PlayerState &state)
+{
+    const uint8_t *p = (const uint8_t *)&state;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(PlayerState, checksum); i++) hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+inline bool stateValid(const PlayerState &state)
+{
+    return state.version == PLAYER_STATE_VERSION && state.checksum == stateChecksum(state);
+}
+
+inline void invalidateState(PlayerState &state)
+{
+    state.checksum = ~stateChecksum(state);
+}
+#endif
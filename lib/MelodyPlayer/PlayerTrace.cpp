@@ -0,0 +1,142 @@
+/**
+ * Class        PlayerTrace.cpp
+ *
+ * Purpose      Implements the trace ring buffer. Writing a record stores 8 bytes,
+ *              the records are converted to little endian only when they are
+ *              dumped or saved. The dump starts with a header of 16 bytes:
+ *
+ *              "MPTR"  version (16 bit)  record size (16 bit)  
+ *              number of records (32 bit)  overwritten records (32 bit)
+ *
+ * References   https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+#include "PlayerTrace.h"
+
+#define TRACE_HEADER 16
+
+TraceRecord PlayerTrace::_ring[TRACE_RECORDS];
+uint32_t    PlayerTrace::_count   = 0;
+uint32_t    PlayerTrace::_loops   = 0;
+uint32_t    PlayerTrace::_usLoop  = 0;
+uint32_t    PlayerTrace::_usCount = 0;
+bool        PlayerTrace::_looping = false;
+#ifndef ARDUINO
+uint32_t    PlayerTrace::_time    = 0;
+#endif
+
+static void put32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static void put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+
+/**
+ * Add a record with the actual time, value is limited to 16 bit
+ */
+void PlayerTrace::record(TRACE type, uint8_t arg, int32_t value)
+{
+    TraceRecord &r = _ring[_count % TRACE_RECORDS];
+    r.us    = now();
+    r.type  = (uint8_t)type;
+    r.arg   = arg;
+    r.value = (int16_t)constrain(value, INT16_MIN, INT16_MAX);
+    _count++;
+}
+
+/**
+ * Call it once per iteration of the loop. Records iterations which took
+ * longer than TRACE_STALL_US and every TRACE_LOOP_US the number of iterations
+ */
+void PlayerTrace::loop()
+{
+    uint32_t t = now();
+    if (! _looping)
+    {
+        _looping = true;
+        _usCount = t;
+    }
+    else if (t - _usLoop > TRACE_STALL_US) record(TRACE::LOOP_STALL, 0, (t - _usLoop + 500) / 1000);
+    _usLoop = t;
+    _loops++;
+    if (t - _usCount >= TRACE_LOOP_US)
+    {
+        record(TRACE::LOOP_COUNT, 0, _loops);
+        _loops   = 0;
+        _usCount = t;
+    }
+}
+
+/**
+ * Remove all records
+ */
+void PlayerTrace::clear()
+{
+    _count   = 0;
+    _loops   = 0;
+    _looping = false;
+}
+
+/**
+ * Return the number of records in the ring
+ */
+uint32_t PlayerTrace::size()
+{
+    return (_count < TRACE_RECORDS) ? _count : TRACE_RECORDS;
+}
+
+void PlayerTrace::header(uint8_t *buf)
+{
+    memcpy(buf, "MPTR", 4);
+    put16(buf + 4, TRACE_VERSION);
+    put16(buf + 6, sizeof(TraceRecord));
+    put32(buf + 8, size());
+    put32(buf + 12, overwritten());
+}
+
+void PlayerTrace::pack(uint8_t *buf, const TraceRecord &r)
+{
+    put32(buf, r.us);
+    buf[4] = r.type;
+    buf[5] = r.arg;
+    put16(buf + 6, (uint16_t)r.value);
+}
+
+/**
+ * Write header and records, the oldest first, into the file path. 
+ * Returns false when the file cannot be written
+ */
+bool PlayerTrace::save(const char *path)
+{
+    uint8_t buf[TRACE_HEADER];
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) return false;
+
+    header(buf);
+    bool ok = fwrite(buf, TRACE_HEADER, 1, file) == 1;
+    for (uint32_t i = _count - size(); ok && i < _count; i++)
+    {
+        pack(buf, _ring[i % TRACE_RECORDS]);
+        ok = fwrite(buf, sizeof(TraceRecord), 1, file) == 1;
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+#ifdef ARDUINO
+/**
+ * Print header and records as hex, 32 bytes per line "TRACE 4d505452...".
+ * Copy the output of the serial monitor into a file for trace_to_chrome.py
+ */
+void PlayerTrace::dump(Print &out)
+{
+    uint8_t  buf[TRACE_HEADER];
+    uint32_t column = 0;
+
+    header(buf);
+    out.printf("\r\nTRACE ");
+    for (int i = 0; i < TRACE_HEADER; i++) out.printf("%02x", buf[i]);
+    for (uint32_t i = _count - size(); i < _count; i++)
+    {
+        if (column++ % 4 == 0) out.printf("\r\nTRACE ");
+        pack(buf, _ring[i % TRACE_RECORDS]);
+        for (int j = 0; j < (int)sizeof(TraceRecord); j++) out.printf("%02x", buf[j]);
+    }
+    out.printf("\r\n");
+}
+#endif
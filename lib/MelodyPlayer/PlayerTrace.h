@@ -0,0 +1,95 @@
+/**
+ * Header       PlayerTrace.h
+ *
+ * Purpose      Declaration of the class PlayerTrace, a ring buffer of compact binary
+ *              trace records (8 bytes each) of the scheduler: note on with its 
+ *              duration, note off with its lateness against the deadline, stalls and
+ *              iterations of the loop and the handling of CLI commands.
+ *
+ *              The trace is compiled in with the build flag -DPLAYER_TRACE only, 
+ *              otherwise the macros TRACE_EVENT() and TRACE_LOOP() are empty. When
+ *              the ring is full the oldest records are overwritten.
+ *
+ *              dump() prints the trace as hex lines ("TRACE ...") to the serial 
+ *              monitor, save() writes it into a file (on the host or a mounted file 
+ *              system). scripts/trace_to_chrome.py converts both into Chrome trace
+ *              JSON for chrome://tracing or https://ui.perfetto.dev.
+ *
+ *              Time stamps are micros() on the ESP32. On the host the VirtualClock
+ *              sets the time with TRACE_TIME() whenever it advances.
+ */
+#ifndef _PLAYERTRACE_H_
+#define _PLAYERTRACE_H_
+#include <stdio.h>
+#include "MelodyTypes.h"
+
+#define TRACE_RECORDS  1024   // records in the ring, must be a power of 2
+#define TRACE_STALL_US 2000   // a loop iteration longer than this is recorded as stall
+#define TRACE_LOOP_US  100000 // interval of the loop counter records
+#define TRACE_VERSION  1
+
+enum class TRACE : uint8_t
+{
+    NOTE_ON = 1,    // arg = note | octave << 4, value = duration in ms
+    NOTE_OFF,       // arg = note | octave << 4, value = lateness against the deadline in ms
+    LOOP_STALL,     // value = duration of the loop iteration in ms
+    LOOP_COUNT,     // value = loop iterations since the last LOOP_COUNT
+    CMD_BEGIN,      // arg = key of the CLI command
+    CMD_END,        // arg = key of the CLI command
+    MARK            // arg and value free for the application
+};
+
+typedef struct
+{
+    uint32_t us;        // time stamp in us
+    uint8_t  type;      // TRACE
+    uint8_t  arg;
+    int16_t  value;
+} TraceRecord;
+
+class PlayerTrace
+{
+    public:
+        static void record(TRACE type, uint8_t arg, int32_t value);
+        static void loop();
+        static void clear();
+        static uint32_t size();
+        static uint32_t overwritten() { return (_count > TRACE_RECORDS) ? _count - TRACE_RECORDS : 0; };
+        static bool save(const char *path);
+#ifdef ARDUINO
+        static uint32_t now() { return micros(); };
+        static void dump(Print &out);
+#else
+        static uint32_t now() { return _time; };
+        static void setTime(uint32_t us) { _time = us; };
+#endif
+
+    private:
+        static void header(uint8_t *buf);
+        static void pack(uint8_t *buf, const TraceRecord &r);
+
+        static TraceRecord _ring[TRACE_RECORDS];
+        static uint32_t    _count;      // records written since clear()
+        static uint32_t    _loops;      // loop iterations since the last LOOP_COUNT
+        static uint32_t    _usLoop;     // time of the last loop iteration
+        static uint32_t    _usCount;    // time of the last LOOP_COUNT
+        static bool        _looping;    // loop() has been called before
+#ifndef ARDUINO
+        static uint32_t    _time;
+#endif
+};
+
+#ifdef PLAYER_TRACE
+#define TRACE_EVENT(type, arg, value) PlayerTrace::record(type, arg, value)
+#define TRACE_LOOP()                  PlayerTrace::loop()
+#else
+#define TRACE_EVENT(type, arg, value)
+#define TRACE_LOOP()
+#endif
+
+#if defined(PLAYER_TRACE) && ! defined(ARDUINO)
+#define TRACE_TIME(ms)                PlayerTrace::setTime((ms) * 1000)
+#else
+#define TRACE_TIME(ms)
+#endif
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Class        PulseOscillator.cpp
+ *
+ * Purpose      Implements a PolyBLEP pulse oscillator in fixed point. The pulse has
+ *              a rising edge at phase 0 and a falling edge at phase _width, the
+ *              residual of a band-limited step is added at both edges.
+ *
+ * References   V. Valimaki, A. Huovilainen: Antialiasing Oscillators in Subtractive
+ *              Synthesis, IEEE Signal Processing Magazine, 2007
+ */
+#include "PulseOscillator.h"
+
+/**
+ * Set the phase increment per sample, 2^32 is one period.
+ * Frequencies at or above half the sample rate are muted
+ */
+void PulseOscillator::setIncrement(uint32_t inc)
+{
+    _inc   = (inc < 0x80000000) ? inc : 0;
+    _recip = (_inc > 0x8000) ? (uint32_t)((1ULL << 47) / _inc) : UINT32_MAX;
+}
+
+/**
+ * Set the frequency in Hz
+ */
+void PulseOscillator::setFrequency(float hz, uint32_t sampleRate)
+{
+    setIncrement((uint32_t)(hz / sampleRate * 4294967296.0f));
+}
+
+/**
+ * Set the pulse width 1..99%, 50% is a square wave
+ */
+void PulseOscillator::setPulseWidth(uint8_t percent)
+{
+    percent = constrain(percent, 1, 99);
+    _width  = (uint32_t)(percent * 42949673ULL);  // percent * 2^32 / 100
+    _dc     = (int32_t)(_width >> 16) - 32768;    // 2 * width - 1 in Q15
+}
+
+/**
+ * Residual of the band-limited step at phase t in Q15, 
+ * non-zero only within one sample around the edge
+ */
+inline int32_t PulseOscillator::blep(uint32_t t)
+{
+    if (t < _inc)
+    {
+        int32_t x = (int32_t)(((uint64_t)t * _recip) >> 32);         // t / dt
+        return 2 * x - ((x * x) >> 15) - 32768;
+    }
+    if (t > ~_inc)
+    {
+        int32_t x = -(int32_t)(((uint64_t)(0U - t) * _recip) >> 32); // (t - 1) / dt
+        return ((x * x) >> 15) + 2 * x + 32768;
+    }
+    return 0;
+}
+
+/**
+ * Add n samples to the mix buffer
+ */
+void PulseOscillator::render(int32_t *mix, int n)
+{
+    if (! isActive()) return;
+
+    for (int i = 0; i < n; i++)
+    {
+        int32_t s = (_phase < _width) ? 32767 : -32767;
+        s += blep(_phase);
+        s -= blep(_phase - _width);
+        mix[i] += ((s - _dc) * _level) >> 15;
+        _phase += _inc;
+    }
+}
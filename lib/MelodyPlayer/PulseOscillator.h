@@ -0,0 +1,38 @@
+/**
+ * Header       PulseOscillator.h
+ *
+ * Purpose      Declaration of the class PulseOscillator, a band-limited square/pulse
+ *              oscillator in fixed point for the software synthesizer DacSynth.
+ *              A naive square wave aliases badly at high notes (NOTE_A in octave 7 
+ *              is 3520 Hz, its harmonics fold back far below 16 kHz at 32 kHz sample
+ *              rate). The edges are therefore smoothed with a polynomial band-limited
+ *              step (PolyBLEP) which only costs extra work in the two samples around
+ *              each edge.
+ *
+ *              The phase is an uint32_t where 2^32 is one period, samples are Q15.
+ */
+#ifndef _PULSEOSCILLATOR_H_
+#define _PULSEOSCILLATOR_H_
+#include "MelodyTypes.h"
+
+class PulseOscillator
+{
+    public:
+        void setIncrement(uint32_t inc);
+        void setFrequency(float hz, uint32_t sampleRate);
+        void setPulseWidth(uint8_t percent);
+        void setLevel(int32_t level) { _level = level; };  // 0..32767
+        bool isActive() { return _level > 0 && _inc > 0; };
+        void render(int32_t *mix, int n);
+
+    private:
+        int32_t blep(uint32_t t);
+
+        uint32_t _phase = 0;
+        uint32_t _inc   = 0;            // phase increment per sample
+        uint32_t _recip = 0;            // 2^47 / _inc, turns t / _inc into Q15 with a multiplication
+        uint32_t _width = 0x80000000;   // pulse width as phase, 50% by default
+        int32_t  _dc    = 0;            // mean value of the pulse in Q15
+        int32_t  _level = 0;
+};
+#endif
@@ -0,0 +1,47 @@
+/**
+ * Header       RecordingOutput.h
+ *
+ * Purpose      Declaration of the class template RecordingOutput, an output policy 
+ *              of the BasicMelodyPlayer which records the notes with their time 
+ *              instead of playing them, so the timing of the player can be checked.
+ *              The first N events are kept, later ones are counted as lost.
+ */
+#ifndef _RECORDINGOUTPUT_H_
+#define _RECORDINGOUTPUT_H_
+#include "MelodyTypes.h"
+
+typedef struct 
+{ 
+    uint32_t ms;        // time of the event
+    note_t   note;      // REST for a rest or a note off
+    uint8_t  octave;
+    bool     on;        // note on or note off
+} RecordedEvent;
+
+template <size_t N = 256>
+class RecordingOutput
+{
+    public:
+        void begin() { clear(); };
+        void setLevel(uint32_t volume, TIMBRE timbre) { _volume = volume; };
+        void noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration) { record(ms, note, octave, true); };
+        void noteOff(uint32_t ms) { record(ms, REST, 0, false); };
+        void clear() { _size = 0; _lost = 0; };
+        size_t size() { return _size; };
+        size_t lost() { return _lost; };
+        uint32_t volume() { return _volume; };
+        const RecordedEvent &operator[](size_t i) { return _event[i]; };
+
+    private:
+        void record(uint32_t ms, note_t note, uint8_t octave, bool on)
+        {
+            if (_size < N) _event[_size++] = { ms, note, octave, on };
+            else _lost++;
+        };
+
+        RecordedEvent _event[N];
+        size_t   _size   = 0;
+        size_t   _lost   = 0;
+        uint32_t _volume = 0;
+};
+#endif
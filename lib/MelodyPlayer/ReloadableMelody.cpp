@@ -0,0 +1,251 @@
+/**
+ * Class        ReloadableMelody.cpp
+ *
+ * Purpose      Implements the reload of a melody file. poll() parses the file into
+ *              the arena and leaves the new melody as pending under the lock
+ *              when the file did not change while it was read,
+ *              nextNote() takes it at the next note or bar and moves to the same
+ *              time in the new melody by summing up note values, nothing is parsed
+ *              there. A pending melody which is replaced before the swap is released.
+ */
+#include <string.h>
+#include <sys/stat.h>
+#include "ReloadableMelody.h"
+#include "Songbook.h"
+#include "StreamedMelody.h"
+#ifdef ARDUINO
+#include <esp_timer.h>
+#endif
+
+void ReloadableMelody::lock()
+{
+#ifdef ARDUINO
+    portENTER_CRITICAL(&_mux);
+#else
+    _mutex.lock();
+#endif
+}
+
+void ReloadableMelody::unlock()
+{
+#ifdef ARDUINO
+    portEXIT_CRITICAL(&_mux);
+#else
+    _mutex.unlock();
+#endif
+}
+
+/**
+ * Play the melody file path (e.g. "/littlefs/tune.abc") and watch it.
+ * The file is loaded at once, returns false when it can't be loaded
+ */
+bool ReloadableMelody::watch(const char *path)
+{
+    while (! beginPoll())  // the watch task is reading the file
+    {
+#ifdef ARDUINO
+        vTaskDelay(1);
+#else
+        std::this_thread::yield();
+#endif
+    }
+    strncpy(_path, path, sizeof(_path) - 1);
+    _path[sizeof(_path) - 1] = '\0';
+    _mtime = -1;
+    _size  = -1;
+    bool loaded = check();
+    _polling = false;
+    if (loaded) rewind();  // takes the melody at once
+    return loaded;
+}
+
+/**
+ * Take the right to read the file, false when another task has it
+ */
+bool ReloadableMelody::beginPoll()
+{
+    lock();
+    bool busy = _polling;
+    _polling  = true;
+    unlock();
+    return ! busy;
+}
+
+/**
+ * Load the file when its time or size has changed. Returns true when a new
+ * melody is pending. Runs in the watch task or in idle time
+ */
+bool ReloadableMelody::poll()
+{
+    if (! beginPoll()) return false;
+    bool loaded = check();
+    _polling = false;
+    return loaded;
+}
+
+/**
+ * Compare time and size of the file with the last load and load it again
+ */
+bool ReloadableMelody::check()
+{
+    struct stat st;
+
+    if (_path[0] == '\0' || stat(_path, &st) != 0) return false;
+    if ((long)st.st_mtime == _mtime && (long)st.st_size == _size) return false;
+#ifdef ARDUINO
+    int64_t start = esp_timer_get_time();
+#endif
+    MelodyHandle melody;
+    bool loaded = load(melody);
+    struct stat after;
+    if (stat(_path, &after) != 0 || after.st_mtime != st.st_mtime || after.st_size != st.st_size)
+        return false;  // the file was written while reading, the melody is released, next poll
+    _mtime = (long)st.st_mtime;
+    _size  = (long)st.st_size;
+#ifdef ARDUINO
+    _stats.loadUs = (uint32_t)(esp_timer_get_time() - start);
+#endif
+    if (! loaded) return false;  // a melody still pending stays
+    lock();
+    _pending = std::move(melody);  // a pending melody not yet swapped is released
+    unlock();
+    _stats.reloads++;
+    return true;
+}
+
+/**
+ * Read and parse the file into a new melody of the arena, check() makes it pending
+ */
+bool ReloadableMelody::load(MelodyHandle &melody)
+{
+    FILE *file = fopen(_path, "rb");
+    if (file == nullptr)
+    {
+        _stats.failed++;
+        return false;
+    }
+    size_t size = fread(_text, 1, sizeof(_text) - 1, file);
+    bool   full = ! feof(file);
+    fclose(file);
+    _text[size] = '\0';
+
+    const char  *ext = strrchr(_path, '.');
+    if (full) {}  // too large, nothing is loaded
+    else if (ext && strcmp(ext, ".abc") == 0)
+    {
+        _abc.setText(_text);
+        melody = _arena.load(_abc);
+    }
+    else if (ext && strcmp(ext, ".mml") == 0)
+    {
+        _mml.setText(_text);
+        melody = _arena.load(_mml);
+    }
+    else if (size >= STREAM_HEADER && memcmp(_text, "MPKM", 4) == 0)
+    {
+        uint8_t *header = (uint8_t *)_text;  // the packed notes are little endian as the ESP32
+        SongbookEntry entry = { _path, (const uint16_t *)(_text + STREAM_HEADER), 
+                                (uint16_t)min((size_t)(header[6] | header[7] << 8), (size - STREAM_HEADER) / 2),
+                                (uint16_t)(header[4] | header[5] << 8), nullptr };
+        PackedMelody packed(entry);
+        melody = _arena.load(packed);
+    }
+    if (! melody.valid() || melody.length() == 0)
+    {
+        _stats.failed++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Return true when a new melody waits for the swap
+ */
+bool ReloadableMelody::pending()
+{
+    lock();
+    bool valid = _pending.valid();
+    unlock();
+    return valid;
+}
+
+/**
+ * Play the new melody from the time _at64 on. Walks the note values to the
+ * first note which begins at or after _at64, up to it a rest is played
+ */
+void ReloadableMelody::swap()
+{
+    MelodyHandle melody;
+    musicNote    n;
+    uint32_t     t = 0;
+
+    lock();
+    melody = std::move(_pending);
+    unlock();
+    if (! melody.valid()) return;
+    _source.setMelody(melody);  // the old melody is released here, if it is not used elsewhere
+    while (t < _at64 && _source.nextNote(n)) t += (uint32_t)n.value;
+    _gap = (t > _at64) ? t - _at64 : 0;
+    _stats.swaps++;
+}
+
+/**
+ * Deliver the next note. The pending melody is taken at this note or at the
+ * first note of a new bar
+ */
+bool ReloadableMelody::nextNote(musicNote &n)
+{
+    uint32_t barLen = (_source.barLength() > 0) ? _source.barLength() : 64;
+    uint32_t bar    = _at64 / barLen;
+    bool     atBar  = (_at64 % barLen == 0) || bar != _bar;
+
+    _bar = bar;
+    if (_gap == 0 && (_swapAt == SWAP_AT::NOTE || atBar) && pending()) swap();
+    if (_gap > 0)
+    {
+        n = { REST, 4, (N_LEN)min(_gap, (uint32_t)255) };
+        _gap -= (uint32_t)n.value;
+    }
+    else if (! _source.nextNote(n)) return false;
+    _at64 += (uint32_t)n.value;
+    return true;
+}
+
+/**
+ * Restart at the beginning, a pending melody is taken at once
+ */
+void ReloadableMelody::rewind()
+{
+    _at64 = 0;
+    _gap  = 0;
+    _bar  = 0;
+    if (pending()) swap();
+    _source.rewind();
+}
+
+#ifdef ARDUINO
+void ReloadableMelody::watchTask(void *arg)
+{
+    ReloadableMelody *melody = (ReloadableMelody *)arg;
+    for (;;)
+    {
+        melody->poll();
+        vTaskDelay(pdMS_TO_TICKS(RELOAD_POLL_MS));
+    }
+}
+#endif
+
+/**
+ * Start a task which checks the file every RELOAD_POLL_MS ms and parses it
+ * when it has changed (ESP32 only, on the host call poll())
+ */
+bool ReloadableMelody::startWatching(uint8_t priority)
+{
+#ifdef ARDUINO
+    if (_task == nullptr) _task = xTaskCreateStaticPinnedToCore(watchTask, "reload", RELOAD_STACK, this,
+                                                                 priority, _stack, &_taskBuffer, 0);
+    return _task != nullptr;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,98 @@
+/**
+ * Header       ReloadableMelody.h
+ *
+ * Purpose      Declaration of the class ReloadableMelody, a NoteSource which plays a
+ *              melody file (*.abc, *.mml or *.mel) and reloads it when the file has
+ *              changed, e.g. while the melody is tuned on the computer and uploaded
+ *              again, without interrupting the playback.
+ *
+ *              poll() checks time and size of the file. When they have changed it
+ *              reads the file, parses it into a new melody of the MelodyArena and
+ *              hands it over. poll() runs in a task of low priority (startWatching())
+ *              or is called by the application, never in the path of the player.
+ *              The player only swaps the melodies, at the next note or at the first
+ *              note of the next bar (setSwapAt()). The new melody continues at the
+ *              same time since the start in 64ths, the beat goes on: a note of the
+ *              new melody which began before is replaced by a rest up to the next note.
+ *
+ * Constructor
+ * arguments    arena       arena for the parsed melodies, the old one is released after the swap
+ */
+#ifndef _RELOADABLEMELODY_H_
+#define _RELOADABLEMELODY_H_
+#include "MelodyArena.h"
+#include "AbcParser.h"
+#include "MmlInterpreter.h"
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <mutex>
+#include <thread>
+#endif
+
+#define RELOAD_TEXT_SIZE 4096   // largest melody file in bytes
+#define RELOAD_PATH_SIZE 64
+#define RELOAD_POLL_MS   500    // interval of the checks of startWatching()
+#define RELOAD_STACK     4096   // stack of the watch task in bytes
+
+enum class SWAP_AT { NOTE, BAR };
+
+typedef struct
+{
+    uint32_t reloads;   // files parsed into a pending melody
+    uint32_t swaps;     // melodies swapped by the player
+    uint32_t failed;    // files which could not be read, were empty or did not fit
+    uint32_t loadUs;    // time to read and parse the last file (ESP32 only)
+} ReloadStats;
+
+class ReloadableMelody : public NoteSource
+{
+    public:
+        ReloadableMelody(MelodyArena &arena) : _arena(arena) {};
+        bool watch(const char *path);
+        bool poll();
+        bool startWatching(uint8_t priority = 1);
+        void setSwapAt(SWAP_AT swapAt) { _swapAt = swapAt; };
+        bool pending();
+        bool nextNote(musicNote &n) override;
+        void rewind() override;
+        int  tempo() override { return _source.tempo(); };
+        int  volume() override { return _source.volume(); };
+        int  barLength() override { return _source.barLength(); };
+        ReloadStats stats() { return _stats; };
+
+    private:
+        bool     beginPoll();
+        bool     check();
+        bool     load(MelodyHandle &melody);
+        void     swap();
+        void     lock();
+        void     unlock();
+
+        MelodyArena   &_arena;
+        ArenaMelody    _source;
+        MelodyHandle   _pending;            // parsed, waits for the swap
+        AbcParser      _abc;
+        MmlInterpreter _mml;
+        char           _path[RELOAD_PATH_SIZE] = "";
+        alignas(2) char _text[RELOAD_TEXT_SIZE];
+        long           _mtime      = -1;    // time and size of the file loaded last
+        long           _size       = -1;
+        uint32_t       _at64       = 0;     // start of the next note in 64ths since the start
+        uint32_t       _gap        = 0;     // rest up to the first note after a swap
+        uint32_t       _bar        = 0;     // bar of the last note
+        SWAP_AT        _swapAt     = SWAP_AT::BAR;
+        volatile bool  _polling    = false; // a task reads the file
+        ReloadStats    _stats      = { 0, 0, 0, 0 };
+#ifdef ARDUINO
+        static void watchTask(void *arg);
+        portMUX_TYPE   _mux        = portMUX_INITIALIZER_UNLOCKED;
+        TaskHandle_t   _task       = nullptr;
+        StaticTask_t   _taskBuffer;
+        StackType_t    _stack[RELOAD_STACK];
+#else
+        std::mutex     _mutex;
+#endif
+};
+#endif
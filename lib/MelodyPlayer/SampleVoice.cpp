@@ -0,0 +1,136 @@
+/**
+ * Class        SampleVoice.cpp
+ *
+ * Purpose      Implements the playback of 8 bit PCM and IMA ADPCM clips. The clip 
+ *              is resampled to the output rate by holding each source sample, the 
+ *              decoder only advances when the next source sample is needed.
+ *
+ * References   IMA Digital Audio Focus and Technical Working Groups: Recommended 
+ *              Practices for Enhancing Digital Audio Compatibility in Multimedia 
+ *              Systems, 1992
+ */
+#include <string.h>
+#include "SampleVoice.h"
+#include "VolumeTaper.h"
+#ifdef ARDUINO
+#include <esp_partition.h>
+#endif
+
+static const int16_t imaStep[89] = 
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int8_t imaIndex[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+#ifdef ARDUINO
+/**
+ * Map a data partition with a sample clip into the address space,
+ * so the clip is read directly from flash. Returns false if the 
+ * partition is missing or has no valid header, nothing stays mapped then
+ */
+bool mapSampleClip(const char *partitionLabel, SampleClip &clip)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+    if (part == nullptr) return false;
+
+    const void *ptr;
+    spi_flash_mmap_handle_t handle;
+    if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK) return false;
+
+    const uint8_t *p = (const uint8_t *)ptr;
+    uint32_t length;
+    memcpy(&length, p + 4, 4);
+    if (part->size < 16 || memcmp(p, "SMPL", 4) != 0 || length > part->size - 16)
+    {
+        spi_flash_munmap(handle);
+        return false;
+    }
+    clip.length = length;
+    memcpy(&clip.sampleRate, p + 8, 4);
+    clip.format = (SAMPLE_FORMAT)p[12];
+    clip.data   = p + 16;
+    return true;  // stays mapped while the clip is used
+}
+#endif
+
+/**
+ * Start playing a clip with the perceived volume 0..100, the clip must stay valid while playing.
+ * A clip without samples only stops the clip playing
+ */
+void SampleVoice::play(const SampleClip &clip, uint8_t volume, bool loop)
+{
+    _clip    = nullptr;  // the DMA may be rendering, so switch the clip last
+    if (clip.length == 0 || clip.data == nullptr) return;
+    _loop    = loop;
+    _level   = volumeTaper[min(volume, (uint8_t)VOLUME_MAX)] >> 1;  // the same taper as the notes
+    _samples = (clip.format == SAMPLE_FORMAT::IMA_ADPCM) ? 2 * clip.length : clip.length;
+    _frac    = 0;
+    _clip    = &clip;
+    restart();
+}
+
+/**
+ * Reset the decoder and decode the first sample
+ */
+void SampleVoice::restart()
+{
+    _index     = 0;
+    _predictor = 0;
+    _stepIndex = 0;
+    _current   = decodeNext();
+}
+
+/**
+ * Decode the sample at _index as Q15
+ */
+int16_t SampleVoice::decodeNext()
+{
+    if (_clip->format == SAMPLE_FORMAT::PCM8)
+    {
+        return (int16_t)(((int)_clip->data[_index++] - 128) << 8);
+    }
+
+    uint8_t nibble = _clip->data[_index >> 1];
+    nibble = (_index++ & 1) ? nibble >> 4 : nibble & 0x0F;
+
+    int32_t step = imaStep[_stepIndex];
+    int32_t diff = step >> 3;
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+    _predictor = (int16_t)constrain((nibble & 8) ? _predictor - diff : _predictor + diff, -32768, 32767);
+    _stepIndex = (int8_t)constrain(_stepIndex + imaIndex[nibble & 7], 0, 88);
+    return _predictor;
+}
+
+/**
+ * Add n samples at the output rate to the mix buffer
+ */
+void SampleVoice::render(int32_t *mix, int n, uint32_t outputRate)
+{
+    if (_clip == nullptr) return;
+    uint32_t step = (uint32_t)(((uint64_t)_clip->sampleRate << 16) / outputRate);
+
+    for (int i = 0; i < n; i++)
+    {
+        mix[i] += (_current * _level) >> 15;
+        for (_frac += step; _frac >= 0x10000; _frac -= 0x10000)
+        {
+            if (_index >= _samples)
+            {
+                if (! _loop) 
+                {
+                    _clip = nullptr;
+                    return;
+                }
+                restart();
+            }
+            else _current = decodeNext();
+        }
+    }
+}
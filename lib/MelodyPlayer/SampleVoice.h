@@ -0,0 +1,55 @@
+/**
+ * Header       SampleVoice.h
+ *
+ * Purpose      Declaration of the class SampleVoice which plays short sound clips
+ *              (spoken prompts, sound effects) in the DacSynth together with the 
+ *              melody voices. Clips are 8 bit PCM or IMA ADPCM (4 bits per sample), 
+ *              mono, stored in flash as a const array or in a data partition which 
+ *              is memory mapped with mapSampleClip(). The samples are decoded just
+ *              in time while a DMA buffer is rendered, nothing is decoded in advance.
+ *
+ *              Partition image: "SMPL", uint32_t length in bytes, uint32_t sample rate,
+ *              uint8_t format, 3 bytes padding, followed by the sample data
+ */
+#ifndef _SAMPLEVOICE_H_
+#define _SAMPLEVOICE_H_
+#include "MelodyTypes.h"
+
+enum class SAMPLE_FORMAT { PCM8, IMA_ADPCM };
+
+// PCM8 is unsigned with 128 as zero, IMA ADPCM is a raw nibble stream, low nibble first
+typedef struct 
+{ 
+    const uint8_t *data; 
+    uint32_t       length;      // in bytes
+    uint32_t       sampleRate; 
+    SAMPLE_FORMAT  format; 
+} SampleClip;
+
+#ifdef ARDUINO
+bool mapSampleClip(const char *partitionLabel, SampleClip &clip);
+#endif
+
+class SampleVoice
+{
+    public:
+        void play(const SampleClip &clip, uint8_t volume = 100, bool loop = false);
+        void stop() { _clip = nullptr; };
+        bool isPlaying() { return _clip != nullptr; };
+        void render(int32_t *mix, int n, uint32_t outputRate);
+
+    private:
+        void restart();
+        int16_t decodeNext();
+
+        const SampleClip *_clip = nullptr;
+        bool     _loop      = false;
+        int32_t  _level     = 0;        // 0..32767
+        uint32_t _index     = 0;        // next sample to decode
+        uint32_t _samples   = 0;        // number of samples in the clip
+        uint32_t _frac      = 0;        // position between two source samples, Q16
+        int16_t  _current   = 0;        // last decoded sample
+        int16_t  _predictor = 0;        // IMA ADPCM decoder state
+        int8_t   _stepIndex = 0;
+};
+#endif
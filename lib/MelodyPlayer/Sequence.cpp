@@ -0,0 +1,95 @@
+/**
+ * Class        Sequence.cpp
+ *
+ * Purpose      Implements the static frame pool of the coroutines and the Sequencer,
+ *              a cooperative executor which polls the running sequences in turn.
+ *
+ * References   https://en.cppreference.com/w/cpp/language/coroutines
+ */
+#include "Sequence.h"
+#if defined(__cpp_impl_coroutine)
+
+alignas(max_align_t) uint8_t SequenceFramePool::_frame[SEQUENCE_FRAMES][SEQUENCE_FRAME_SIZE];
+uint32_t SequenceFramePool::_used    = 0;
+int      SequenceFramePool::_inUse   = 0;
+size_t   SequenceFramePool::_largest = 0;
+uint32_t SequenceFramePool::_failed  = 0;
+
+/**
+ * Return a free frame of the pool, nullptr when the pool is exhausted or
+ * size is larger than SEQUENCE_FRAME_SIZE. Not for use in interrupts
+ */
+void *SequenceFramePool::allocate(size_t size)
+{
+    if (size > _largest) _largest = size;
+    if (size <= SEQUENCE_FRAME_SIZE)
+    {
+        for (int i = 0; i < SEQUENCE_FRAMES; i++)
+        {
+            if (! (_used & (1u << i)))
+            {
+                _used |= 1u << i;
+                _inUse++;
+                return _frame[i];
+            }
+        }
+    }
+    _failed++;
+    return nullptr;
+}
+
+/**
+ * Return the frame to the pool
+ */
+void SequenceFramePool::release(void *frame)
+{
+    int i = ((uint8_t *)frame - &_frame[0][0]) / SEQUENCE_FRAME_SIZE;
+    if (i < 0 || i >= SEQUENCE_FRAMES || ! (_used & (1u << i))) return;
+    _used &= ~(1u << i);
+    _inUse--;
+}
+
+/**
+ * Run the sequence, returns false when it is empty (no frame) or all places are taken
+ */
+bool Sequencer::start(Sequence &&sequence)
+{
+    if (! sequence.valid()) return false;
+    for (auto &s : _sequence)
+    {
+        if (! s.valid())
+        {
+            s = (Sequence &&)sequence;
+            _running++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Stop all sequences and release their frames
+ */
+void Sequencer::stop()
+{
+    for (auto &s : _sequence) s = Sequence();
+    _running = 0;
+}
+
+/**
+ * Poll each running sequence once, finished sequences are removed.
+ * Call it in the loop. Returns the number of sequences still running
+ */
+int Sequencer::run()
+{
+    for (auto &s : _sequence)
+    {
+        if (s.valid() && s.poll())
+        {
+            s = Sequence();  // release the frame
+            _running--;
+        }
+    }
+    return _running;
+}
+#endif
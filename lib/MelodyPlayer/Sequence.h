@@ -0,0 +1,165 @@
+/**
+ * Header       Sequence.h
+ *
+ * Purpose      Declaration of Sequence, a C++20 coroutine to compose melodies, beats
+ *              and waits without writing a state machine around playMelody():
+ *
+ *              Sequence show(MelodyPlayer &player)
+ *              {
+ *                  co_await player.play(intro, len_intro);
+ *                  co_await until(buttonPressed);
+ *                  for (int i = 0; i < 3; i++) co_await player.play(chorus, len_chorus);
+ *                  co_await player.beats(4);
+ *              }
+ *
+ *              A Sequence can co_await every object with a method bool poll(), which
+ *              does a step of the work and returns true when it is done. Also a
+ *              Sequence itself is such an object, so sequences can be nested.
+ *              The Sequencer is the executor: call its run() in the loop, it polls
+ *              what each sequence waits for and resumes the sequence when it is done.
+ *
+ *              The frames of the coroutines are taken from a static pool of
+ *              SEQUENCE_FRAMES places of SEQUENCE_FRAME_SIZE bytes, there is no heap.
+ *              When the pool is exhausted (or a frame is too large) the Sequence is
+ *              empty and Sequencer::start() returns false.
+ *
+ *              Needs a compiler with coroutines (-std=gnu++20, GCC 10 or later),
+ *              otherwise the header declares nothing. The Arduino core 2.x of the
+ *              ESP32 environment has GCC 8, so sequences run only on the host
+ *              (environment native).
+ */
+#ifndef _SEQUENCE_H_
+#define _SEQUENCE_H_
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#define SEQUENCE_FRAMES     8    // coroutine frames in the pool
+#define SEQUENCE_FRAME_SIZE 256  // bytes per frame
+#define SEQUENCER_TASKS     4    // sequences run by a Sequencer
+
+class SequenceFramePool
+{
+    public:
+        static void  *allocate(size_t size);
+        static void   release(void *frame);
+        static int    inUse()   { return _inUse; };
+        static size_t largest() { return _largest; };  // largest frame requested
+        static uint32_t failed() { return _failed; };
+
+    private:
+        alignas(max_align_t) static uint8_t _frame[SEQUENCE_FRAMES][SEQUENCE_FRAME_SIZE];
+        static uint32_t _used;  // one bit per frame
+        static int      _inUse;
+        static size_t   _largest;
+        static uint32_t _failed;
+};
+
+class Sequence
+{
+    public:
+        struct promise_type
+        {
+            typedef bool (*Poll)(void *awaited);
+
+            /**
+             * Wraps the awaited object, the Sequencer polls it through poll and awaited
+             */
+            template <class T>
+            struct Awaiter
+            {
+                T &awaited;
+                bool await_ready() { return awaited.poll(); };
+                void await_suspend(std::coroutine_handle<promise_type> h)
+                {
+                    h.promise().awaited = &awaited;
+                    h.promise().poll    = [](void *p) { return ((T *)p)->poll(); };
+                };
+                void await_resume() {};
+            };
+
+            Sequence get_return_object() { return Sequence(std::coroutine_handle<promise_type>::from_promise(*this)); };
+            static Sequence get_return_object_on_allocation_failure() { return Sequence(); };
+            std::suspend_always initial_suspend() noexcept { return {}; };
+            std::suspend_always final_suspend() noexcept { return {}; };
+            void return_void() {};
+            void unhandled_exception() { std::terminate(); };
+            template <class T>
+            Awaiter<std::remove_reference_t<T>> await_transform(T &&awaited) { return { awaited }; };
+            static void *operator new(size_t size) noexcept { return SequenceFramePool::allocate(size); };
+            static void  operator delete(void *frame) { SequenceFramePool::release(frame); };
+
+            Poll  poll    = nullptr;  // what the sequence waits for, nullptr = ready to run
+            void *awaited = nullptr;
+        };
+
+        Sequence() {};
+        Sequence(Sequence &&other) : _h(other._h) { other._h = nullptr; };
+        Sequence &operator=(Sequence &&other)
+        {
+            if (this != &other)
+            {
+                if (_h) _h.destroy();
+                _h = other._h;
+                other._h = nullptr;
+            }
+            return *this;
+        };
+        Sequence(const Sequence &) = delete;
+        Sequence &operator=(const Sequence &) = delete;
+        ~Sequence() { if (_h) _h.destroy(); };
+
+        /**
+         * Resume the coroutine when what it waits for is done.
+         * Returns true when the coroutine has finished or is empty
+         */
+        bool poll()
+        {
+            if (! _h || _h.done()) return true;
+            promise_type &p = _h.promise();
+            if (p.poll != nullptr && ! p.poll(p.awaited)) return false;
+            p.poll = nullptr;
+            _h.resume();
+            return _h.done();
+        };
+        bool valid() { return (bool)_h; };
+        bool done()  { return ! _h || _h.done(); };
+
+    private:
+        explicit Sequence(std::coroutine_handle<promise_type> h) : _h(h) {};
+        std::coroutine_handle<promise_type> _h = nullptr;
+};
+
+/**
+ * Awaitable which is done when cond(arg) returns true, e.g. a button is pressed
+ */
+class Until
+{
+    public:
+        Until(bool (*cond)(void *), void *arg = nullptr) : _cond(cond), _arg(arg) {};
+        bool poll() { return _cond(_arg); };
+
+    private:
+        bool (*_cond)(void *);
+        void  *_arg;
+};
+
+inline Until until(bool (*cond)(void *), void *arg = nullptr) { return Until(cond, arg); }
+
+class Sequencer
+{
+    public:
+        bool start(Sequence &&sequence);
+        void stop();
+        int  run();
+        int  running() { return _running; };
+
+    private:
+        Sequence _sequence[SEQUENCER_TASKS];
+        int      _running = 0;
+};
+#endif
+#endif
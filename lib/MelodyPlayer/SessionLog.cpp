@@ -0,0 +1,276 @@
+/**
+ * Class        SessionLog.cpp
+ *
+ * Purpose      Implements the session log and the replay clock. Entries of the log:
+ *
+ *              0x00..0x7F                      time sample, delta 0..127 ms
+ *              0xC0 count(16)                  count samples with the last delta
+ *              0xC1 delta(32)                  time sample with a large delta
+ *              0xC2 byte                       byte received by the CLI
+ *              0xC3 call value(32)             call of the player API
+ *              0xC4 version seed(32) ms(32)    start of the session (first entry)
+ *
+ *              Numbers are little endian.
+ */
+#include "SessionLog.h"
+
+#define ENTRY_RUN    0xC0
+#define ENTRY_DELTA  0xC1
+#define ENTRY_INPUT  0xC2
+#define ENTRY_CALL   0xC3
+#define ENTRY_START  0xC4
+#define START_SIZE   10
+
+static void put32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static uint32_t get32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+/**
+ * Clear the log and start recording at time ms
+ */
+void SessionLog::start(uint32_t seed, uint32_t ms)
+{
+    uint8_t entry[START_SIZE] = { ENTRY_START, SESSION_VERSION };
+
+    put32(entry + 2, seed);
+    put32(entry + 6, ms);
+    _size      = 0;
+    _full      = false;
+    _seed      = seed;
+    _ms        = ms;
+    _delta     = UINT32_MAX;  // the first sample is written out
+    _run       = 0;
+    _recording = put(entry, START_SIZE);
+}
+
+/**
+ * Append n bytes, stop recording when they don't fit
+ */
+bool SessionLog::put(const uint8_t *bytes, size_t n)
+{
+    if (_size + n > SESSION_LOG_SIZE)
+    {
+        _full      = true;
+        _recording = false;
+        return false;
+    }
+    memcpy(_buf + _size, bytes, n);
+    _size += n;
+    return true;
+}
+
+/**
+ * Log a sample which does not extend the open run
+ */
+void SessionLog::sampleSlow(uint32_t delta)
+{
+    if (delta == _delta)  // start a run
+    {
+        uint8_t entry[3] = { ENTRY_RUN, 1, 0 };
+        if (put(entry, 3))
+        {
+            _run      = _size - 3;
+            _runCount = 1;
+        }
+        return;
+    }
+    _run   = 0;
+    _delta = delta;
+    if (delta < 0x80)
+    {
+        uint8_t entry = delta;
+        put(&entry, 1);
+    }
+    else
+    {
+        uint8_t entry[5] = { ENTRY_DELTA };
+        put32(entry + 1, delta);
+        put(entry, 5);
+    }
+}
+
+/**
+ * Log a byte received by the CLI
+ */
+void SessionLog::input(uint8_t byte)
+{
+    if (! _recording) return;
+    uint8_t entry[2] = { ENTRY_INPUT, byte };
+    _run = 0;  // later samples follow the input
+    put(entry, 2);
+}
+
+/**
+ * Log a call of the player API with its argument
+ */
+void SessionLog::call(SESSION_CALL call, int32_t value)
+{
+    if (! _recording) return;
+    uint8_t entry[6] = { ENTRY_CALL, (uint8_t)call };
+    put32(entry + 2, (uint32_t)value);
+    _run = 0;
+    put(entry, 6);
+}
+
+/**
+ * Write the log into the file path
+ */
+bool SessionLog::save(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) return false;
+    bool ok = fwrite(_buf, 1, _size, file) == _size;
+    return (fclose(file) == 0) && ok;
+}
+
+/**
+ * Read the log from the file path
+ */
+bool SessionLog::load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    size_t n = fread(_buf, 1, SESSION_LOG_SIZE, file);
+    fclose(file);
+    return load(_buf, n);
+}
+
+/**
+ * Take the log from data (e.g. converted from the hex dump) and rewind it.
+ * Returns false when it does not start with a session
+ */
+bool SessionLog::load(const uint8_t *data, size_t size)
+{
+    if (size > SESSION_LOG_SIZE || size < START_SIZE || data[0] != ENTRY_START || data[1] != SESSION_VERSION) return false;
+    if (data != _buf) memcpy(_buf, data, size);
+    _size      = size;
+    _recording = false;
+    rewind();
+    return true;
+}
+
+#ifdef ARDUINO
+/**
+ * Print the log as hex lines "SESSION ...", 32 bytes per line
+ */
+void SessionLog::dump(Print &out)
+{
+    for (size_t i = 0; i < _size; i++)
+    {
+        if (i % 32 == 0) out.printf("\r\nSESSION ");
+        out.printf("%02x", _buf[i]);
+    }
+    out.printf("\r\n");
+}
+#endif
+
+/**
+ * Start reading at the first entry
+ */
+void SessionLog::rewind()
+{
+    _pos    = 0;
+    _repeat = 0;
+    if (_size < START_SIZE || _buf[0] != ENTRY_START) return;
+    _seed      = get32(_buf + 2);
+    _msRead    = get32(_buf + 6);
+    _deltaRead = 0;
+    _pos       = START_SIZE;
+}
+
+/**
+ * Return the type of the next entry without reading it
+ */
+SESSION_ENTRY SessionLog::peek()
+{
+    if (_repeat > 0) return SESSION_ENTRY::SAMPLE;
+    if (_pos >= _size || _pos == 0) return SESSION_ENTRY::END;
+    switch (_buf[_pos])
+    {
+        case ENTRY_INPUT: return SESSION_ENTRY::INPUT;
+        case ENTRY_CALL:  return SESSION_ENTRY::CALL;
+        case ENTRY_START: return SESSION_ENTRY::END;
+        default:          return SESSION_ENTRY::SAMPLE;
+    }
+}
+
+/**
+ * Read the next entry, returns false at the end of the log
+ */
+bool SessionLog::next(SessionEntry &entry)
+{
+    SESSION_ENTRY type = peek();
+    entry.type = type;
+    if (type == SESSION_ENTRY::END) return false;
+
+    if (_repeat > 0) _repeat--;
+    else
+    {
+        uint8_t code = _buf[_pos];
+        if (code < 0x80)
+        {
+            _deltaRead = code;
+            _pos++;
+        }
+        else if (code == ENTRY_RUN)
+        {
+            _repeat = (_buf[_pos + 1] | _buf[_pos + 2] << 8) - 1;
+            _pos += 3;
+        }
+        else if (code == ENTRY_DELTA)
+        {
+            _deltaRead = get32(_buf + _pos + 1);
+            _pos += 5;
+        }
+        else if (code == ENTRY_INPUT)
+        {
+            entry.input = _buf[_pos + 1];
+            _pos += 2;
+            return true;
+        }
+        else
+        {
+            entry.call  = (SESSION_CALL)_buf[_pos + 1];
+            entry.value = (int32_t)get32(_buf + _pos + 2);
+            _pos += 6;
+            return true;
+        }
+    }
+    _msRead += _deltaRead;
+    entry.ms = _msRead;
+    return true;
+}
+
+/**
+ * Replay the session of log, from its start
+ */
+void ReplayClock::replay(SessionLog *log)
+{
+    _log      = log;
+    _diverged = 0;
+    _log->rewind();
+    _seed = _log->seed();
+    _ms   = _log->time();
+}
+
+/**
+ * Return the next time sample of the log. When the log has none (the replay
+ * reads more samples than recorded), the last time is repeated and counted
+ */
+uint32_t ReplayClock::millis()
+{
+    SessionEntry entry;
+    if (_log != nullptr && _log->peek() == SESSION_ENTRY::SAMPLE && _log->next(entry)) _ms = entry.ms;
+    else _diverged++;
+    return _ms;
+}
+
+/**
+ * Return the next CLI byte or API call, if it is due before the next time sample
+ */
+bool ReplayClock::input(SessionEntry &entry)
+{
+    if (_log == nullptr) return false;
+    SESSION_ENTRY type = _log->peek();
+    if (type != SESSION_ENTRY::INPUT && type != SESSION_ENTRY::CALL) return false;
+    return _log->next(entry);
+}
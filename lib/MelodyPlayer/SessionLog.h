@@ -0,0 +1,194 @@
+/**
+ * Header       SessionLog.h
+ *
+ * Purpose      Declaration of the class SessionLog and of the clock policies
+ *              RecordingClock and ReplayClock, which record the external inputs of a
+ *              playback session and replay it bit-identically, e.g. on the host:
+ *
+ *              - the seed of the random numbers (the clocks use their own generator)
+ *              - every time sample read by the player (millis())
+ *              - the bytes received by the CLI and the calls of the player API
+ *
+ *              The log is a fixed buffer of SESSION_LOG_SIZE bytes. Time samples are
+ *              stored as delta to the previous one (1 byte), a run of equal deltas
+ *              as a count (3 bytes), so a loop polling once per ms needs a few 
+ *              bytes per second. When the buffer is full recording stops, full() 
+ *              tells it: a replay needs the session from its start.
+ *
+ *              Recording a sample costs a subtraction, a compare and a store.
+ *
+ *              RecordingClock<Base> wraps a clock (ArduinoClock, VirtualClock) and
+ *              logs while record() is active. ReplayClock takes the samples from the
+ *              log, input() returns the CLI bytes and API calls in the recorded order
+ *              and replayCall() repeats the calls on the player.
+ */
+#ifndef _SESSIONLOG_H_
+#define _SESSIONLOG_H_
+#include <stdio.h>
+#include "MelodyTypes.h"
+
+#define SESSION_LOG_SIZE 4096
+#define SESSION_VERSION  1
+
+// API calls of the player which are logged, value is the argument
+enum class SESSION_CALL : uint8_t { TEMPO, VOLUME, LEGATO, TIMBRE, RANDOM_MODE, MELODY, MUTE, BEATS, APP };
+
+enum class SESSION_ENTRY : uint8_t { SAMPLE, INPUT, CALL, END };
+
+typedef struct
+{
+    SESSION_ENTRY type;
+    SESSION_CALL  call;     // CALL
+    uint8_t       input;    // INPUT: the byte received
+    int32_t       value;    // CALL: argument
+    uint32_t      ms;       // SAMPLE: the time
+} SessionEntry;
+
+class SessionLog
+{
+    public:
+        void start(uint32_t seed, uint32_t ms);
+        void stop() { _recording = false; };
+        bool recording() { return _recording; };
+        bool full() { return _full; };
+        /**
+         * Log the time sample ms, called for every millis() of the player
+         */
+        void sample(uint32_t ms)
+        {
+            if (! _recording) return;
+            uint32_t delta = ms - _ms;
+            _ms = ms;
+            if (delta == _delta && _run != 0 && _runCount < 0xFFFF)  // extend the open run
+            {
+                _runCount++;
+                _buf[_run + 1] = _runCount;
+                _buf[_run + 2] = _runCount >> 8;
+                return;
+            }
+            sampleSlow(delta);
+        };
+        void input(uint8_t byte);
+        void call(SESSION_CALL call, int32_t value);
+        size_t size() { return _size; };
+        uint32_t seed() { return _seed; };
+        uint32_t time() { return _msRead; };  // time of the last sample read
+        const uint8_t *data() { return _buf; };
+        bool save(const char *path);
+        bool load(const char *path);
+        bool load(const uint8_t *data, size_t size);
+#ifdef ARDUINO
+        void dump(Print &out);
+#endif
+        void rewind();
+        SESSION_ENTRY peek();
+        bool next(SessionEntry &entry);
+
+    private:
+        void sampleSlow(uint32_t delta);
+        bool put(const uint8_t *bytes, size_t n);
+
+        uint8_t  _buf[SESSION_LOG_SIZE];
+        size_t   _size      = 0;
+        bool     _recording = false;
+        bool     _full      = false;
+        uint32_t _seed      = 0;
+        uint32_t _ms        = 0;      // last sample
+        uint32_t _delta     = 0;      // last delta
+        size_t   _run       = 0;      // position of the open run entry, 0 = none
+        uint32_t _runCount  = 0;
+        // reader
+        size_t   _pos       = 0;
+        uint32_t _repeat    = 0;      // samples of the run left
+        uint32_t _msRead    = 0;
+        uint32_t _deltaRead = 0;
+};
+
+/**
+ * Random numbers 0..n-1 from the seed, the same generator on the device and the host
+ */
+inline long sessionRandom(uint32_t &seed, long n)
+{
+    seed = seed * 1664525 + 1013904223;  // linear congruential generator
+    return (long)((seed >> 8) % (uint32_t)n);
+}
+
+template <class Base>
+class RecordingClock
+{
+    public:
+        uint32_t millis() 
+        {
+            uint32_t ms = _base.millis();
+            if (_log) _log->sample(ms);
+            return ms;
+        };
+        void delay(uint32_t ms) { _base.delay(ms); };
+        long random(long n) { return _log ? sessionRandom(_seed, n) : _base.random(n); };
+        uint32_t seed() { return _log ? _seed : _base.seed(); };
+        void setSeed(uint32_t seed) 
+        {
+            _seed = seed;
+            _base.setSeed(seed);
+        };
+        /**
+         * Start recording into log with the seed for the random numbers, nullptr stops
+         */
+        void record(SessionLog *log, uint32_t seed = 1)
+        {
+            if (_log) _log->stop();
+            _log  = log;
+            _seed = seed;
+            if (_log) _log->start(seed, _base.millis());
+        };
+        SessionLog *log() { return _log; };
+        Base &base() { return _base; };
+
+    private:
+        Base        _base;
+        SessionLog *_log  = nullptr;
+        uint32_t    _seed = 1;
+};
+
+/**
+ * Repeat a logged call of the player API. Returns false for the calls the 
+ * application has to handle itself (MELODY, BEATS, APP)
+ */
+template <class Player>
+bool replayCall(Player &player, const SessionEntry &entry)
+{
+    switch (entry.call)
+    {
+        case SESSION_CALL::TEMPO:       player.setTempo((int)entry.value);       return true;
+        case SESSION_CALL::VOLUME:      player.setVolume(entry.value);           return true;
+        case SESSION_CALL::LEGATO:      player.setLegato(entry.value);           return true;
+        case SESSION_CALL::TIMBRE:      player.setTimbre((TIMBRE)entry.value);   return true;
+        case SESSION_CALL::MUTE:        player.mute();                           return true;
+        case SESSION_CALL::RANDOM_MODE:
+            if (entry.value) player.setRandomMode();
+            else player.setNormalMode();
+            return true;
+        default: return false;
+    }
+}
+
+class ReplayClock
+{
+    public:
+        uint32_t millis();
+        void delay(uint32_t ms) {};  // the delay is contained in the next sample
+        long random(long n) { return sessionRandom(_seed, n); };
+        uint32_t seed() { return _seed; };
+        void setSeed(uint32_t seed) { _seed = seed; };
+        void replay(SessionLog *log);
+        bool input(SessionEntry &entry);
+        bool end() { return _log == nullptr || _log->peek() == SESSION_ENTRY::END; };
+        uint32_t diverged() { return _diverged; };
+
+    private:
+        SessionLog *_log      = nullptr;
+        uint32_t    _seed     = 1;
+        uint32_t    _ms       = 0;
+        uint32_t    _diverged = 0;  // millis() when the log has no sample next
+};
+#endif
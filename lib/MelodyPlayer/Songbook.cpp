@@ -0,0 +1,95 @@
+/**
+ * Class        Songbook.cpp
+ *
+ * Purpose      Implements the class PackedMelody which unpacks the notes of a
+ *              melody of the songbook one by one while playing and follows the
+ *              references to the phrase dictionary.
+ *              The songbook itself is generated into src/songbook/
+ */
+#include "Songbook.h"
+
+/**
+ * Select another melody of the songbook
+ */
+void PackedMelody::setEntry(const SongbookEntry &entry)
+{
+    _entry = &entry;
+    rewind();
+}
+
+/**
+ * Start again with the first note of the melody
+ */
+void PackedMelody::rewind()
+{
+    _level[0] = { _entry->notes, _entry->length, 0 };
+    _depth    = 0;
+    _position = 0;
+}
+
+/**
+ * Continue in the phrase ref refers to, returns false when the stack is full
+ */
+bool PackedMelody::enter(uint16_t ref)
+{
+    if (_depth >= PHRASE_DEPTH || (int)PACKED_REF(ref) >= songbookPhraseCount) return false;
+    const SongbookPhrase &phrase = songbookPhrases[PACKED_REF(ref)];
+    _level[++_depth] = { phrase.notes, phrase.length, 0 };
+    return true;
+}
+
+/**
+ * Unpack the next note, follows the phrase references. Returns false at the 
+ * end of the melody
+ */
+bool PackedMelody::nextNote(musicNote &n)
+{
+    for (;;)
+    {
+        Level &level = _level[_depth];
+        if (level.index >= level.length)
+        {
+            if (_depth == 0) return false;
+            _depth--;  // end of the phrase, back to the word after the reference
+            continue;
+        }
+        uint16_t p = level.notes[level.index++];
+        if ((p & 0x0F) == PACKED_PHRASE)
+        {
+            enter(p);
+            continue;
+        }
+        n.note   = PACKED_NOTE(p);
+        n.octave = PACKED_OCTAVE(p);
+        n.value  = (N_LEN)PACKED_LEN(p);
+        _position++;
+        return true;
+    }
+}
+
+/**
+ * Continue with the note at index, the notes are not read. Phrases which
+ * end before index are skipped as a whole
+ */
+bool PackedMelody::seek(int index)
+{
+    if (index < 0) return false;
+    rewind();
+    for (int left = index; left > 0; )
+    {
+        Level &level = _level[_depth];
+        if (level.index >= level.length)
+        {
+            if (_depth == 0) return false;  // behind the end, the melody starts from the top
+            _depth--;
+            continue;
+        }
+        uint16_t p = level.notes[level.index++];
+        if ((p & 0x0F) != PACKED_PHRASE) left--;
+        else if ((int)PACKED_REF(p) >= songbookPhraseCount) continue;  // skipped by nextNote() too
+        else if (songbookPhrases[PACKED_REF(p)].expanded <= left) left -= songbookPhrases[PACKED_REF(p)].expanded;
+        else enter(p);
+    }
+    _position = index;
+    return true;
+}
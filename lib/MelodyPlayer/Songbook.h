@@ -0,0 +1,105 @@
+/**
+ * Header       Songbook.h
+ *
+ * Purpose      Declaration of the songbook, the registry of all melodies which are
+ *              compiled from the directory melodies/ at build time by the script
+ *              scripts/compile_melodies.py, and of the class PackedMelody which
+ *              plays a melody of the songbook.
+ *
+ *              The notes of a melody are packed into an uint16_t each and stay in flash:
+ *              bits 15..8 length in 64ths, bits 7..4 octave, bits 3..0 note (REST = 12)
+ *
+ *              Phrases which repeat within or across the melodies are stored once in
+ *              the phrase dictionary songbookPhrases[]. A word with note code 13 
+ *              refers to the phrase with the index in bits 15..4, phrases may refer
+ *              to other phrases. PackedMelody follows the references with a stack of
+ *              PHRASE_DEPTH levels, the phrases are played from flash.
+ *
+ *              Each entry points to the MelodyInfo of its melody (MelodyInfo.h), 
+ *              computed by packedInfo() when the melody is compiled, e.g. 
+ *              melodyMs(*songbook[0].info, songbook[0].tempo) is its duration.
+ *
+ * Constructor
+ * arguments    entry       melody of the songbook, e.g. songbook[0]
+ */
+#ifndef _SONGBOOK_H_
+#define _SONGBOOK_H_
+#include "NoteSource.h"
+#include "MelodyInfo.h"
+
+#define PACKED_NOTE(p)    ((note_t)((p) & 0x0F))
+#define PACKED_OCTAVE(p)  ((uint8_t)(((p) >> 4) & 0x0F))
+#define PACKED_LEN(p)     ((uint8_t)((p) >> 8))
+#define PACKED_PHRASE     13          // note code of a reference to a phrase
+#define PACKED_REF(p)     ((uint16_t)((p) >> 4))  // index of the phrase
+#define PACKED_CONTROL    14          // note code of a change of tempo, volume or bar length (MelodyArena)
+#define PHRASE_DEPTH      4           // nesting of phrases, as in compile_melodies.py
+#define PACK_NOTE(n)      ((uint16_t)(min((uint32_t)(n).value, (uint32_t)255) << 8 | ((n).octave & 0x0F) << 4 | ((n).note & 0x0F)))
+
+typedef struct 
+{ 
+    const char     *name; 
+    const uint16_t *notes;      // packed notes and phrase references
+    uint16_t        length;     // number of packed words
+    uint16_t        tempo;      // quarter notes per minute
+    const MelodyInfo *info;     // notes, duration and pitch range
+} SongbookEntry;
+
+typedef struct
+{
+    const uint16_t *notes;      // packed notes and phrase references
+    uint16_t        length;     // number of packed words
+    uint16_t        expanded;   // number of notes with the phrases it refers to
+} SongbookPhrase;
+
+/**
+ * Info of the packed words w[from] up to w[to - 1]. A reference is replaced by
+ * the info of its phrase of the dictionary phrases[] with count entries, as
+ * PackedMelody plays it: references behind the dictionary or deeper than
+ * PHRASE_DEPTH are skipped
+ */
+constexpr MelodyInfo packedInfo(const uint16_t w[], int from, int to, 
+                                const SongbookPhrase phrases[], int count, int depth = 0)
+{
+    return to - from <= 0 ? emptyInfo()
+         : to - from > 1 ? joinInfo(packedInfo(w, from, (from + to) / 2, phrases, count, depth),
+                                    packedInfo(w, (from + to) / 2, to, phrases, count, depth))
+         : PACKED_NOTE(w[from]) != PACKED_PHRASE ? noteInfo(PACKED_NOTE(w[from]), PACKED_OCTAVE(w[from]), PACKED_LEN(w[from]))
+         : PACKED_REF(w[from]) < count && depth < PHRASE_DEPTH
+           ? packedInfo(phrases[PACKED_REF(w[from])].notes, 0, phrases[PACKED_REF(w[from])].length, phrases, count, depth + 1)
+           : emptyInfo();
+}
+
+extern const SongbookEntry songbook[];  // the last entry has name == nullptr
+extern const int songbookSize;
+extern const SongbookPhrase songbookPhrases[];
+extern const int songbookPhraseCount;
+
+class PackedMelody : public NoteSource
+{
+    public:
+        PackedMelody(const SongbookEntry &entry) : _entry(&entry) { rewind(); };
+        void setEntry(const SongbookEntry &entry);
+        const SongbookEntry &entry() { return *_entry; };
+        bool nextNote(musicNote &n) override;
+        void rewind() override;
+        int  tempo() override { return _entry->tempo; };
+        int  position() override { return _position; };
+        bool seek(int index) override;
+
+    private:
+        typedef struct 
+        { 
+            const uint16_t *notes; 
+            uint16_t        length; 
+            uint16_t        index;      // next word
+        } Level;
+
+        bool enter(uint16_t ref);
+
+        const SongbookEntry *_entry;
+        Level    _level[PHRASE_DEPTH + 1];  // the melody and the phrases it is in
+        uint8_t  _depth    = 0;
+        uint16_t _position = 0;             // index of the next note
+};
+#endif
@@ -0,0 +1,90 @@
+/**
+ * Class        StepSequencer.cpp
+ *
+ * Purpose      Implements a drum step sequencer running in sample time of the DacSynth
+ */
+#include "StepSequencer.h"
+
+/**
+ * Compile a pattern into the event timeline. Each lane
+ * plays on its own drum voice, lanes share voices if there
+ * are more lanes than voices
+ */
+void StepSequencer::setPattern(const DrumPattern &pattern, uint8_t voices)
+{
+    bool running = _running;
+    _running = false;
+    _steps   = (pattern.steps > 16) ? 32 : 16;
+
+    uint16_t n = 0;
+    uint8_t  lanes = min(pattern.lanes, (uint8_t)SEQ_LANES);
+    for (uint8_t s = 0; s < _steps; s++)
+    {
+        _first[s] = n;
+        for (uint8_t l = 0; l < lanes; l++)
+        {
+            const DrumLane &lane = pattern.lane[l];
+            if (lane.steps & (1UL << s)) _event[n++] = { (uint8_t)(l % voices), lane.drum, lane.volume };
+        }
+    }
+    _first[_steps] = n;
+    if (_step >= _steps) _step = 0;
+    _running = running;
+}
+
+/**
+ * Set the tempo in quarter notes per minute, 
+ * the same unit as the tempo of the MelodyPlayer
+ */
+void StepSequencer::setTempo(int bpm, uint32_t sampleRate)
+{
+    if (bpm <= 0) return;
+    _stepLen = (uint32_t)((uint64_t)sampleRate * 60 * 256 * 4 / ((uint32_t)bpm * _steps));
+    _len64   = (uint32_t)((uint64_t)sampleRate * 60 * 256 * 4 / ((uint32_t)bpm * 64));
+}
+
+/**
+ * Start the pattern with the first step
+ */
+void StepSequencer::start()
+{
+    _step      = 0;
+    _next      = 0;
+    _hold      = UINT32_MAX;
+    _frac      = 0;
+    _countdown = 0;
+    _running   = (_stepLen > 0);
+}
+
+/**
+ * Continue with the step of the melody at position, the steps from until on
+ * are held. Both are given in 1/256 of a 64th
+ */
+void StepSequencer::sync(uint32_t position, uint32_t until)
+{
+    if (! _running) return;
+    uint32_t per  = (64 / _steps) << 8;     // length of a step
+    uint32_t step = position / per;         // the step the melody is in
+    if (_next != step && _next != step + 1) _next = (position + per - 1) / per;  // the melody jumped
+    _hold      = (until + per - 1) / per;
+    _step      = _next % _steps;
+    _frac      = 0;
+    _countdown = _next * per > position ? (uint32_t)((uint64_t)(_next * per - position) * _len64 >> 16) : 0;
+}
+
+/**
+ * Returns the events of the step which is due now and
+ * schedules the following step
+ */
+const SeqEvent *StepSequencer::nextStep(uint8_t &count)
+{
+    const SeqEvent *events = &_event[_first[_step]];
+    count = _first[_step + 1] - _first[_step];
+
+    _frac     += _stepLen;
+    _countdown = _frac >> 8;
+    _frac     &= 0xFF;
+    if (++_step >= _steps) _step = 0;
+    _next++;
+    return events;
+}
@@ -0,0 +1,65 @@
+/**
+ * Header       StepSequencer.h
+ *
+ * Purpose      Declaration of the class StepSequencer which plays drum patterns in the
+ *              DacSynth. A pattern has 16 or 32 steps per 4/4 bar and up to SEQ_LANES 
+ *              lanes, each lane plays one drum on the steps whose bit is set:
+ *
+ *                const DrumLane rock[] = 
+ *                {
+ *                  { DRUM::KICK,  100, 0b0000000100000001 },  // bit 0 is the first step
+ *                  { DRUM::SNARE,  80, 0b0001000000010000 },
+ *                  { DRUM::HIHAT,  50, 0b0101010101010101 },
+ *                };
+ *                const DrumPattern rockBeat = { 16, 3, rock };
+ *
+ *              setPattern() compiles the lanes into a timeline of events ordered by 
+ *              step, with the index of the first event of every step. Playing a step
+ *              then only walks the events of this step, whatever the number of lanes.
+ *
+ *              Between two calls of sync() the sequencer runs on the sample clock at
+ *              its tempo. sync() tells it where the melody is now and where its 
+ *              sounding note ends (in 1/256 of a 64th). The sequencer continues 
+ *              with the step at this position and holds before a step at or after 
+ *              the end of the note until the next note has started, so the drums
+ *              wait for the melody in the gaps between the notes and never drift away.
+ */
+#ifndef _STEPSEQUENCER_H_
+#define _STEPSEQUENCER_H_
+#include "DrumVoice.h"
+
+#define SEQ_STEPS 32
+#define SEQ_LANES 8
+
+typedef struct { DRUM drum; uint8_t volume; uint32_t steps; } DrumLane;
+typedef struct { uint8_t steps; uint8_t lanes; const DrumLane *lane; } DrumPattern;
+typedef struct { uint8_t voice; DRUM drum; uint8_t volume; } SeqEvent;
+
+class StepSequencer
+{
+    public:
+        void setPattern(const DrumPattern &pattern, uint8_t voices);
+        void setTempo(int bpm, uint32_t sampleRate);
+        void start();
+        void sync(uint32_t position, uint32_t until);
+        void stop() { _running = false; };
+        bool isRunning() { return _running; };
+        bool isHeld() { return _countdown == 0 && _next >= _hold; };
+        uint32_t samplesToNextStep() { return _countdown; };
+        const SeqEvent *nextStep(uint8_t &count);
+        void elapse(uint32_t samples) { _countdown -= samples; };
+
+    private:
+        SeqEvent _event[SEQ_STEPS * SEQ_LANES];
+        uint16_t _first[SEQ_STEPS + 1];     // index of the first event of each step
+        uint8_t  _steps     = 16;
+        uint8_t  _step      = 0;
+        uint32_t _next      = 0;            // steps played since start(), the next one to play
+        uint32_t _hold      = UINT32_MAX;   // steps from _hold on wait for the next sync()
+        bool     _running   = false;
+        uint32_t _stepLen   = 0;            // samples per step Q8
+        uint32_t _len64     = 0;            // samples per 64th Q8
+        uint32_t _frac      = 0;            // fraction of a sample carried to the next step Q8
+        uint32_t _countdown = 0;            // samples until the next step
+};
+#endif
@@ -0,0 +1,305 @@
+/**
+ * Class        StreamedMelody.cpp
+ *
+ * Purpose      Implements the double buffered reader of melody files. A buffer is
+ *              EMPTY, FILLING (refill() reads it, the lock is not held meanwhile)
+ *              or FULL. The player only takes FULL buffers and gives them back as
+ *              EMPTY, refill() reads the EMPTY one next to the playhead. Only refill()
+ *              reads the file while playing, seek() and close() wait until no read
+ *              is going on. On the host the prefetch task is a std::thread.
+ *
+ *              refill() claims a buffer and the notes to read under the lock, so
+ *              the task and the player calling refill() never read the same notes.
+ *
+ * References   https://www.freertos.org/xTaskCreateStatic.html
+ */
+#include <string.h>
+#include "StreamedMelody.h"
+#include "Songbook.h"
+#ifdef ARDUINO
+#include <esp_timer.h>
+#endif
+
+#define STREAM_ERROR_NOTE 0x010C  // a rest of 1/64 replaces the notes which can't be read
+
+StreamedMelody::~StreamedMelody()
+{
+    close();
+}
+
+void StreamedMelody::lock()
+{
+#ifdef ARDUINO
+    portENTER_CRITICAL(&_mux);
+#else
+    _mutex.lock();
+#endif
+}
+
+void StreamedMelody::unlock()
+{
+#ifdef ARDUINO
+    portEXIT_CRITICAL(&_mux);
+#else
+    _mutex.unlock();
+#endif
+}
+
+/**
+ * Open the melody file and read the first buffer. Returns false when the file
+ * can't be read or is not a melody file
+ */
+bool StreamedMelody::open(const char *path)
+{
+    uint8_t header[STREAM_HEADER];
+
+    close();
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) return false;
+    if (fread(header, STREAM_HEADER, 1, file) != 1 || memcmp(header, "MPKM", 4) != 0)
+    {
+        fclose(file);
+        return false;
+    }
+    lock();
+    _file   = file;
+    _tempo  = header[4] | header[5] << 8;
+    _length = header[6] | header[7] << 8;
+    unlock();
+    return seek(0);
+}
+
+/**
+ * Stop the prefetch task and close the file, waits for a read going on
+ */
+void StreamedMelody::close()
+{
+    stopPrefetch();
+    lockIdle();
+    FILE *file = _file;
+    _file   = nullptr;
+    _length = 0;
+    _epoch  = _epoch + 1;
+    _state[0] = EMPTY;
+    _state[1] = EMPTY;
+    unlock();
+    if (file) fclose(file);
+}
+
+/**
+ * Return true when the buffer b has been read. Under the lock, so its notes 
+ * are seen by the player
+ */
+bool StreamedMelody::isFull(uint8_t b)
+{
+    lock();
+    bool full = _state[b] == FULL;
+    unlock();
+    return full;
+}
+
+/**
+ * Take the lock when no read is going on
+ */
+void StreamedMelody::lockIdle()
+{
+    for (;;)
+    {
+        lock();
+        if (_state[0] != FILLING && _state[1] != FILLING) return;
+        unlock();
+#ifdef ARDUINO
+        vTaskDelay(1);
+#else
+        std::this_thread::yield();
+#endif
+    }
+}
+
+/**
+ * Discard both buffers and continue reading at index
+ */
+void StreamedMelody::reset(uint16_t index)
+{
+    lockIdle();
+    _epoch    = _epoch + 1;
+    _state[0] = EMPTY;
+    _state[1] = EMPTY;
+    _front = 0;
+    _next  = index;
+    _index = index;
+    unlock();
+}
+
+/**
+ * Continue with the note at index. The buffer of the playhead is read at once
+ */
+bool StreamedMelody::seek(int index)
+{
+    if (_file == nullptr || index < 0 || index > _length) return false;
+    reset(index);
+    if (index < _length) waitForBuffer(0);
+    return true;
+}
+
+/**
+ * Read the EMPTY buffer next to the playhead. Returns false when there was
+ * nothing to read. Called by the prefetch task or in idle time
+ */
+bool StreamedMelody::refill()
+{
+    lock();
+    uint8_t b = (_state[_front] == EMPTY) ? _front : _front ^ 1;
+    if (_file == nullptr || _state[b] != EMPTY || _next >= _length)
+    {
+        unlock();
+        return false;
+    }
+    uint16_t start = _next;
+    uint16_t count = min(_length - start, STREAM_BUFFER_NOTES);
+    uint16_t epoch = _epoch;
+    _state[b] = FILLING;
+    _next     = start + count;  // claimed, another refill() goes on after these notes
+    unlock();
+
+    if (_latencyUs > 0)
+    {
+#ifdef ARDUINO
+        delayMicroseconds(_latencyUs);
+#else
+        std::this_thread::sleep_for(std::chrono::microseconds(_latencyUs));
+#endif
+    }
+    uint8_t raw[2 * STREAM_BUFFER_NOTES];
+    bool ok = fseek(_file, STREAM_HEADER + 2 * start, SEEK_SET) == 0
+           && fread(raw, 2, count, _file) == count;
+    for (int i = 0; i < count; i++) _buffer[b][i] = ok ? raw[2 * i] | raw[2 * i + 1] << 8 : STREAM_ERROR_NOTE;
+
+    lock();
+    if (! ok) _stats.errors++;
+    if (epoch == _epoch)
+    {
+        _start[b] = start;
+        _count[b] = count;
+        _state[b] = FULL;
+        _stats.fills++;
+    }
+    else _state[b] = EMPTY;  // a seek came in between and has set _next
+    unlock();
+    return true;
+}
+
+/**
+ * Wait until the buffer b is FULL. Without a prefetch task the player reads it itself
+ */
+void StreamedMelody::waitForBuffer(uint8_t b)
+{
+#ifdef ARDUINO
+    int64_t start = esp_timer_get_time();
+#endif
+    while (! isFull(b))
+    {
+        if (! _task) refill();
+#ifdef ARDUINO
+        else
+        {
+            xTaskNotifyGive(_task);
+            vTaskDelay(1);
+        }
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    if (us > _stats.stallUs) _stats.stallUs = us;
+#else
+        else std::this_thread::yield();
+    }
+#endif
+}
+
+/**
+ * Take the next note from the buffer of the playhead, returns false at the end
+ * of the melody
+ */
+bool StreamedMelody::nextNote(musicNote &n)
+{
+    if (_file == nullptr || _index >= _length) return false;
+    uint8_t b = _front;
+    if (! isFull(b))
+    {
+        _stats.underruns++;
+        waitForBuffer(b);
+    }
+    uint16_t p = _buffer[b][_index - _start[b]];
+    _index++;
+    if (_index == _start[b] + _count[b])  // give the buffer back and go on with the other one
+    {
+        lock();
+        _state[b] = EMPTY;
+        _front    = b ^ 1;
+        unlock();
+#ifdef ARDUINO
+        if (_task) xTaskNotifyGive(_task);
+#endif
+    }
+    n.note   = PACKED_NOTE(p);
+    n.octave = PACKED_OCTAVE(p);
+    n.value  = (N_LEN)PACKED_LEN(p);
+    return true;
+}
+
+#ifdef ARDUINO
+void StreamedMelody::prefetchTask(void *arg)
+{
+    StreamedMelody *melody = (StreamedMelody *)arg;
+    while (melody->_running)
+    {
+        if (! melody->refill()) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+    }
+    melody->_parked = true;
+    for (;;) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // until stopPrefetch() deletes it
+}
+#endif
+
+/**
+ * Start a task which reads the buffers ahead. On the ESP32 it runs on core 0
+ * with a static stack, the player notifies it when a buffer has been played
+ */
+bool StreamedMelody::startPrefetch(uint8_t priority)
+{
+    if (_task) return true;
+    _running = true;
+#ifdef ARDUINO
+    _parked  = false;
+    _task = xTaskCreateStaticPinnedToCore(prefetchTask, "prefetch", STREAM_STACK, this,
+                                          priority, _stack, &_taskBuffer, 0);
+    return _task != nullptr;
+#else
+    _thread  = std::thread([this]()
+    {
+        while (_running) if (! refill()) std::this_thread::sleep_for(std::chrono::microseconds(100));
+    });
+    _task = true;
+    return true;
+#endif
+}
+
+/**
+ * Stop the prefetch task after its current read. On the ESP32 the task is 
+ * deleted while it is blocked, so its stack in this object is not used anymore
+ */
+void StreamedMelody::stopPrefetch()
+{
+    if (! _task) return;
+    _running = false;
+#ifdef ARDUINO
+    while (! _parked)
+    {
+        xTaskNotifyGive(_task);
+        vTaskDelay(1);
+    }
+    vTaskDelete(_task);
+    _task = nullptr;
+#else
+    if (_thread.joinable()) _thread.join();
+    _task = false;
+#endif
+}
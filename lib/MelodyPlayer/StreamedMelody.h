@@ -0,0 +1,106 @@
+/**
+ * Header       StreamedMelody.h
+ *
+ * Purpose      Declaration of the class StreamedMelody, a NoteSource which plays a
+ *              melody file (e.g. from LittleFS) without reading the file at the
+ *              note boundaries. Two buffers of STREAM_BUFFER_NOTES packed notes are
+ *              kept ahead of the playhead: the player takes the notes from one,
+ *              while the other is read by refill(). refill() runs in a task of low
+ *              priority (startPrefetch()) or is called in idle time, e.g. in the
+ *              loop when the player has nothing to do.
+ *
+ *              When the playhead reaches the end of its buffer before the next one
+ *              has been read, the player has to wait for it (or reads it itself,
+ *              when there is no prefetch task). stats() counts these underruns and
+ *              the longest wait. setReadLatency() adds a delay to each read, so
+ *              underruns can be provoked on the host with regular files.
+ *
+ *              close() and the destructor stop the prefetch task, after open() it
+ *              has to be started again.
+ *
+ *              File format (little endian), written by scripts/compile_melodies.py:
+ *              "MPKM", uint16 tempo, uint16 number of notes, packed notes (Songbook.h)
+ */
+#ifndef _STREAMEDMELODY_H_
+#define _STREAMEDMELODY_H_
+#include <stdio.h>
+#include <atomic>
+#include "NoteSource.h"
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <mutex>
+#include <thread>
+#endif
+
+#define STREAM_BUFFER_NOTES 32      // packed notes per buffer
+#define STREAM_HEADER       8       // bytes of the file header
+#define STREAM_STACK        3072    // stack of the prefetch task in bytes
+
+typedef struct
+{
+    uint32_t fills;         // buffers read
+    uint32_t underruns;     // the player had to wait for the next buffer
+    uint32_t stallUs;       // longest wait of the player in us (ESP32 only)
+    uint32_t errors;        // reads which failed, the notes are replaced by short rests
+} StreamStats;
+
+class StreamedMelody : public NoteSource
+{
+    public:
+        ~StreamedMelody();
+        bool open(const char *path);
+        void close();
+        bool isOpen() { return _file != nullptr; };
+        bool nextNote(musicNote &n) override;
+        void rewind() override { seek(0); };
+        int  tempo() override { return _tempo; };
+        int  position() override { return _index; };
+        bool seek(int index) override;
+        int  length() { return _length; };
+        bool refill();
+        bool startPrefetch(uint8_t priority = 1);
+        void setReadLatency(uint32_t us) { _latencyUs = us; };
+        StreamStats stats() { return _stats; };
+        void clearStats() { _stats = { 0, 0, 0, 0 }; };
+
+    private:
+        enum : uint8_t { EMPTY, FILLING, FULL };
+
+        void waitForBuffer(uint8_t b);
+        bool isFull(uint8_t b);
+        void reset(uint16_t index);
+        void stopPrefetch();
+        void lockIdle();
+        void lock();
+        void unlock();
+
+        FILE             *_file      = nullptr;
+        uint16_t          _buffer[2][STREAM_BUFFER_NOTES];
+        uint16_t          _start[2];            // index of the first note in the buffer
+        uint16_t          _count[2];            // notes in the buffer
+        volatile uint8_t  _state[2] = { EMPTY, EMPTY };
+        volatile uint8_t  _front     = 0;       // buffer of the playhead
+        volatile uint16_t _next      = 0;       // index of the first note of the next read
+        volatile uint16_t _epoch     = 0;       // a seek discards the reads begun before
+        uint16_t          _index     = 0;       // index of the next note
+        uint16_t          _length    = 0;
+        uint16_t          _tempo     = 0;
+        uint32_t          _latencyUs = 0;
+        StreamStats       _stats     = { 0, 0, 0, 0 };
+        std::atomic<bool> _running { false };   // the prefetch task goes on
+#ifdef ARDUINO
+        static void prefetchTask(void *arg);
+        portMUX_TYPE      _mux       = portMUX_INITIALIZER_UNLOCKED;
+        TaskHandle_t      _task      = nullptr;
+        StaticTask_t      _taskBuffer;
+        StackType_t       _stack[STREAM_STACK];
+        std::atomic<bool> _parked { false };    // the task has stopped and waits to be deleted
+#else
+        std::mutex        _mutex;
+        std::thread       _thread;
+        bool              _task      = false;
+#endif
+};
+#endif
@@ -0,0 +1,253 @@
+/**
+ * Class        TuningTable.cpp
+ *
+ * Purpose      Implements the tuning of the ledc output. The clock dividers of all
+ *              notes are computed in compile() whenever reference, temperament or
+ *              cents change, writeNote() only loads the precomputed divider into
+ *              the timer of the channel.
+ *
+ * References   https://docs.espressif.com/projects/esp-idf/en/v4.4/esp32/api-reference/peripherals/ledc.html
+ *              https://en.wikipedia.org/wiki/Just_intonation
+ */
+#include <math.h>
+#include "TuningTable.h"
+#ifdef ARDUINO
+#include <driver/ledc.h>
+#include <soc/ledc_reg.h>
+#else
+// Fields of the ledc timer configuration register (ESP32 TRM), to compute the tables on the host
+#define LEDC_HSTIMER0_LIM_S     0
+#define LEDC_DIV_NUM_HSTIMER0_S 5
+#define LEDC_DIV_NUM_HSTIMER0_V 0x3FFFF
+#define LEDC_TICK_SEL_HSTIMER0  (1U << 25)
+#define LEDC_LSTIMER0_PARA_UP   (1U << 26)
+#endif
+
+#define APB_CLK_HZ      80000000.0f
+#define REF_TICK_HZ      1000000.0f
+#define DIVIDER_MIN      0x100     // 1.0 in 10.8 fixed point
+#define DIVIDER_MAX      0x3FFFF   // 1023.996 in 10.8 fixed point
+#define TIMER_STRIDE     8         // bytes between the configuration registers of two timers
+
+// Intervals of the just major scale and its chromatic notes relative to the tonic
+static const float justRatio[12] = { 1.0f, 16.0f/15, 9.0f/8, 6.0f/5, 5.0f/4, 4.0f/3,
+                                     45.0f/32, 3.0f/2, 8.0f/5, 5.0f/3, 9.0f/5, 15.0f/8 };
+
+// Table used by ledcWriteNote() for octave 8, A4 = 440 Hz
+static const uint16_t ledcNoteBase[12] = { 4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902 };
+
+#ifdef ARDUINO
+static const char *noteName[12] = { "C", "C#", "D", "Eb", "E", "F", "F#", "G", "G#", "A", "Bb", "B" };
+#endif
+
+/**
+ * Return the divider of the ledc timer for frequency f at 10 bit resolution.
+ * Falls back to the REF_TICK clock when the divider for the APB clock is too large
+ */
+uint32_t TuningTable::divider(float f)
+{
+    uint32_t div = (uint32_t)lroundf(APB_CLK_HZ * 256.0f / 1024.0f / f);
+    if (div <= DIVIDER_MAX) return max(div, (uint32_t)DIVIDER_MIN);
+    div = (uint32_t)lroundf(REF_TICK_HZ * 256.0f / 1024.0f / f);
+    return min(div, (uint32_t)DIVIDER_MAX) | TUNING_REF_TICK;
+}
+
+/**
+ * Return the frequency output by the ledc timer with divider div
+ */
+float TuningTable::frequency(uint32_t div)
+{
+    float clk = (div & TUNING_REF_TICK) ? REF_TICK_HZ : APB_CLK_HZ;
+    return clk * 256.0f / 1024.0f / (float)(div & ~TUNING_REF_TICK);
+}
+
+/**
+ * Return the value of the configuration register of the ledc timer of the 
+ * channel (duty resolution, clock divider and clock source) for the divider
+ * div as returned by divider(). Writing it changes the frequency at once
+ */
+uint32_t TuningTable::timerConfig(uint32_t div, uint8_t channel)
+{
+    uint32_t conf = (LEDC_NOTE_RESOLUTION << LEDC_HSTIMER0_LIM_S)
+                  | ((div & ~TUNING_REF_TICK) << LEDC_DIV_NUM_HSTIMER0_S);
+    if (! (div & TUNING_REF_TICK)) conf |= LEDC_TICK_SEL_HSTIMER0;  // 1 = APB clock
+    if (channel >= 8) conf |= LEDC_LSTIMER0_PARA_UP;  // low speed timers take the new values on update
+    return conf;
+}
+
+/**
+ * Return the divider contained in the value of a timer configuration register
+ */
+uint32_t TuningTable::configDivider(uint32_t conf)
+{
+    uint32_t div = (conf >> LEDC_DIV_NUM_HSTIMER0_S) & LEDC_DIV_NUM_HSTIMER0_V;
+    return (conf & LEDC_TICK_SEL_HSTIMER0) ? div : div | TUNING_REF_TICK;
+}
+
+/**
+ * Return the frequency ledcWriteNote() plays for the note, 0 for a REST
+ */
+float TuningTable::ledcNote(note_t note, uint8_t octave)
+{
+    if (note >= NOTE_MAX || octave > 8) return 0.0f;
+    return frequency(divider((float)(uint32_t)(ledcNoteBase[note] / (float)(1 << (8 - octave)))));
+}
+
+#ifdef ARDUINO
+/**
+ * Return the address of the configuration register of the timer of the channel
+ */
+volatile uint32_t *TuningTable::timerRegister(uint8_t channel)
+{
+    uint32_t base = (channel >= 8) ? LEDC_LSTIMER0_CONF_REG : LEDC_HSTIMER0_CONF_REG;
+    return (volatile uint32_t *)(base + TIMER_STRIDE * ((channel / 2) % 4));
+}
+#endif
+
+static float cents(float f, float reference)
+{
+    return 1200.0f * log2f(f / reference);
+}
+
+/**
+ * Set the frequency of A4 in Hz
+ */
+void TuningTable::setReference(float reference)
+{
+    _reference = constrain(reference, 400.0f, 480.0f);
+    compile();
+}
+
+/**
+ * Set equal temperament or just intonation. Just intonation is
+ * relative to the tonic, which itself is tuned in equal temperament
+ */
+void TuningTable::setTemperament(TEMPERAMENT temperament, note_t tonic)
+{
+    _temperament = temperament;
+    _tonic       = (tonic < NOTE_MAX) ? tonic : NOTE_C;
+    compile();
+}
+
+/**
+ * Shift the note (in all octaves) by cents
+ */
+void TuningTable::setCents(note_t note, int16_t cents)
+{
+    if (note >= NOTE_MAX) return;
+    _cents[note] = constrain(cents, -100, 100);
+    compile();
+}
+
+/**
+ * Remove the offsets of all notes
+ */
+void TuningTable::clearCents()
+{
+    memset(_cents, 0, sizeof(_cents));
+    compile();
+}
+
+/**
+ * Return the frequency in Hz the note should have in the actual tuning
+ */
+float TuningTable::requested(note_t note, uint8_t octave)
+{
+    int   n = 12 * octave + note;
+    float f;
+
+    if (_temperament == TEMPERAMENT::JUST)
+    {
+        int interval = (note - _tonic + 12) % 12;
+        f = _reference * exp2f((n - interval - 57) / 12.0f) * justRatio[interval];
+    }
+    else f = _reference * exp2f((n - 57) / 12.0f);  // 57 is A4
+
+    return f * exp2f(_cents[note] / 1200.0f);
+}
+
+/**
+ * Return the frequency in Hz the ledc timer outputs for the note
+ */
+float TuningTable::achieved(note_t note, uint8_t octave)
+{
+    if (note >= NOTE_MAX || octave >= TUNING_OCTAVES) return 0.0f;
+    if (! _compiled) compile();
+    return frequency(_divider[octave][note]);
+}
+
+/**
+ * Return the largest deviation in cents of all notes
+ */
+float TuningTable::maxErrorCents()
+{
+    float maxError = 0.0f;
+    for (int o = 0; o < TUNING_OCTAVES; o++)
+    {
+        for (int i = 0; i < 12; i++)
+        {
+            float e = fabsf(cents(achieved((note_t)i, o), requested((note_t)i, o)));
+            if (e > maxError) maxError = e;
+        }
+    }
+    return maxError;
+}
+
+/**
+ * Compute the divider of the ledc timer for each note and octave
+ */
+void TuningTable::compile()
+{
+    for (int o = 0; o < TUNING_OCTAVES; o++)
+    {
+        for (int i = 0; i < 12; i++)
+        {
+            _divider[o][i] = divider(requested((note_t)i, o));
+        }
+    }
+    _compiled = true;
+}
+
+#ifdef ARDUINO
+/**
+ * Tune the timer of the ledc channel to the note. The timer must have been set up
+ * with ledcSetup() at 10 bit resolution. Returns false for a REST, the caller
+ * then has to switch off the channel
+ */
+bool TuningTable::writeNote(uint8_t channel, note_t note, uint8_t octave)
+{
+    if (note >= NOTE_MAX || octave >= TUNING_OCTAVES) return false;
+    if (! _compiled) compile();
+
+    uint32_t div = _divider[octave][note];
+    ledc_timer_set((ledc_mode_t)(channel / 8), (ledc_timer_t)((channel / 2) % 4),
+                   div & ~TUNING_REF_TICK, LEDC_NOTE_RESOLUTION,
+                   (div & TUNING_REF_TICK) ? LEDC_REF_TICK : LEDC_APB_CLK);
+    return true;
+}
+
+/**
+ * Print requested and achieved frequency of all notes with the error in cents,
+ * compared to the error of ledcWriteNote() which plays integer Hz for A4 = 440 Hz
+ */
+void TuningTable::report(Print &out)
+{
+    if (! _compiled) compile();
+    out.printf("Tuning A4 = %.2f Hz, %s\r\n", _reference,
+               (_temperament == TEMPERAMENT::JUST) ? "just intonation" : "equal temperament");
+    out.printf("note   requested    achieved  clock   error  ledcWriteNote\r\n");
+    for (int o = 0; o < TUNING_OCTAVES; o++)
+    {
+        for (int i = 0; i < 12; i++)
+        {
+            float f      = requested((note_t)i, o);
+            float fTuned = achieved((note_t)i, o);
+            float fNote  = ledcNote((note_t)i, o);
+            out.printf("%-2s%d %11.3f %11.3f  %-6s %+6.2f %+8.2f ct\r\n", noteName[i], o, f, fTuned,
+                       (_divider[o][i] & TUNING_REF_TICK) ? "REF" : "APB",
+                       cents(fTuned, f), cents(fNote, f));
+        }
+    }
+    out.printf("max error %.2f cents\r\n", maxErrorCents());
+}
+#endif
@@ -0,0 +1,68 @@
+/**
+ * Header       TuningTable.h
+ *
+ * Purpose      Declaration of the class TuningTable which tunes the notes of the
+ *              ledc output to a reference pitch (e.g. A4 = 442 Hz), in equal
+ *              temperament or just intonation, with an offset in cents per note.
+ *
+ *              ledcWriteNote() uses a fixed table for A4 = 440 Hz and passes the
+ *              frequency as integer Hz to the timer. The TuningTable instead computes
+ *              the clock divider of the ledc timer for each note and octave once,
+ *              when the tuning is changed. Playing a note only writes the divider.
+ *
+ *              The ledc timer divides the APB clock of 80 MHz by a divider in 10.8
+ *              fixed point (1.0 .. 1023.996) and by 2^10 for the 10 bit duty cycle.
+ *              Notes below 76.3 Hz need the 1 MHz REF_TICK clock, which is tuned
+ *              less precisely. report() lists the error of each note in cents.
+ *              The table is computed when it is first used, not in the constructor,
+ *              so a global TuningTable costs nothing before setup().
+ *
+ * Constructor
+ * arguments    reference   frequency of A4 in Hz
+ */
+#ifndef _TUNINGTABLE_H_
+#define _TUNINGTABLE_H_
+#include "MelodyTypes.h"
+
+#define TUNING_OCTAVES  9       // octaves 0..8
+#define TUNING_REF_TICK 0x80000000  // divider is for the REF_TICK clock
+
+enum class TEMPERAMENT { EQUAL, JUST };
+
+class TuningTable
+{
+    public:
+        TuningTable(float reference = 440.0f) : _reference(reference) {};
+        void  setReference(float reference);
+        void  setTemperament(TEMPERAMENT temperament, note_t tonic = NOTE_C);
+        void  setCents(note_t note, int16_t cents);
+        void  clearCents();
+        float getReference() { return _reference; };
+        TEMPERAMENT getTemperament() { return _temperament; };
+        float requested(note_t note, uint8_t octave);
+        float achieved(note_t note, uint8_t octave);
+        float maxErrorCents();
+#ifdef ARDUINO
+        bool  writeNote(uint8_t channel, note_t note, uint8_t octave);
+        void  report(Print &out);
+#endif
+        static uint32_t divider(float f);
+        static float    frequency(uint32_t div);
+        static uint32_t timerConfig(uint32_t div, uint8_t channel);
+        static uint32_t configDivider(uint32_t conf);
+        static float    ledcNote(note_t note, uint8_t octave);
+#ifdef ARDUINO
+        static volatile uint32_t *timerRegister(uint8_t channel);
+#endif
+
+    private:
+        void  compile();
+
+        float       _reference   = 440.0f;
+        TEMPERAMENT _temperament = TEMPERAMENT::EQUAL;
+        note_t      _tonic       = NOTE_C;
+        int16_t     _cents[12]   = { 0 };  // offset per note in cents
+        uint32_t    _divider[TUNING_OCTAVES][12];  // 10.8 clock divider, TUNING_REF_TICK flags the slow clock
+        bool        _compiled    = false;
+};
+#endif
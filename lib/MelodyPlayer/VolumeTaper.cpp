@@ -0,0 +1,23 @@
+/**
+ * Module       VolumeTaper.cpp
+ *
+ * Purpose      Table of the log taper: 65535 * 10^((v - 100) / 40) for v = 1..100
+ */
+#include "VolumeTaper.h"
+
+const uint16_t volumeTaper[VOLUME_MAX + 1] =
+{
+        0,   220,   233,   246,   261,   276,   293,   310,   328,   348,
+      369,   390,   413,   438,   464,   491,   521,   551,   584,   619,
+      655,   694,   735,   779,   825,   874,   926,   981,  1039,  1100,
+     1165,  1234,  1308,  1385,  1467,  1554,  1646,  1744,  1847,  1956,
+     2072,  2195,  2325,  2463,  2609,  2764,  2927,  3101,  3285,  3479,
+     3685,  3904,  4135,  4380,  4640,  4914,  5206,  5514,  5841,  6187,
+     6554,  6942,  7353,  7789,  8250,  8739,  9257,  9806, 10387, 11002,
+    11654, 12344, 13076, 13851, 14671, 15541, 16462, 17437, 18470, 19565,
+    20724, 21952, 23253, 24631, 26090, 27636, 29273, 31008, 32845, 34792,
+    36853, 39037, 41350, 43800, 46395, 49144, 52056, 55141, 58408, 61869,
+    65535
+};
+
+const uint32_t timbreWidth[3] = { 8192, 16384, 32768 };
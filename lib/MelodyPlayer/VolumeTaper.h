@@ -0,0 +1,41 @@
+/**
+ * Header       VolumeTaper.h
+ *
+ * Purpose      Log taper for the perceived volume 0..100. Equal steps of the volume
+ *              sound like equal steps of loudness: the amplitude falls by 0.5 dB per
+ *              step, from full amplitude at 100 to -50 dB at 1. Volume 0 is silent.
+ *              The values are fractions of the full amplitude in Q16.
+ *
+ *              For the pulse outputs the taper is combined with the pulse width of 
+ *              the timbre. pulseDuty() keeps at least one step of the timer for
+ *              every volume above 0: at 10 bit the volumes 1..16 with PULSE_12 
+ *              would be truncated to a duty cycle of 0 and be silent. So the
+ *              quietest volumes all play the narrowest pulse of the timer.
+ */
+#ifndef _VOLUMETAPER_H_
+#define _VOLUMETAPER_H_
+#include "MelodyTypes.h"
+
+#define VOLUME_MAX 100
+
+extern const uint16_t volumeTaper[VOLUME_MAX + 1];
+extern const uint32_t timbreWidth[3];   // pulse width of PULSE_12, PULSE_25 and PULSE_50 in Q16
+
+/**
+ * Pulse width for the volume 0..100 and the timbre as fraction of the period in Q16
+ */
+inline uint32_t pulseLevel(uint32_t volume, TIMBRE timbre)
+{
+    return (volumeTaper[min(volume, (uint32_t)VOLUME_MAX)] * timbreWidth[(int)timbre]) >> 16;
+}
+
+/**
+ * Duty cycle of the pulse width level for a timer with resolution bits,
+ * at least 1 when level is not 0
+ */
+inline uint32_t pulseDuty(uint32_t level, uint8_t resolution)
+{
+    uint32_t duty = level >> (16 - resolution);
+    return (duty == 0 && level != 0) ? 1 : duty;
+}
+#endif
@@ -0,0 +1,133 @@
+/**
+ * Class        WavOutput.cpp
+ *
+ * Purpose      Implements the WAV file output. The samples of a note are rendered
+ *              when the next event arrives, up to the time of that event. Like 
+ *              the ledc output the wave switches between 0 and full scale, the 
+ *              volume and the timbre set its pulse width.
+ *
+ * References   http://soundfile.sapp.org/doc/WaveFormat/
+ */
+#include "WavOutput.h"
+#include "VolumeTaper.h"
+
+// Frequencies of the notes in octave 8, the same as used by ledcWriteNote()
+static const uint16_t noteFrequency[12] = { 4186, 4435, 4699, 4978, 5274, 5588, 5920, 6272, 6645, 7040, 7459, 7902 };
+
+static void put32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static void put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+
+/**
+ * Create the file and write the header, the sizes are filled in by close()
+ */
+void WavOutput::begin()
+{
+    uint8_t header[44];
+
+    _file = fopen(_path, "wb");
+    if (_file == nullptr) return;
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, 36);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);             // size of the format chunk
+    put16(header + 20, 1);              // PCM
+    put16(header + 22, 1);              // mono
+    put32(header + 24, _sampleRate);
+    put32(header + 28, _sampleRate);    // bytes per second
+    put16(header + 32, 1);              // bytes per sample
+    put16(header + 34, 8);              // bits per sample
+    memcpy(header + 36, "data", 4);
+    put32(header + 40, 0);
+    fwrite(header, 1, sizeof(header), _file);
+}
+
+/**
+ * Set the pulse width for the volume 0..100 and the timbre,
+ * it applies from the next note on
+ */
+void WavOutput::setLevel(uint32_t volume, TIMBRE timbre)
+{
+    _width = volumeTaper[volume] * timbreWidth[(int)timbre];  // Q16 * Q16 = Q32
+}
+
+/**
+ * Render up to ms, then start the note. A REST is silence
+ */
+void WavOutput::noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration)
+{
+    if (! _started)
+    {
+        _started = true;
+        _msFirst = ms;
+    }
+    render(ms);
+    if (note >= REST || octave > 8) 
+    {
+        _inc = 0;
+        return;
+    }
+    uint64_t f = ((uint64_t)noteFrequency[note] << 32) >> (8 - octave);  // Hz in Q32
+    _inc       = (uint32_t)(f / _sampleRate);
+    _noteWidth = _width;
+    _phase     = 0;
+}
+
+/**
+ * Render up to ms, then switch off
+ */
+void WavOutput::noteOff(uint32_t ms)
+{
+    if (! _started) return;
+    render(ms);
+    _inc = 0;
+}
+
+/**
+ * Render up to ms, write the sizes into the header and close the file
+ */
+void WavOutput::close(uint32_t ms)
+{
+    if (_file == nullptr) return;
+    if (_started) render(ms);
+    flush();
+
+    uint8_t size[4];
+    put32(size, 36 + _samples);
+    fseek(_file, 4, SEEK_SET);
+    fwrite(size, 1, 4, _file);
+    put32(size, _samples);
+    fseek(_file, 40, SEEK_SET);
+    fwrite(size, 1, 4, _file);
+    fclose(_file);
+    _file = nullptr;
+}
+
+/**
+ * Write the samples of the actual note up to the time ms
+ */
+void WavOutput::render(uint32_t ms)
+{
+    if (_file == nullptr) return;
+    uint32_t end = (uint32_t)((uint64_t)(ms - _msFirst) * _sampleRate / 1000);
+    while (_samples < end)
+    {
+        uint8_t sample = 0;
+        if (_inc)
+        {
+            sample  = (_phase < _noteWidth) ? 255 : 0;
+            _phase += _inc;
+        }
+        _buffer[_fill++] = sample;
+        _samples++;
+        if (_fill == WAV_BUFFER) flush();
+    }
+}
+
+/**
+ * Write the buffered samples into the file
+ */
+void WavOutput::flush()
+{
+    if (_fill) fwrite(_buffer, 1, _fill, _file);
+    _fill = 0;
+}
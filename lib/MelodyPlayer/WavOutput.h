@@ -0,0 +1,50 @@
+/**
+ * Header       WavOutput.h
+ *
+ * Purpose      Declaration of the class WavOutput, an output policy of the 
+ *              BasicMelodyPlayer which writes the pulse wave of the ledc output
+ *              into a WAV file (8 bit mono) instead of playing it. The file is
+ *              written with stdio, on the host or on a mounted file system of
+ *              the ESP32 (e.g. "/littlefs/melody.wav"). Call close() at the end.
+ *
+ * Constructor
+ * arguments    path        name of the WAV file
+ *              sampleRate  samples per second, 16000 by default
+ */
+#ifndef _WAVOUTPUT_H_
+#define _WAVOUTPUT_H_
+#include <stdio.h>
+#include "MelodyTypes.h"
+
+#define WAV_BUFFER 256
+
+class WavOutput
+{
+    public:
+        WavOutput(const char *path, uint32_t sampleRate = 16000) : _path(path), _sampleRate(sampleRate) {};
+        void begin();
+        void setLevel(uint32_t volume, TIMBRE timbre);
+        void noteOn(note_t note, uint8_t octave, uint32_t ms, uint32_t msDuration);
+        void noteOff(uint32_t ms);
+        void close(uint32_t ms);
+        bool isOpen() { return _file != nullptr; };
+        uint32_t samples() { return _samples; };
+
+    private:
+        void render(uint32_t ms);
+        void flush();
+
+        const char *_path;
+        uint32_t _sampleRate;
+        FILE    *_file     = nullptr;
+        bool     _started  = false;   // the first note has been played
+        uint32_t _msFirst  = 0;       // time of the first note, the start of the file
+        uint32_t _samples  = 0;       // samples written
+        uint32_t _phase    = 0;       // phase of the pulse wave 0..2^32
+        uint32_t _inc      = 0;       // phase increment per sample, 0 = silence
+        uint32_t _width    = 0;       // pulse width for volume and timbre in Q32
+        uint32_t _noteWidth = 0;      // pulse width of the sounding note
+        uint16_t _fill     = 0;
+        uint8_t  _buffer[WAV_BUFFER];
+};
+#endif
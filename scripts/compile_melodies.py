@@ -0,0 +1,772 @@
+"""
+Script       compile_melodies.py
+
+Purpose      PlatformIO extra script which compiles the melodies in the directory
+             melodies/ (*.rtttl, *.abc, *.mid) into packed tables in flash and a
+             registry of all melodies (see lib/MelodyPlayer/Songbook.h).
+
+             Phrases which repeat within or across the melodies are stored once in
+             a shared phrase dictionary, the melodies refer to them (note code 13).
+             The player follows the references with a small stack, nothing is
+             expanded into RAM. The report shows the flash saved by the dictionary.
+             The dictionary is cached with the melodies: it is only searched again
+             when a melody has changed, and its phrases keep their index then.
+
+             The metadata of each melody (notes, duration, pitch range) is computed
+             by the C++ compiler with the constexpr packedInfo() (Songbook.h) and
+             stored in flash next to the melody, the registry points to it. The
+             phrases are generated as constexpr arrays into src/songbook/phrases.h
+             for it.
+
+             The generated files are written to src/songbook/. Each melody is also
+             written as a file data/<name>.mel for the LittleFS image (pio run -t
+             uploadfs), which StreamedMelody plays from the file system. A melody is only
+             compiled again when its source file has changed, files are only
+             rewritten when their content changes, so the build stays incremental.
+             After compiling, a report with the size and duration of each melody
+             is printed.
+
+Usage        platformio.ini:   extra_scripts = pre:scripts/compile_melodies.py
+             or standalone:    python scripts/compile_melodies.py [project_dir]
+"""
+import hashlib
+import heapq
+import json
+import os
+import re
+import struct
+import sys
+
+SOURCE_DIR = "melodies"
+OUTPUT_DIR = os.path.join("src", "songbook")
+DATA_DIR   = "data"
+CACHE_FILE = ".cache.json"
+EXTENSIONS = (".rtttl", ".abc", ".mid")
+VERSION    = 4      # increment when the generated code changes
+
+REST    = 12
+MAX_LEN = 255       # longest packed note in 64ths
+NOTE_GAP = 10       # ms between the notes, the default of setLegato() and melodyMs()
+
+PHRASE_REF   = 13   # note code of a reference, bits 15..4 are the index of the phrase
+MIN_PHRASE   = 3    # shortest phrase in packed words
+MAX_PHRASE   = 64   # longest phrase in packed words
+MAX_PHRASES  = 4096
+PHRASE_DEPTH = 4    # nesting of phrases, as PHRASE_DEPTH in Songbook.h
+PHRASE_COST  = 4    # words of a dictionary entry (pointer, length, expanded length)
+
+
+# ----------------------------------------------------------------------------
+# RTTTL  name:d=4,o=5,b=100:8e6,8d#6,p,...
+# ----------------------------------------------------------------------------
+def parse_rtttl(text):
+    name, defaults, body = text.strip().split(":", 2)
+    opts = dict(kv.strip().split("=") for kv in defaults.split(",") if "=" in kv)
+    dflt_len = int(opts.get("d", 4))
+    dflt_oct = int(opts.get("o", 6))
+    tempo    = int(opts.get("b", 63))
+    pitches  = {"c": 0, "d": 2, "e": 4, "f": 5, "g": 7, "a": 9, "b": 11}
+    notes = []
+    for token in body.split(","):
+        m = re.match(r"\s*(\d*)([a-gA-GpP])(#?)(\.?)(\d?)(\.?)\s*$", token)
+        if not m:
+            continue
+        length = 64 // int(m.group(1) or dflt_len)
+        if m.group(4) or m.group(6):
+            length = length * 3 // 2
+        octave = int(m.group(5) or dflt_oct)
+        letter = m.group(2).lower()
+        if letter == "p":
+            notes.append((REST, 4, length))
+            continue
+        pitch = pitches[letter] + (1 if m.group(3) else 0)
+        if pitch == 12:
+            pitch, octave = 0, octave + 1
+        notes.append((pitch, octave, length))
+    return name.strip(), tempo, notes
+
+
+# ----------------------------------------------------------------------------
+# ABC  the same subset as the AbcParser on the device, lengths in 192ths
+# ----------------------------------------------------------------------------
+def parse_abc(text):
+    semitone = {"c": 0, "d": 2, "e": 4, "f": 5, "g": 7, "a": 9, "b": 11}
+    fifths   = {"c": 0, "d": 2, "e": 4, "f": -1, "g": 1, "a": 3, "b": 5}
+    modes    = [("mix", -1), ("maj", 0), ("m", -3), ("aeo", -3), ("dor", -2),
+                ("phr", -4), ("lyd", 1), ("loc", -5)]
+    st = {"unit": 24, "unit_set": False, "bar": 192, "tempo": 0, "key": {}, "title": None}
+
+    def frac(s, default=1):
+        m = re.match(r"(\d+)(?:/(\d+))?", s)
+        return (int(m.group(1)), int(m.group(2) or 1)) if m else (default, 1)
+
+    def field(f, v):
+        v = v.strip()
+        if f == "T" and st["title"] is None:
+            st["title"] = v
+        elif f == "L":
+            n, d = frac(v)
+            st["unit"], st["unit_set"] = 192 * n // d, True
+        elif f == "M":
+            n, d = (2, 2) if v.startswith("C|") else (4, 4) if v.startswith("C") else frac(v, 4)
+            if v and v[0].isdigit() and "/" in v:
+                n, d = sum(int(x) for x in v.split("/")[0].split("+")), int(v.split("/")[1])
+            st["bar"] = 192 * n // d
+            if not st["unit_set"]:
+                st["unit"] = 12 if 4 * n < 3 * d else 24
+        elif f == "Q":
+            v = re.sub(r'"[^"]*"', "", v)
+            if "=" in v:
+                beat = sum(192 * n // d for n, d in (frac(x) for x in v.split("=")[0].split()))
+                bpm = int(re.match(r"\s*(\d*)", v.split("=")[1]).group(1) or 0)
+            else:
+                beat, bpm = st["unit"], int(re.match(r"(\d*)", v).group(1) or 0)
+            if beat and bpm:
+                st["tempo"] = bpm * beat // 48
+        elif f == "K":
+            st["key"] = {}
+            m = re.match(r"([A-G])([#b]?)\s*([A-Za-z]*)(.*)", v)
+            if not m:
+                return
+            sharps = fifths[m.group(1).lower()] + {"#": 7, "b": -7, "": 0}[m.group(2)]
+            mode = m.group(3).lower()
+            sharps += next((o for p, o in modes if mode.startswith(p)), 0)
+            sharps = max(-7, min(7, sharps))
+            for letter in "fcgdaeb"[:max(sharps, 0)]:
+                st["key"][letter] = 1
+            for letter in "beadgcf"[:max(-sharps, 0)]:
+                st["key"][letter] = -1
+            for word in (m.group(3) + m.group(4)).split():
+                if re.fullmatch(r"[_^=][a-gA-G]", word):
+                    st["key"][word[1].lower()] = {"^": 1, "_": -1, "=": 0}[word[0]]
+
+    lines = text.splitlines()
+    body = []
+    in_body = False
+    for line in lines:
+        if not in_body:
+            if re.match(r"[A-Za-z]:", line):
+                field(line[0], line[2:].split("%")[0])
+                in_body = line[0] == "K"
+            continue
+        if not line.strip():
+            break                               # an empty line ends the tune
+        if re.match(r"[A-Za-z]:", line):
+            if line[0] == "X":
+                break
+            body.append("[%s:%s]" % (line[0], line[2:].split("%")[0].strip()))
+        else:
+            body.append(line.split("%")[0])
+    body = " ".join(body)
+    body = re.sub(r'"[^"]*"|![^!]*!|\+[^+]*\+|\{[^}]*\}', "", body)
+
+    body = expand_repeats(body)
+
+    notes, time = [], 0
+    bar_acc = {}
+    broken = (1, 1)
+    tuplet = (0, 0, 0, 0)                   # p notes in the time of q, r left, remainder
+    pos = 0
+    note_re = re.compile(r"([_^=]*)([A-Ga-gzxZ])([',]*)(\d*)((?:/\d*)*)")
+
+    def length(num, slashes, base):
+        n = int(num) if num else 1
+        d = 1
+        for s in re.findall(r"/(\d*)", slashes):
+            d *= int(s) if s else 2
+        return base * n // d
+
+    while pos < len(body):
+        c = body[pos]
+        if c == "|":
+            bar_acc = {}
+            pos += 1
+            continue
+        m = re.match(r"\[([A-Za-z]):([^\]]*)\]", body[pos:])
+        if m:
+            field(m.group(1), m.group(2))
+            pos += m.end()
+            continue
+        m = re.match(r"\((\d)(?::(\d*))?(?::(\d*))?", body[pos:])
+        if m:
+            p = int(m.group(1))
+            q = int(m.group(2)) if m.group(2) else {2: 3, 3: 2, 4: 3, 6: 2, 8: 3}.get(p, 2)
+            r = int(m.group(3)) if m.group(3) else p
+            tuplet = (p, q, r if p else 0, 0)
+            pos += m.end()
+            continue
+        chord = c == "["
+        m = note_re.match(body, pos + 1 if chord else pos)
+        if not m:
+            pos += 1
+            continue
+        pos = m.end()
+        acc, letter, marks, num, slashes = m.groups()
+        if letter in "zx":
+            pitch, octave, ln = REST, 4, length(num, slashes, st["unit"])
+        elif letter == "Z":
+            pitch, octave, ln = REST, 4, st["bar"] * (int(num) if num else 1)
+        else:
+            octave = 5 if letter.islower() else 4
+            octave += marks.count("'") - marks.count(",")
+            octave = max(0, min(8, octave))
+            l = letter.lower()
+            if acc:
+                a = 0 if "=" in acc else acc.count("^") - acc.count("_")
+                bar_acc[(octave, l)] = a
+            else:
+                a = bar_acc.get((octave, l), st["key"].get(l, 0))
+            pitch = semitone[l] + a
+            if pitch < 0:
+                pitch, octave = pitch + 12, octave - 1
+            if pitch >= 12:
+                pitch, octave = pitch - 12, octave + 1
+            ln = length(num, slashes, st["unit"])
+        if chord:
+            end = body.find("]", pos)
+            pos = len(body) if end < 0 else end + 1
+            m = re.match(r"(\d*)((?:/\d*)*)", body[pos:])
+            ln = length(m.group(1), m.group(2), ln)
+            pos += m.end()
+        ln = ln * broken[0] // broken[1]
+        broken = (1, 1)
+        m = re.match(r"\s*(>+|<+)", body[pos:])
+        if m:
+            den = 2 ** len(m.group(1))
+            if m.group(1)[0] == ">":
+                ln, broken = ln * (2 * den - 1) // den, (1, den)
+            else:
+                ln, broken = ln // den, (2 * den - 1, den)
+            pos += m.end()
+        if tuplet[2] > 0:
+            ln, rest = divmod(ln * tuplet[1] + tuplet[3], tuplet[0])
+            tuplet = (tuplet[0], tuplet[1], tuplet[2] - 1, rest)
+        len64 = (time + ln) // 3 - time // 3
+        time += ln
+        if len64 > 0:
+            notes.append((pitch, max(0, min(8, octave)), len64))
+    return st["title"], st["tempo"], notes
+
+
+def expand_repeats(body):
+    """Unfold repeats and first and second endings the same way as AbcParser::parseBar()"""
+    out, pos, start, second = [], 0, 0, False
+    skip_ending = re.compile(r":[|:][:|\]\[ ]*[\d,-]*")
+
+    def is_bar(i):
+        return body[i] in "|:" or (body[i] == "[" and i + 1 < len(body) and (body[i + 1].isdigit() or body[i + 1] == "|"))
+
+    while pos < len(body):
+        m = re.match(r"\[[A-Za-z]:[^\]]*\]", body[pos:])
+        if m:
+            out.append(m.group())               # inline field
+            pos += m.end()
+            continue
+        if not is_bar(pos):
+            out.append(body[pos])
+            pos += 1
+            continue
+        colons, bar, repeat_start = 0, False, False
+        while pos < len(body) and body[pos] == ":":
+            pos, colons = pos + 1, colons + 1
+        while pos < len(body) and body[pos] in "|[]":
+            if body[pos] == "[" and not (pos + 1 < len(body) and (body[pos + 1].isdigit() or body[pos + 1] == "|")):
+                break
+            pos, bar = pos + 1, True
+        if pos < len(body) and body[pos] == ":":
+            while pos < len(body) and body[pos] == ":":
+                pos += 1
+            repeat_start = True
+        if colons >= 2 and not bar:
+            repeat_start = True
+        out.append("|")                         # resets the bar accidentals
+        if colons and not second:
+            pos, second = start, True           # play the section a second time
+            continue
+        if colons or repeat_start:
+            start, second = pos, False
+        if pos < len(body) and body[pos].isdigit():
+            if body[pos] == "1" and second:
+                m = skip_ending.search(body, pos)
+                pos = m.end() if m else len(body)
+                start, second = pos, False
+            else:
+                while pos < len(body) and body[pos] in "0123456789,-":
+                    pos += 1
+    return "".join(out)
+
+
+# ----------------------------------------------------------------------------
+# Standard MIDI file, the highest sounding note of all tracks is taken
+# ----------------------------------------------------------------------------
+def parse_midi(data):
+    def varlen(buf, i):
+        value = 0
+        while True:
+            b = buf[i]
+            i += 1
+            value = (value << 7) | (b & 0x7F)
+            if not b & 0x80:
+                return value, i
+
+    if data[:4] != b"MThd":
+        raise ValueError("not a standard MIDI file")
+    hlen, fmt, ntracks, division = struct.unpack(">IHHH", data[4:14])
+    if division & 0x8000:
+        raise ValueError("SMPTE time division is not supported")
+    pos, events, tempo = 8 + hlen, [], 0
+    for _ in range(ntracks):
+        if data[pos:pos + 4] != b"MTrk":
+            break
+        tlen = struct.unpack(">I", data[pos + 4:pos + 8])[0]
+        i, end, tick, status = pos + 8, pos + 8 + tlen, 0, 0
+        while i < end:
+            delta, i = varlen(data, i)
+            tick += delta
+            if data[i] & 0x80:
+                status = data[i]
+                i += 1
+            if status == 0xFF:
+                meta = data[i]
+                mlen, i = varlen(data, i + 1)
+                if meta == 0x51 and not tempo:
+                    tempo = round(60000000 / int.from_bytes(data[i:i + 3], "big"))
+                i += mlen
+            elif status in (0xF0, 0xF7):
+                slen, i = varlen(data, i)
+                i += slen
+            else:
+                kind = status & 0xF0
+                size = 1 if kind in (0xC0, 0xD0) else 2
+                if kind in (0x80, 0x90):
+                    key, vel = data[i], data[i + 1]
+                    events.append((tick, key, kind == 0x90 and vel > 0))
+                i += size
+        pos = end
+    events.sort(key=lambda e: (e[0], e[2]))
+
+    # reduce to a single voice and quantize to 64ths
+    notes, sounding, last_tick, last_key = [], set(), 0, None
+
+    def flush(upto):
+        nonlocal last_tick
+        len64 = round(upto * 16 / division) - round(last_tick * 16 / division)
+        if len64 > 0:
+            notes.append((REST, 4, len64) if last_key is None else (last_key % 12, last_key // 12 - 1, len64))
+        last_tick = upto
+
+    for tick, key, on in events:
+        if on:
+            sounding.add(key)
+        else:
+            sounding.discard(key)
+        top = max(sounding) if sounding else None
+        if top != last_key or (on and key == top):
+            flush(tick)
+            last_key = top
+    return None, tempo or 120, notes
+
+
+# ----------------------------------------------------------------------------
+# Packing and code generation
+# ----------------------------------------------------------------------------
+def pack(notes):
+    """A packed note: bits 15..8 length in 64ths, bits 7..4 octave, bits 3..0 note (REST = 12)"""
+    packed = []
+    for pitch, octave, length in notes:
+        while length > 0:
+            part = min(length, MAX_LEN)
+            packed.append((part << 8) | (max(0, min(8, octave)) << 4) | pitch)
+            length -= part
+    return packed
+
+
+# ----------------------------------------------------------------------------
+# Phrase dictionary
+# ----------------------------------------------------------------------------
+def is_reference(word):
+    return word >= 0 and word & 0x0F == PHRASE_REF
+
+
+class Corpus:
+    """
+    All melodies as one array of words, each melody followed by a separator
+    (a negative word which never matches). A phrase is replaced in place: its
+    first word becomes the reference, the others are unlinked from the chain
+    of next words, so the positions of the other words stay valid.
+    """
+    def __init__(self, sequences):
+        self.words, self.starts = [], []
+        for s, seq in enumerate(sequences):
+            self.starts.append(len(self.words))
+            self.words += list(seq) + [-1 - s]
+        self.next = list(range(1, len(self.words) + 1))
+        self.prev = list(range(-1, len(self.words) - 1))
+        self.alive = [True] * len(self.words)
+        self.index = {}
+        for p, w in enumerate(self.words):
+            self.index.setdefault(w, []).append(p)
+
+    def window(self, p, n):
+        """The n words from position p on, None when a melody ends before"""
+        out = []
+        while len(out) < n:
+            if self.words[p] < 0:
+                return None
+            out.append(self.words[p])
+            p = self.next[p]
+        return tuple(out)
+
+    def occurrences(self, key, positions):
+        """The positions where key still starts, overlapping ones from left to right once"""
+        found, end = [], -1
+        for p in sorted(set(positions)):
+            if p <= end or not self.alive[p] or self.words[p] != key[0]:
+                continue
+            q, ok = p, True
+            for w in key[1:]:
+                q = self.next[q]
+                if self.words[q] != w:
+                    ok = False
+                    break
+            if ok:
+                found.append(p)
+                end = q
+        return found
+
+    def replace(self, positions, n, ref):
+        for p in positions:
+            q = p
+            for _ in range(n - 1):
+                q = self.next[q]
+                self.alive[q] = False
+            self.next[p] = self.next[q]
+            self.prev[self.next[q]] = p
+            self.words[p] = ref
+            self.index.setdefault(ref, []).append(p)
+
+    def sequences(self):
+        out = []
+        for p in self.starts:
+            seq = []
+            while self.words[p] >= 0:
+                seq.append(self.words[p])
+                p = self.next[p]
+            out.append(seq)
+        return out
+
+    def repeats(self, groups):
+        """
+        Extend groups of (start, end) positions of equal phrases word by word
+        (a walk down the suffix tree), yields (length, starts) of each phrase of
+        MIN_PHRASE..MAX_PHRASE words which occurs more than once
+        """
+        stack = [g for g in groups if len(g[1]) > 1]
+        while stack:
+            length, members = stack.pop()
+            if length >= MIN_PHRASE:
+                yield length, [s for s, _ in members]
+            if length >= MAX_PHRASE:
+                continue
+            buckets = {}
+            for s, e in members:
+                q = self.next[e]
+                if self.words[q] >= 0:
+                    buckets.setdefault(self.words[q], []).append((s, q))
+            stack += [(length + 1, m) for m in buckets.values() if len(m) > 1]
+
+    def repeats_around(self, positions):
+        """The repeated phrases which contain one of the words at positions"""
+        for back in range(MAX_PHRASE):
+            groups = {}
+            for p in positions:
+                s = p
+                for _ in range(back):
+                    s = self.prev[s]
+                    if s < 0 or self.words[s] < 0:
+                        break
+                else:
+                    groups.setdefault(self.window(s, back + 1), []).append((s, p))
+            groups = [(back + 1, m) for m in groups.values() if len(m) > 1]
+            if not groups:
+                break  # no longer context repeats either
+            yield from self.repeats(groups)
+
+
+def phrase_depth(phrases, phrase):
+    return 1 + max([phrase_depth(phrases, phrases[w >> 4]) for w in phrase if is_reference(w)] + [0])
+
+
+def phrase_saving(count, length):
+    return count * length - count - length - PHRASE_COST
+
+
+def deduplicate(sequences, dictionary=None):
+    """
+    Move repeated phrases of the packed melodies into a dictionary, greedily the
+    phrase which saves most words first. A phrase may contain references to
+    phrases found before it, at most PHRASE_DEPTH levels deep.
+
+    dictionary is the result of the last build ({"slots": phrases or None,
+    "order": slots in the order they were found}). Its phrases are applied
+    first and keep their index as long as they still save flash, the others
+    leave their slot free for a new phrase. So a changed melody does not
+    renumber the phrases of the others.
+
+    The savings of the candidates only decrease when a phrase is replaced,
+    except for the phrases containing the new reference, which are added
+    then. So the candidates are found once and kept in a heap, a candidate
+    whose saving has dropped is put back with its new saving.
+    Returns the melodies with references, the phrases (None for free slots),
+    their expanded lengths and the dictionary for the next build
+    """
+    corpus = Corpus(sequences)
+    old = dictionary or {"slots": [], "order": []}
+    slots, order, inline = [None] * len(old["slots"]), [], {}
+
+    def resolve(phrase):
+        out = []
+        for w in phrase:
+            out += resolve(inline[w >> 4]) if is_reference(w) and (w >> 4) in inline else [w]
+        return out
+
+    def take(slot, key, positions):
+        ref = (slot << 4) | PHRASE_REF
+        corpus.replace(positions, len(key), ref)
+        slots[slot] = list(key)
+        order.append(slot)
+        return ref
+
+    # the phrases of the last build, in the order they were found
+    for slot in old["order"]:
+        key = tuple(resolve(old["slots"][slot]))
+        found = corpus.occurrences(key, corpus.index.get(key[0], [])) if key else []
+        if phrase_saving(len(found), len(key)) > 0 and phrase_depth(slots, key) <= PHRASE_DEPTH:
+            take(slot, key, found)
+        else:
+            inline[slot] = list(key)
+    free = [i for i, p in enumerate(slots) if p is None]
+    heapq.heapify(free)
+
+    candidates, heap = {}, []
+
+    def offer(found):
+        for length, starts in found:
+            key = corpus.window(starts[0], length)
+            candidates.setdefault(key, set()).update(starts)
+            saving = phrase_saving(len(corpus.occurrences(key, candidates[key])), length)
+            if saving > 0:
+                heapq.heappush(heap, (-saving, length, key))
+
+    first = {}
+    for p, w in enumerate(corpus.words):
+        if w >= 0 and corpus.alive[p]:
+            first.setdefault(w, []).append((p, p))
+    offer(corpus.repeats((1, m) for m in first.values()))
+
+    while heap and len(order) < MAX_PHRASES:
+        saving, length, key = heapq.heappop(heap)
+        found = corpus.occurrences(key, candidates[key])
+        now = phrase_saving(len(found), length)
+        if now != -saving:
+            if now > 0:
+                heapq.heappush(heap, (-now, length, key))
+            continue
+        if phrase_depth(slots, key) > PHRASE_DEPTH:
+            continue
+        if free:
+            slot = heapq.heappop(free)
+        else:
+            slot = len(slots)
+            slots.append(None)
+        take(slot, key, found)
+        offer(corpus.repeats_around(found))
+
+    while slots and slots[-1] is None:
+        slots.pop()
+    expanded = {}
+
+    def expand(slot):
+        if slot not in expanded:
+            expanded[slot] = sum(expand(w >> 4) if is_reference(w) else 1 for w in slots[slot])
+        return expanded[slot]
+
+    return (corpus.sequences(), slots, [expand(i) if p is not None else 0 for i, p in enumerate(slots)],
+            {"slots": slots, "order": order})
+
+
+def identifier(name):
+    ident = re.sub(r"\W", "_", name)
+    return "mel_" + ident
+
+
+def compile_source(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext == ".mid":
+        with open(path, "rb") as f:
+            title, tempo, notes = parse_midi(f.read())
+    else:
+        with open(path, encoding="utf-8") as f:
+            text = f.read()
+        title, tempo, notes = parse_rtttl(text) if ext == ".rtttl" else parse_abc(text)
+    return title, tempo or 114, notes
+
+
+def write_if_changed(path, content):
+    binary = isinstance(content, bytes)
+    if os.path.exists(path):
+        with open(path, "rb" if binary else "r", **({} if binary else {"encoding": "utf-8"})) as f:
+            if f.read() == content:
+                return False
+    with open(path, "wb" if binary else "w", **({} if binary else {"encoding": "utf-8"})) as f:
+        f.write(content)
+    return True
+
+
+def table(packed):
+    rows = []
+    for i in range(0, len(packed), 8):
+        rows.append("  " + ", ".join("0x%04X" % p for p in packed[i:i + 8]) + ",")
+    return "\n".join(rows)
+
+
+def generate_melody(src, ident, title, tempo, packed, refs):
+    return ("// Generated by scripts/compile_melodies.py from %s, do not edit\n"
+            "// %s, %d packed words (%d phrase references), tempo %d\n"
+            "#include \"phrases.h\"\n\n"
+            "extern constexpr uint16_t %s[] =\n{\n%s\n};\n"
+            "extern constexpr MelodyInfo %s_info = packedInfo(%s, 0, %d, phraseTable, phraseCount);\n"
+            ) % (src, title, len(packed), refs, tempo, ident, table(packed), ident, ident, len(packed))
+
+
+def dictionary_rows(phrases, expanded):
+    """Entries of the phrase dictionary, a free slot stays as an empty phrase"""
+    return "".join("  { phrase_%d, %d, %d },\n" % (i, len(p), expanded[i]) if p is not None else "  { nullptr, 0, 0 },\n"
+                   for i, p in enumerate(phrases))
+
+
+def generate_phrases(phrases, expanded):
+    """Phrase dictionary as constexpr arrays, only songbook.cpp places them in flash"""
+    bodies = "".join("static constexpr uint16_t phrase_%d[] =\n{\n%s\n};\n" % (i, table(p))
+                     for i, p in enumerate(phrases) if p is not None)
+    rows = dictionary_rows(phrases, expanded)
+    return ("// Generated by scripts/compile_melodies.py, do not edit\n"
+            "#ifndef _SONGBOOK_PHRASES_H_\n#define _SONGBOOK_PHRASES_H_\n"
+            "#include \"Songbook.h\"\n\n%s\n"
+            "static constexpr SongbookPhrase phraseTable[] =\n{\n%s  { nullptr, 0, 0 }\n};\n"
+            "constexpr int phraseCount = %d;\n#endif\n") % (bodies, rows, len(phrases))
+
+
+def generate_file(tempo, packed):
+    """Melody file of StreamedMelody: "MPKM", tempo, number of notes, packed notes, little endian"""
+    return b"MPKM" + struct.pack("<HH", tempo, len(packed)) + struct.pack("<%dH" % len(packed), *packed)
+
+
+def generate_registry(entries, phrases, expanded):
+    decls = "".join("extern const uint16_t %s[];\nextern const MelodyInfo %s_info;\n" % (e["ident"], e["ident"])
+                    for e in entries)
+    rows = "".join("  { \"%s\", %s, %d, %d, &%s_info },\n" % (e["title"].replace('"', '\\"'), e["ident"], e["length"],
+                                                             e["tempo"], e["ident"]) for e in entries)
+    dictionary = dictionary_rows(phrases, expanded)
+    return ("// Generated by scripts/compile_melodies.py, do not edit\n"
+            "#include \"phrases.h\"\n\n%s\n"
+            "const SongbookPhrase songbookPhrases[] =\n{\n%s  { nullptr, 0, 0 }\n};\n"
+            "const int songbookPhraseCount = %d;\n\n"
+            "const SongbookEntry songbook[] =\n{\n%s  { nullptr, nullptr, 0, 0, nullptr }\n};\n"
+            "const int songbookSize = %d;\n") % (decls, dictionary, len(phrases), rows, len(entries))
+
+
+def main(project_dir):
+    src_dir = os.path.join(project_dir, SOURCE_DIR)
+    out_dir = os.path.join(project_dir, OUTPUT_DIR)
+    data_dir = os.path.join(project_dir, DATA_DIR)
+    os.makedirs(out_dir, exist_ok=True)
+    os.makedirs(data_dir, exist_ok=True)
+    cache_path = os.path.join(out_dir, CACHE_FILE)
+    try:
+        with open(cache_path, encoding="utf-8") as f:
+            cache = json.load(f)
+        if cache.get("version") != VERSION:
+            cache = {}
+    except (OSError, ValueError):
+        cache = {}
+    melodies = cache.get("melodies", {})
+
+    sources = sorted(f for f in os.listdir(src_dir) if f.lower().endswith(EXTENSIONS)) if os.path.isdir(src_dir) else []
+    entries, compiled = [], 0
+    for name in sources:
+        path = os.path.join(src_dir, name)
+        with open(path, "rb") as f:
+            digest = hashlib.sha1(f.read()).hexdigest()
+        ident = identifier(os.path.splitext(name)[0])
+        target = os.path.join(out_dir, ident + ".cpp")
+        data = os.path.join(data_dir, os.path.splitext(name)[0] + ".mel")
+        entry = melodies.get(name)
+        if entry is None or entry["sha1"] != digest or not os.path.exists(target) or not os.path.exists(data):
+            try:
+                title, tempo, notes = compile_source(path)
+            except (ValueError, IndexError, KeyError) as e:
+                print("compile_melodies: %s: %s" % (name, e))
+                continue
+            packed = pack(notes)
+            entry = {
+                "sha1": digest, "ident": ident, "title": title or os.path.splitext(name)[0], "src": name,
+                "tempo": tempo, "notes": len(packed), "len64": sum(n[2] for n in notes), "packed": packed,
+            }
+            write_if_changed(data, generate_file(tempo, packed))
+            compiled += 1
+        melodies[name] = entry
+        entries.append(entry)
+
+    # the phrases are shared by all melodies. The dictionary of the last build is
+    # reused when no melody has changed, else it is the start of the new one, so
+    # only the melodies whose phrases change are written again
+    corpus = hashlib.sha1(json.dumps([[e["src"], e["sha1"]] for e in entries]).encode()).hexdigest()
+    last = cache.get("dictionary", {})
+    if last.get("corpus") == corpus:
+        sequences, phrases, expanded = last["sequences"], last["slots"], last["expanded"]
+        dictionary = last
+    else:
+        sequences, phrases, expanded, dictionary = deduplicate([e["packed"] for e in entries], last or None)
+        dictionary.update({"corpus": corpus, "sequences": sequences, "expanded": expanded})
+    write_if_changed(os.path.join(out_dir, "phrases.h"), generate_phrases(phrases, expanded))
+    for e, seq in zip(entries, sequences):
+        e["length"] = len(seq)
+        refs = sum(1 for w in seq if is_reference(w))
+        write_if_changed(os.path.join(out_dir, e["ident"] + ".cpp"),
+                         generate_melody(SOURCE_DIR + "/" + e["src"], e["ident"], e["title"], e["tempo"], seq, refs))
+
+    # remove melodies whose source was deleted
+    for name in [n for n in melodies if n not in sources]:
+        stale = [os.path.join(out_dir, melodies.pop(name)["ident"] + ".cpp"),
+                 os.path.join(data_dir, os.path.splitext(name)[0] + ".mel")]
+        for path in stale:
+            if os.path.exists(path):
+                os.remove(path)
+
+    write_if_changed(os.path.join(out_dir, "songbook.cpp"), generate_registry(entries, phrases, expanded))
+    write_if_changed(cache_path, json.dumps({"version": VERSION, "melodies": melodies, "dictionary": dictionary},
+                                            indent=1, sort_keys=True))
+
+    print("Songbook: %d melodies, %d compiled" % (len(entries), compiled))
+    print("  %-24s %6s %6s %6s %9s" % ("melody", "notes", "words", "bytes", "duration"))
+    plain, total = 0, 0
+    for e in entries:
+        ms = e["len64"] * 60000 // (16 * e["tempo"]) + e["notes"] * (NOTE_GAP + 1)  # as melodyMs()
+        plain += 2 * e["notes"]
+        total += 2 * e["length"]
+        print("  %-24s %6d %6d %6d %6d.%01d s" % (e["title"][:24], e["notes"], e["length"], 2 * e["length"],
+                                                 ms // 1000, ms % 1000 // 100))
+    words = sum(len(p) for p in phrases if p is not None)
+    size = 2 * words + 2 * PHRASE_COST * len(phrases)
+    print("  %-24s %6s %6d %6d" % ("phrase dictionary", "", words, size))
+    print("  %-24s %6s %6s %6d" % ("total", "", "", total + size))
+    print("Phrases: %d shared phrases, %d bytes instead of %d, %d bytes of flash saved"
+          % (sum(1 for p in phrases if p is not None), total + size, plain, plain - total - size))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+else:
+    Import("env")  # noqa: F821  (provided by PlatformIO)
+    main(env.subst("$PROJECT_DIR"))  # noqa: F821
@@ -0,0 +1,119 @@
+"""
+Script       trace_to_chrome.py
+
+Purpose      Converts a trace of the melody player (see lib/MelodyPlayer/PlayerTrace.h)
+             into Chrome trace JSON, to be opened with chrome://tracing or
+             https://ui.perfetto.dev. The input is either a binary file written by
+             PlayerTrace::save() or a log of the serial monitor containing the
+             "TRACE ..." lines printed by PlayerTrace::dump() (menu entry [T]).
+
+             Threads of the timeline:
+               notes   a slice per note from note on to note off, late note offs
+                       are marked with an instant event
+               loop    stalls of the loop (an iteration longer than TRACE_STALL_US)
+               cli     the handling of each menu command
+             The loop iterations per TRACE_LOOP_US are shown as a counter.
+
+Usage        python scripts/trace_to_chrome.py trace.bin|monitor.log [trace.json]
+"""
+import json
+import re
+import struct
+import sys
+
+HEADER  = struct.Struct("<4sHHII")
+RECORD  = struct.Struct("<IBBh")
+VERSION = 1
+
+NOTE_ON, NOTE_OFF, LOOP_STALL, LOOP_COUNT, CMD_BEGIN, CMD_END, MARK = range(1, 8)
+NAMES = ["C", "C#", "D", "Eb", "E", "F", "F#", "G", "G#", "A", "Bb", "B", "rest"]
+TID   = {"notes": 1, "loop": 2, "cli": 3}
+
+
+def read_trace(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(b"MPTR"):
+        dump = None
+        for line in re.findall(r"TRACE ([0-9a-fA-F]+)", data.decode("ascii", "replace")):
+            if line.lower().startswith("4d505452"):
+                dump = []  # a new dump starts, the last one in the log is used
+            if dump is not None:
+                dump.append(line)
+        if not dump:
+            raise ValueError("no trace found in %s" % path)
+        data = bytes.fromhex("".join(dump))
+    magic, version, size, count, overwritten = HEADER.unpack_from(data)
+    if version != VERSION or size != RECORD.size:
+        raise ValueError("trace version %d with records of %d bytes is not supported" % (version, size))
+    count = min(count, (len(data) - HEADER.size) // RECORD.size)
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(count)]
+    return records, overwritten
+
+
+def unwrap(records):
+    """Time stamps are 32 bit us, continue counting after an overflow"""
+    offset, last = 0, None
+    for us, kind, arg, value in records:
+        if last is not None and us < last and last - us > 0x80000000:
+            offset += 1 << 32
+        last = us
+        yield us + offset, kind, arg, value
+
+
+def note_name(arg):
+    note, octave = arg & 0x0F, arg >> 4
+    return NAMES[note] if note >= 12 else "%s%d" % (NAMES[note], octave)
+
+
+def convert(records):
+    events = [{"name": "thread_name", "ph": "M", "pid": 1, "tid": tid, "args": {"name": name}}
+              for name, tid in TID.items()]
+    note_on = None
+    cmd_start = {}
+    for us, kind, arg, value in unwrap(records):
+        if kind == NOTE_ON:
+            note_on = (us, arg, value)
+        elif kind == NOTE_OFF:
+            if note_on is not None:
+                start, on_arg, duration = note_on
+                events.append({"name": note_name(on_arg), "ph": "X", "pid": 1, "tid": TID["notes"],
+                               "ts": start, "dur": us - start,
+                               "args": {"duration_ms": duration, "late_ms": value}})
+                note_on = None
+            if value > 1:
+                events.append({"name": "late %d ms" % value, "ph": "i", "s": "t", "pid": 1,
+                               "tid": TID["notes"], "ts": us})
+        elif kind == LOOP_STALL:
+            events.append({"name": "stall", "ph": "X", "pid": 1, "tid": TID["loop"],
+                           "ts": us - 1000 * value, "dur": 1000 * value, "args": {"ms": value}})
+        elif kind == LOOP_COUNT:
+            events.append({"name": "loop iterations", "ph": "C", "pid": 1, "ts": us,
+                           "args": {"iterations": value}})
+        elif kind == CMD_BEGIN:
+            cmd_start[arg] = us
+        elif kind == CMD_END and arg in cmd_start:
+            start = cmd_start.pop(arg)
+            events.append({"name": "[%s]" % chr(arg), "ph": "X", "pid": 1, "tid": TID["cli"],
+                           "ts": start, "dur": us - start})
+        elif kind == MARK:
+            events.append({"name": "mark %d" % arg, "ph": "i", "s": "p", "pid": 1, "ts": us,
+                           "args": {"value": value}})
+    return events
+
+
+def main(args):
+    if not args:
+        print(__doc__)
+        return 1
+    records, overwritten = read_trace(args[0])
+    target = args[1] if len(args) > 1 else re.sub(r"\.[^.\\/]*$", "", args[0]) + ".json"
+    events = convert(records)
+    with open(target, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, f)
+    print("%s: %d records (%d overwritten before), %d events" % (target, len(records), overwritten, len(events)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,532 @@
+/**
+ * Program      bench.cpp
+ *
+ * Purpose      Benchmarks and diagnostics of the MelodyPlayer library, built as a firmware
+ *              of its own, so the demo (melodyPlayer.cpp) stays a demo:
+ *              - cycles per tick of the control timer with 1..8 LFO voices
+ *              - throughput of the scheduler with a null output, with and without callbacks
+ *              - loads into the melody arena
+ *              - boot profile and resume of the melody after deep sleep or reset
+ *              - recording of a session for the replay on the host
+ *              - the scheduler trace for scripts/trace_to_chrome.py
+ *
+ *              Build and upload it with: pio run -e bench -t upload
+ *
+ * Board        ESP32 DoIt DevKit V1, wired as for the demo (speaker at GPIO25)
+ */
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "MelodyPlayer.h"
+#include "AbcParser.h"
+#include "Songbook.h"
+#include "Lfo.h"
+#include "ControlTimer.h"
+#include "NullOutput.h"
+#include "PlayerTrace.h"
+#include "SessionLog.h"
+#include "MelodyArena.h"
+#include "melodies.h"
+
+#define CLR_LINE "\r%*c\r", 128, ' '
+const int channel  = 0;
+const int PIN_SPKR = GPIO_NUM_25;
+const int PIN_PROBE = GPIO_NUM_4;  // goes high with the first note, for a scope
+
+typedef struct { const char key; const char *txt; void (&action)(char ch); } MenuItem;
+
+// Forward declaration of menu actions
+void playMelody(char ch);
+void playSongbook(char ch);
+void setTempo(char ch);
+void setNormal(char ch);
+void setRandom(char ch);
+void benchmarkLfo(char ch);
+void benchmarkScheduler(char ch);
+void benchmarkArena(char ch);
+void recordSession(char ch);
+void deepSleep(char ch);
+void dumpTrace(char ch);
+void showMenu(char ch);
+
+MenuItem menu[] = 
+{
+  { 'o', "[o] Play Old Mac Donald",                      playMelody },
+  { 's', "[s] Play next melody of the songbook",         playSongbook },
+  { 'b', "[b] Set Tempo [beats per minute]",             setTempo },
+  { 'n', "[n] Set normal mode",                          setNormal },
+  { 'r', "[r] Set random mode",                          setRandom },
+  { 'L', "[L] Benchmark LFO tick for 1..8 voices",       benchmarkLfo },
+  { 'K', "[K] Benchmark the scheduler (null output)",    benchmarkScheduler },
+  { 'y', "[y] Load and replace melodies in the arena",   benchmarkArena },
+  { 'X', "[X] Start / stop recording the session",       recordSession },
+  { 'Z', "[Z] Deep sleep 5 s, then resume the melody",   deepSleep },
+#ifdef PLAYER_TRACE
+  { 'T', "[T] Dump the trace for trace_to_chrome.py",    dumpTrace },
+#endif
+  { 'S', "[S] Show Menu",                                showMenu },
+};
+constexpr int nbrMenuItems = sizeof(menu) / sizeof(menu[0]);
+
+// Chom Bueb in ABC notation, played by the scheduler benchmark
+AbcParser abcParser(abcChomBueb);
+
+// Melodies loaded at runtime are kept in the arena, not on the heap
+MelodyArena arena;
+
+// Melodies compiled from the directory melodies/ at build time
+PackedMelody songbookMelody(songbook[0]);
+int songbookIndex = -1;
+
+// The position in the melody survives deep sleep and resets in RTC memory
+RTC_NOINIT_ATTR PlayerState rtcState;
+uint16_t melodyId = 0;  // key of the melody, 0x100 + index for the songbook, 0 = can't resume
+
+// Time of the steps of the startup in us since the start of the app
+#define BOOT_STEPS 8
+struct
+{
+  struct { const char *name; int64_t us; } step[BOOT_STEPS];
+  int      steps    = 0;
+  bool     saved    = false;  // a valid state was found in RTC memory
+  bool     resumed  = false;
+  uint32_t cycles   = 0;      // needed by restoreState()
+  uint16_t noteIndex;         // where the melody resumed
+  uint16_t msIntoNote;
+  bool     sounding = false;  // the first note has started
+  bool     reported = false;
+} boot;
+
+// The player can record its session (see SessionLog.h)
+typedef BasicMelodyPlayer<RecordingClock<ArduinoClock>, LedcOutput> RecordingPlayer;
+RecordingPlayer player(PIN_SPKR, channel);
+SessionLog      session;
+
+/**
+ * Set Old Mac Donald without printing, as needed before Serial.begin()
+ */
+void selectMelody()
+{
+  session.call(SESSION_CALL::MELODY, 'o');
+  melodyId = 'o';
+  player.setVolume(10);
+  player.setMelody(oldMacDonald, len_oldMacDonald);
+}
+
+/**
+ * Plays Old Mac Donald nonstop
+ */
+void playMelody(char ch)
+{
+  selectMelody();
+  Serial.printf("%s", "Playing 'Old Mac Donald' ");
+}
+
+/**
+ * Set the next melody of the songbook without printing, as needed before 
+ * Serial.begin(). Returns false when the songbook is empty
+ */
+bool selectSongbook()
+{
+  if (songbookSize == 0) return false;
+  songbookIndex = (songbookIndex + 1) % songbookSize;
+  songbookMelody.setEntry(songbook[songbookIndex]);
+  melodyId = 0x100 + songbookIndex;
+  player.setVolume(10);
+  player.setMelody(songbookMelody);
+  return true;
+}
+
+/**
+ * Play the melodies of the songbook one after the other
+ */
+void playSongbook(char ch)
+{
+  if (! selectSongbook()) Serial.printf("%s", "Songbook is empty ");
+  else Serial.printf("Playing '%s' from the songbook ", songbook[songbookIndex].name);
+}
+
+/**
+ * Set the tempo in beats per minute
+ */
+void setTempo(char ch)
+{
+  int32_t value = 0;
+
+  delay(2000);
+  while (Serial.available())
+  {
+    value = Serial.parseInt();
+  }
+  session.call(SESSION_CALL::TEMPO, value);
+  player.setTempo(value);
+  Serial.printf("Tempo set to %d beats per minute ", player.getTempo()); 
+}
+
+/**
+ * Set normal playing mode
+ */
+void setNormal(char ch)
+{
+  session.call(SESSION_CALL::RANDOM_MODE, 0);
+  player.setNormalMode();
+  Serial.printf("%s", "Normal mode set ");
+}
+
+/**
+ * Set random playing mode
+ */
+void setRandom(char ch)
+{
+  session.call(SESSION_CALL::RANDOM_MODE, 1);
+  player.setRandomMode();
+  Serial.printf("%s", "Random mode set ");
+}
+
+/**
+ * Measure the cpu cycles per tick of the control timer with 1..8 voices
+ * with vibrato and tremolo. The voices use the unconnected channels 8..15
+ */
+void benchmarkLfo(char ch)
+{
+  static Lfo voice[8] = { 8, 9, 10, 11, 12, 13, 14, 15 };
+
+  player.mute();
+  Serial.printf("\r\nvoices  cycles/tick  max  (%d Hz control rate)\r\n", ControlTimer::rate());
+  for (int n = 1; n <= 8; n++)
+  {
+    voice[n - 1].setVibrato(5.5f, 50);
+    voice[n - 1].setTremolo(4.0f, 50);
+    voice[n - 1].noteOn(440.0f, 256);
+    ControlTimer::resetStats();
+    delay(500);
+    Serial.printf("%6d  %11d  %4d\r\n", n, ControlTimer::cyclesPerTick(), ControlTimer::maxCyclesPerTick());
+  }
+  for (int n = 0; n < 8; n++) voice[n].end();
+}
+
+// Player without hardware and with a virtual clock to measure the scheduling alone
+typedef BasicMelodyPlayer<VirtualClock, NullOutput> BenchPlayer;
+
+/**
+ * Callback of the benchmark, counts the events
+ */
+void countEvent(const PlayerEvent &event, void *arg)
+{
+  (*(uint32_t *)arg)++;
+}
+
+/**
+ * Poll the melody set in bench once per virtual ms during msPlay ms
+ * and add the calls and cpu cycles to the totals. With deferred events
+ * the queue is emptied after each poll like a display task would do
+ */
+void runBench(BenchPlayer &bench, uint32_t msPlay, uint32_t &calls, uint64_t &cycles, bool deferred)
+{
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t ms = 0; ms < msPlay; ms++)
+  {
+    bench.playMelody(true);
+    if (deferred) bench.dispatchEvents();
+    bench.clock().advance(1);
+  }
+  cycles += ESP.getCycleCount() - start;
+  calls  += msPlay;
+}
+
+/**
+ * Play all melodies of the demo in normal and random mode, the songbook 
+ * and the ABC tune during 30 s of virtual time each
+ */
+void benchMelodies(BenchPlayer &bench, uint32_t &calls, uint64_t &cycles, bool deferred)
+{
+  struct { musicNote *notes; int len; } melody[] = 
+  {
+    { amLouenesee, len_amLouenesee }, { chomBueb, len_chomBueb }, { entertainer, len_entertainer },
+    { oldMacDonald, len_oldMacDonald }, { martinshorn, len_martinshorn }, { postauto, len_postauto },
+    { chromaticScale, len_chromatic }, { pentatonicScale, len_pentatonic }
+  };
+  const uint32_t msPlay = 30000;
+
+  bench.setDeferredEvents(deferred);
+  for (auto &m : melody)
+  {
+    bench.setNormalMode();
+    bench.setMelody(m.notes, m.len);
+    runBench(bench, msPlay, calls, cycles, deferred);
+    bench.setRandomMode();
+    runBench(bench, msPlay, calls, cycles, deferred);
+  }
+  bench.setNormalMode();
+  for (int i = 0; songbook[i].name != nullptr; i++)
+  {
+    PackedMelody packed(songbook[i]);
+    bench.setMelody(packed);
+    runBench(bench, msPlay, calls, cycles, deferred);
+  }
+  bench.setMelody(abcParser);
+  runBench(bench, msPlay, calls, cycles, deferred);
+}
+
+/**
+ * Measure the throughput of the player without output, then the cycles of a poll 
+ * while a note is sounding and the cost of PLAYER_CALLBACKS callbacks, called 
+ * directly or deferred through the event queue
+ */
+void benchmarkScheduler(char ch)
+{
+  static BenchPlayer bench;
+  static uint32_t eventCount;
+  uint32_t calls  = 0;
+  uint64_t cycles = 0;
+
+  bench.output().clear();
+  bench.setLegato(10);
+  benchMelodies(bench, calls, cycles, false);
+
+  // idle polls: the clock stands still while a long note is sounding
+  bench.setMelody(pentatonicScale, len_pentatonic);
+  bench.setTempo(TEMPO::LARGO);
+  bench.playMelody(true);
+  const uint32_t idlePolls = 10000;
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < idlePolls; i++) bench.playMelody(true);
+  uint32_t idleCycles = (ESP.getCycleCount() - start) / idlePolls;
+  bench.setTempo(TEMPO::MODERATO);
+
+  float seconds = (float)cycles / (ESP.getCpuFreqMHz() * 1000000.0f);
+  Serial.printf("\r\nScheduler benchmark, null output, %u polls in %.3f s\r\n", calls, seconds);
+  Serial.printf("calls/s  %10.0f\r\n", calls / seconds);
+  Serial.printf("events/s %10.0f (%u note on, %u note off)\r\n", bench.output().events() / seconds, 
+                bench.output().noteOns(), bench.output().noteOffs());
+  Serial.printf("cycles per call %u, per idle poll %u\r\n", (uint32_t)(cycles / calls), idleCycles);
+
+  for (int i = 0; i < PLAYER_CALLBACKS; i++) bench.addCallback(countEvent, &eventCount);
+  for (int deferred = 0; deferred < 2; deferred++)
+  {
+    uint32_t callsCb  = 0;
+    uint64_t cyclesCb = 0;
+    eventCount = 0;
+    benchMelodies(bench, callsCb, cyclesCb, deferred);
+    Serial.printf("%d callbacks %-8s: cycles per call %u, %u callback calls, %u lost\r\n", PLAYER_CALLBACKS,
+                  deferred ? "deferred" : "direct", (uint32_t)(cyclesCb / callsCb), eventCount, bench.lostEvents());
+  }
+  for (int i = 0; i < PLAYER_CALLBACKS; i++) bench.removeCallback(countEvent, &eventCount);
+  bench.setDeferredEvents(false);
+}
+
+/**
+ * Load melodies of random length into the arena and replace them, 10000 times,
+ * then show the time per load and the statistics of the arena
+ */
+void benchmarkArena(char ch)
+{
+  const int loads = 10000;
+  MelodyHandle melody[4];
+  uint32_t failed = arena.stats().failed;
+
+  arena.resetHighWater();
+  uint32_t start = micros();
+  for (int i = 0; i < loads; i++)
+  {
+    melody[i % 4] = arena.load(amLouenesee, 1 + esp_random() % len_amLouenesee);
+  }
+  uint32_t us = micros() - start;
+  ArenaStats stats = arena.stats();
+  Serial.printf("%d loads in %u us, %u ns per load, %u failed\r\n", loads, us, 
+                (uint32_t)((uint64_t)us * 1000 / loads), stats.failed - failed);
+  Serial.printf("blocks in use %u (high water %u) of %u, melodies %u (high water %u) of %u, %u%% unused in the last blocks\r\n",
+                stats.blocks, stats.blocksHigh, ARENA_BLOCKS, stats.melodies, stats.melodiesHigh, ARENA_MELODIES, 
+                arena.wastePercent());
+}
+
+/**
+ * Start recording the session, stop it and print the log as hex lines.
+ * See README to replay it on the host
+ */
+void recordSession(char ch)
+{
+  if (player.clock().log() == nullptr)
+  {
+    player.clock().record(&session, esp_random());
+    Serial.printf("%s", "Recording the session, the loop polls once per ms ");
+    return;
+  }
+  player.clock().record(nullptr);
+  session.dump(Serial);
+  Serial.printf("Session of %u bytes recorded%s ", session.size(), session.full() ? ", the log is full" : "");
+}
+
+/**
+ * Save the position in the melody and go to deep sleep for 5 s.
+ * After wake up setup() resumes the melody
+ */
+void deepSleep(char ch)
+{
+  if (melodyId != 0) player.saveState(rtcState, melodyId);
+  player.mute();
+  Serial.printf("%s", "Deep sleep for 5 s ");
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup(5000000ULL);
+  esp_deep_sleep_start();
+}
+
+/**
+ * Continue the melody saved in RTC memory, if the state is valid.
+ * Called before Serial.begin(), so it prints nothing, bootReport() does.
+ * A resumed sounding note starts at once, the others with playMelody()
+ */
+bool resumeMelody()
+{
+  if (! stateValid(rtcState)) return false;
+  boot.saved      = true;
+  boot.noteIndex  = rtcState.noteIndex;
+  boot.msIntoNote = rtcState.msIntoNote;
+  uint16_t id = rtcState.melodyId;
+  if (id >= 0x100 && id - 0x100 < songbookSize)
+  {
+    songbookIndex = id - 0x100 - 1;  // selectSongbook() takes the next one
+    selectSongbook();
+  }
+  else if (id == 'o') selectMelody();
+  else return false;  // the melody is not known (anymore)
+
+  uint32_t start = ESP.getCycleCount();
+  boot.resumed = player.restoreState(rtcState);
+  boot.cycles  = ESP.getCycleCount() - start;
+  return true;
+}
+
+/**
+ * Remember the time since the start of the app of a step of the startup
+ */
+void bootMark(const char *step)
+{
+  if (boot.steps < BOOT_STEPS) boot.step[boot.steps++] = { step, esp_timer_get_time() };
+}
+
+/**
+ * Callback of the NOTE_ON events, marks the first note when the output has 
+ * started it and raises the probe pin
+ */
+void markFirstNote(const PlayerEvent &event, void *arg)
+{
+  if (boot.sounding) return;
+  bootMark("first note");
+  digitalWrite(PIN_PROBE, HIGH);
+  boot.sounding = true;
+}
+
+/**
+ * Print the boot profile, the time of each step since the start of the app.
+ * ROM and bootloader run before, the time from reset to the first note is 
+ * measured from EN to the rising edge of PIN_PROBE
+ */
+void bootReport()
+{
+  Serial.printf("Boot profile (us since the start of the app, reset to first note: EN to GPIO%d)\r\n", PIN_PROBE);
+  for (int i = 0; i < boot.steps; i++)
+  {
+    Serial.printf("%-16s %8lld %+8lld\r\n", boot.step[i].name, boot.step[i].us, 
+                  boot.step[i].us - ((i > 0) ? boot.step[i - 1].us : 0));
+  }
+  if (! boot.saved) Serial.printf("%s", "No melody to resume, Old MacDonald from the start\r\n");
+  else if (boot.resumed) Serial.printf("Resumed melody at note %u + %u ms in %u cycles (%u us)\r\n", boot.noteIndex, 
+                                       boot.msIntoNote, boot.cycles, boot.cycles / ESP.getCpuFreqMHz());
+  else Serial.printf("%s", "Resumed melody from the start, it can't seek\r\n");
+}
+
+#ifdef PLAYER_TRACE
+/**
+ * Print the trace as hex lines and start a new one
+ */
+void dumpTrace(char ch)
+{
+  PlayerTrace::dump(Serial);
+  Serial.printf("%u records, %u overwritten ", PlayerTrace::size(), PlayerTrace::overwritten());
+  PlayerTrace::clear();
+}
+#endif
+
+/**
+ * Show the menu
+ */
+void showMenu(char ch)
+{
+  // title is packed into a raw string
+  Serial.print(
+  R"TITLE(
+-------------------------
+ESP32 Melody Player Bench
+-------------------------
+)TITLE");
+
+  for (int i = 0; i < nbrMenuItems; i++)
+  {
+    Serial.println(menu[i].txt);
+  }
+  Serial.print("\nPress a key: ");
+}
+
+/**
+ * Selects the menu action 
+ * according to the pressed key
+ */
+void doMenu()
+{
+  char key = Serial.read();
+  Serial.printf(CLR_LINE);
+  TRACE_EVENT(TRACE::CMD_BEGIN, key, 0);
+  session.input(key);
+  for (int i = 0; i < nbrMenuItems; i++)
+  {
+    if (key == menu[i].key)
+    {
+      menu[i].action(key);
+      break;
+    }
+  } 
+  TRACE_EVENT(TRACE::CMD_END, key, 0);
+}
+
+void setup()
+{
+  bootMark("setup");
+  pinMode(PIN_PROBE, OUTPUT);
+  digitalWrite(PIN_PROBE, LOW);
+  player.begin();  // the ledc channel is set up here and not before setup()
+  bootMark("player.begin");
+  player.addCallback(markFirstNote, nullptr, EVENT_MASK(PLAYER_EVENT::NOTE_ON));
+  if (! resumeMelody()) selectMelody();  // a fresh boot plays Old MacDonald
+  player.playMelody(true);  // the first note comes before the serial port and the menu
+  Serial.begin(115200);
+  bootMark("Serial.begin");
+  showMenu('S');
+  bootMark("menu");
+}
+   
+void loop() 
+{
+  static uint32_t msLoop;
+  static uint32_t msSaved;
+
+  TRACE_LOOP();
+  if (session.recording())  // one poll per ms keeps the session log short
+  {
+    if (millis() == msLoop) return;
+    msLoop = millis();
+  }
+  if (boot.sounding && ! boot.reported)  // a first rest delays the first note
+  {
+    player.removeCallback(markFirstNote, nullptr);
+    bootReport();
+    boot.reported = true;
+  }
+  if (Serial.available()) doMenu();
+  if (melodyId != 0 && ! session.recording() && millis() - msSaved >= 50)
+  {
+    player.saveState(rtcState, melodyId);  // resume here after a reset
+    msSaved = millis();
+  }
+  player.playMelody(true);
+}
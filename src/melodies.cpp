@@ -0,0 +1,320 @@
+/**
+ * Module       melodies.cpp
+ *
+ * Purpose      The melodies of the demo as arrays of musicNotes and Chom Bueb in 
+ *              ABC notation, shared by the demo and the bench firmware
+ */
+#include "melodies.h"
+
+// A melody is defined as an array of musicNotes
+musicNote oldMacDonald[] =
+{
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_D, 4, N_LEN::N4 },
+  { NOTE_E, 4, N_LEN::N4 },
+  { NOTE_E, 4, N_LEN::N4 },
+  { NOTE_D, 4, N_LEN::N2 },
+  { NOTE_B, 4, N_LEN::N4 },
+  { NOTE_B, 4, N_LEN::N4 },
+  { NOTE_A, 4, N_LEN::N4 },
+  { NOTE_A, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N2d },
+
+  { NOTE_D, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_D, 4, N_LEN::N4 },
+  { NOTE_E, 4, N_LEN::N4 },
+  { NOTE_E, 4, N_LEN::N4 },
+  { NOTE_D, 4, N_LEN::N2 },
+  { NOTE_B, 4, N_LEN::N4 },
+  { NOTE_B, 4, N_LEN::N4 },
+  { NOTE_A, 4, N_LEN::N4 },
+  { NOTE_A, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N2d },
+
+  { NOTE_D, 4, N_LEN::N8 },
+  { NOTE_D, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { REST,   4, N_LEN::N4 },
+
+  { NOTE_G, 3, N_LEN::N4 },
+  { NOTE_G, 3, N_LEN::N4 },
+  { NOTE_G, 3, N_LEN::N4 },
+  { REST,   4, N_LEN::N4 },
+
+  { NOTE_G, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N4 },
+
+  { NOTE_G, 3, N_LEN::N8 },
+  { NOTE_G, 3, N_LEN::N8 },
+  { NOTE_G, 3, N_LEN::N4 },
+
+  { NOTE_G, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N8 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N4 },
+  { NOTE_D, 4, N_LEN::N4 },
+  { NOTE_E, 4, N_LEN::N4 },
+  { NOTE_E, 4, N_LEN::N4 },
+  { NOTE_D, 4, N_LEN::N2 },
+  { NOTE_B, 4, N_LEN::N4 },
+  { NOTE_B, 4, N_LEN::N4 },
+  { NOTE_A, 4, N_LEN::N4 },
+  { NOTE_A, 4, N_LEN::N4 },
+  { NOTE_G, 4, N_LEN::N1 },
+  { REST,   4, N_LEN::N2 },
+};
+const int len_oldMacDonald = sizeof(oldMacDonald) / sizeof(oldMacDonald[0]);
+
+musicNote chomBueb[] =
+{
+  { NOTE_E,  4, N_LEN::N2 },
+  { NOTE_E,  5, N_LEN::N2d },
+  { NOTE_Cs, 5, N_LEN::N4 },
+  { NOTE_A,  4, N_LEN::N4 },
+  { NOTE_Fs, 4, N_LEN::N4 },
+  { NOTE_E,  4, N_LEN::N4d },
+  { NOTE_Fs, 4, N_LEN::N8 },
+  { NOTE_E,  4, N_LEN::N2 },
+  { REST,    4, N_LEN::N1d},  // REST is defined as NOTE_MAX
+};
+const int len_chomBueb = sizeof(chomBueb) / sizeof(chomBueb[0]);
+
+musicNote amLouenesee[] =
+{
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N16 },
+  { NOTE_B ,  4, N_LEN::N8d },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8d },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N4 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N4d },
+  { REST,     4, N_LEN::N8 },
+  { REST,     4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N8d },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8d },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Cs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N4 },
+  { NOTE_E,   4, N_LEN::N8 },
+  { NOTE_Cs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N4d },
+  { REST,     4, N_LEN::N4 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N4 },
+  { NOTE_B,   4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8d },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_E ,  4, N_LEN::N4 },
+  { REST,     4, N_LEN::N4 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N4d },
+  { REST,     4, N_LEN::N8 },
+  { REST,     4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N4 },
+  { NOTE_Fs,  4, N_LEN::N16 },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8d },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Cs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N4 },
+  { NOTE_E,   4, N_LEN::N8 },
+  { NOTE_Cs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N4d },
+  { REST,     4, N_LEN::N4d },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_Cs,  5, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N4 },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_Cs,  5, N_LEN::N8d },
+  { NOTE_Cs,  5, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_Cs,  5, N_LEN::N4d },
+  { REST,     4, N_LEN::N8 },
+  { REST,     4, N_LEN::N8d },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Cs,  5, N_LEN::N8 },
+  { NOTE_Cs,  5, N_LEN::N8d },
+  { NOTE_Cs,  5, N_LEN::N16 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_E,   4, N_LEN::N4 },
+  { REST,     4, N_LEN::N8 },
+  { REST,     4, N_LEN::N8d },
+  { NOTE_E,   4, N_LEN::N16 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Fs,  4, N_LEN::N8 },
+  { NOTE_Gs,  4, N_LEN::N8 },
+  { NOTE_A,   4, N_LEN::N4d },
+  { REST,     4, N_LEN::N4d },
+  { REST,     4, N_LEN::N4d },
+  { REST,     4, N_LEN::N4d },
+  { REST,     4, N_LEN::N8 },
+  { REST,     4, N_LEN::N8 },
+  { NOTE_B,   3, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_B,   4, N_LEN::N8 },
+  { NOTE_A,   4, N_LEN::N16 },
+  { NOTE_Gs,  4, N_LEN::N4d },
+  { REST,     4, N_LEN::N4 },
+  { REST,     4, N_LEN::N4 },
+  { REST,     4, N_LEN::N16 },
+};
+const int len_amLouenesee = sizeof(amLouenesee) / sizeof(amLouenesee[0]);
+
+musicNote entertainer[] =
+{
+  { NOTE_D,  4, N_LEN::N8 },
+  { NOTE_Eb, 4, N_LEN::N8 },
+  { NOTE_E,  4, N_LEN::N8 },
+  { NOTE_C,  5, N_LEN::N4 },
+  { NOTE_E,  4, N_LEN::N8 },
+  { NOTE_C,  5, N_LEN::N4 },
+  { NOTE_E,  4, N_LEN::N8 },
+  { NOTE_C,  5, N_LEN::N8 },
+  { NOTE_C,  5, N_LEN::N2 },
+  { REST,    5, N_LEN::N8 },
+  { NOTE_C,  5, N_LEN::N8 },
+  { NOTE_D,  5, N_LEN::N8 },
+  { NOTE_Eb, 5, N_LEN::N8 },
+  { NOTE_E,  5, N_LEN::N8 },
+  { NOTE_C,  5, N_LEN::N8 },
+  { NOTE_D,  5, N_LEN::N8 },
+  { NOTE_E,  5, N_LEN::N4 },
+  { NOTE_B,  4, N_LEN::N8 },
+  { NOTE_D,  5, N_LEN::N4 },
+  { NOTE_C,  5, N_LEN::N2d},
+  { REST  ,  5, N_LEN::N1d},
+};
+const int len_entertainer = sizeof(entertainer) / sizeof(entertainer[0]);
+
+musicNote martinshorn[] =
+{
+  { NOTE_Cs, 4, N_LEN::N4 },
+  { NOTE_Gs, 4, N_LEN::N4 },
+};
+const int len_martinshorn = sizeof(martinshorn) / sizeof(martinshorn[0]);
+
+musicNote postauto[] =
+{
+  { NOTE_Cs, 5, N_LEN::N4 },
+  { NOTE_E,  4, N_LEN::N4 },
+  { NOTE_A,  4, N_LEN::N4d },
+  { REST,    4, N_LEN::N2d },
+};
+const int len_postauto = sizeof(postauto) / sizeof(postauto[0]);
+
+musicNote pentatonicScale[] =
+{
+  { NOTE_C,  4, N_LEN::N4 },
+  { NOTE_D,  4, N_LEN::N4 },
+  { NOTE_E,  4, N_LEN::N4 },
+  { NOTE_G,  4, N_LEN::N4 },
+  { NOTE_A,  4, N_LEN::N4 },
+  { NOTE_B,  4, N_LEN::N4 },
+};
+const int len_pentatonic = sizeof(pentatonicScale) / sizeof(pentatonicScale[0]);
+
+musicNote chromaticScale[] = 
+{
+  { NOTE_C,  4, N_LEN::N4 },
+  { NOTE_Cs, 4, N_LEN::N4 },
+  { NOTE_D , 4, N_LEN::N4 },
+  { NOTE_Eb, 4, N_LEN::N4 },
+  { NOTE_E , 4, N_LEN::N4 },
+  { NOTE_F , 4, N_LEN::N4 },
+  { NOTE_Fs, 4, N_LEN::N4 },
+  { NOTE_G , 4, N_LEN::N4 },
+  { NOTE_Gs, 4, N_LEN::N4 },
+  { NOTE_A,  4, N_LEN::N4 },
+  { NOTE_Bb, 4, N_LEN::N4 },
+  { NOTE_B , 4, N_LEN::N4 },
+  { NOTE_C,  5, N_LEN::N4 },
+};
+const int len_chromatic = sizeof(chromaticScale) / sizeof(chromaticScale[0]); 
+
+// The same melody as chomBueb, written in ABC notation and parsed while playing
+const char *abcChomBueb = R"ABC(X:1
+T:Chom Bueb
+M:3/4
+L:1/4
+K:A
+E2 e3 c A F E>F E2 z6 |]
+)ABC";
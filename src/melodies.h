@@ -0,0 +1,29 @@
+/**
+ * Header       melodies.h
+ *
+ * Purpose      Declaration of the melodies of the demo (melodies.cpp), used by the 
+ *              demo and by the bench firmware in src/bench
+ */
+#ifndef _MELODIES_H_
+#define _MELODIES_H_
+#include "MelodyTypes.h"
+
+extern musicNote oldMacDonald[];
+extern musicNote chomBueb[];
+extern musicNote amLouenesee[];
+extern musicNote entertainer[];
+extern musicNote martinshorn[];
+extern musicNote postauto[];
+extern musicNote pentatonicScale[];
+extern musicNote chromaticScale[];
+extern const int len_oldMacDonald;
+extern const int len_chomBueb;
+extern const int len_amLouenesee;
+extern const int len_entertainer;
+extern const int len_martinshorn;
+extern const int len_postauto;
+extern const int len_pentatonic;
+extern const int len_chromatic;
+
+extern const char *abcChomBueb;  // the same melody as chomBueb in ABC notation
+#endif
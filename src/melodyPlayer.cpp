@@ -5,8 +5,8 @@
  * Purpose      Demonstrates the usage of the class MelodyPlayer. A CLI menu is used to select 
  *              different melodies, set tempo or volume and to play the notes of a melody in 
  *              normal order or randomly. You may also choose to beat the beat in the set tempo.
- *              The volume at the speaker output can be changed in the range 0..511, which 
- *              corresponds to a duty cycle of 0..50%.   
+ *              The volume at the speaker output can be changed in the range 0..100, which 
+ *              follows a log taper, so equal steps sound equally loud.   
  * 
  * Board        ESP32 DoIt DevKit V1
  * 
@@ -30,21 +30,37 @@
  *                           '--------------'
  * 
  * Remarks      Instead of the speaker with driver you can also connect a piezo buzzer directly
- *              from GPIO25 to GND
+ *              from GPIO25 to GND. The melodies are in melodies.cpp, the benchmarks, the boot 
+ *              profile, the resume after deep sleep and the recording of a session in the 
+ *              bench firmware src/bench/bench.cpp (pio run -e bench -t upload)
  *
  * References   https://makeabilitylab.github.io/physcomp/esp32/tone.html#the-esp32-tone-problem
  *              
  */
 
 #include <Arduino.h>
+#include <LittleFS.h>
 #include "MelodyPlayer.h"
+#include "AbcParser.h"
+#include "MmlInterpreter.h"
+#include "Songbook.h"
+#include "TuningTable.h"
+#include "GlideEngine.h"
+#include "Lfo.h"
+#include "Sequence.h"
+#include "MelodyArena.h"
+#include "StreamedMelody.h"
+#include "ReloadableMelody.h"
+#include "melodies.h"
 
 //#define CLR_LINE "\r                                                                      \r"
 #define CLR_LINE "\r%*c\r", 128, ' '
 const int channel  = 0;
 const int PIN_SPKR = GPIO_NUM_25;
-int volume         = 1; // 0..511 for duty cycle 0..50%
+int volume         = 10; // perceived volume 0..100
 bool beatTheBeat   = false;
+bool siren         = false;
+bool playOnce      = false; // the melody is not repeated
 
 typedef struct { const char key; const char *txt; void (&action)(char ch); } MenuItem;
 
@@ -55,8 +71,22 @@ void setTempo(char ch);
 void setTempo1(char ch);
 void setLegato(char ch);
 void setVolume(char ch);
+void setTimbre(char ch);
+void setTuning(char ch);
+void setIntonation(char ch);
+void playSiren(char ch);
+void setPortamento(char ch);
+void setVibrato(char ch);
+void setTremolo(char ch);
 void setNormal(char ch);
 void setRandom(char ch);
+void playMml(char ch);
+void playSongbook(char ch);
+void playFile(char ch);
+void playTune(char ch);
+void writeTune(char ch);
+void playSequence(char ch);
+void playAndWait(char ch);
 void showMenu(char ch);
 
 MenuItem menu[] = 
@@ -69,323 +99,62 @@ MenuItem menu[] =
   { 'p', "[p] Play Postauto",                            playMelody },
   { 'C', "[C] Play Chromatic Scale",                     playMelody },
   { 'P', "[P] Play Pentatonic Scale",                    playMelody },
+  { 'A', "[A] Play Chum Bueb (ABC notation)",            playMelody },
+  { 'M', "[M] Play MML [e.g. T120 O4 L8 CDEFGAB>C]",     playMml },
+  { 's', "[s] Play next melody of the songbook",         playSongbook },
+  { 'F', "[F] Stream the next melody file from LittleFS", playFile },
+  { 'H', "[H] Play tune.abc, reload it when it changes",  playTune },
+  { 'E', "[E] Write tune.abc [ABC text pasted in 2 s]",   writeTune },
+  { 'W', "[W] Play Postauto, another task waits for it", playAndWait },
+#if defined(__cpp_impl_coroutine)
+  { 'q', "[q] Play a sequence (coroutine)",              playSequence },
+#endif
+  { 'g', "[g] Play Siren (glide 450..1300 Hz)",          playSiren },
   { 'B', "[B] Beat the beat",                            playBeats },
   { 't', "[t] Set Tempo [1..8]",                         setTempo },
   { 'b', "[b] Set Tempo [beats per minute]",             setTempo1 },
   { 'l', "[l] Set Legato (gap between notes)[0..100ms]", setLegato },
-  { 'v', "[v] Set Volume [0..511]",                      setVolume },
+  { 'G', "[G] Set Portamento [0..500ms]",                setPortamento },
+  { 'V', "[V] Set Vibrato [0..100 cents, 0 = off]",      setVibrato },
+  { 'R', "[R] Set Tremolo [0..100 %, 0 = off]",          setTremolo },
+  { 'v', "[v] Set Volume [0..100]",                      setVolume },
+  { 'w', "[w] Set Timbre [1..3] (pulse 12.5/25/50%)",    setTimbre },
+  { 'u', "[u] Set Tuning A4 [400..480 Hz, 0 = off]",     setTuning },
+  { 'j', "[j] Toggle equal / just intonation",           setIntonation },
   { 'n', "[n] Set normal mode",                          setNormal },
   { 'r', "[r] Set random mode",                          setRandom },
   { 'S', "[S] Show Menu",                                showMenu },
 };
 constexpr int nbrMenuItems = sizeof(menu) / sizeof(menu[0]);
 
-// A melody is defined as an array of musicNotes
-musicNote oldMacDonald[] =
-{
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_D, 4, N_LEN::N4 },
-  { NOTE_E, 4, N_LEN::N4 },
-  { NOTE_E, 4, N_LEN::N4 },
-  { NOTE_D, 4, N_LEN::N2 },
-  { NOTE_B, 4, N_LEN::N4 },
-  { NOTE_B, 4, N_LEN::N4 },
-  { NOTE_A, 4, N_LEN::N4 },
-  { NOTE_A, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N2d },
-
-  { NOTE_D, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_D, 4, N_LEN::N4 },
-  { NOTE_E, 4, N_LEN::N4 },
-  { NOTE_E, 4, N_LEN::N4 },
-  { NOTE_D, 4, N_LEN::N2 },
-  { NOTE_B, 4, N_LEN::N4 },
-  { NOTE_B, 4, N_LEN::N4 },
-  { NOTE_A, 4, N_LEN::N4 },
-  { NOTE_A, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N2d },
-
-  { NOTE_D, 4, N_LEN::N8 },
-  { NOTE_D, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { REST,   4, N_LEN::N4 },
-
-  { NOTE_G, 3, N_LEN::N4 },
-  { NOTE_G, 3, N_LEN::N4 },
-  { NOTE_G, 3, N_LEN::N4 },
-  { REST,   4, N_LEN::N4 },
-
-  { NOTE_G, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N4 },
-
-  { NOTE_G, 3, N_LEN::N8 },
-  { NOTE_G, 3, N_LEN::N8 },
-  { NOTE_G, 3, N_LEN::N4 },
-
-  { NOTE_G, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N8 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N4 },
-  { NOTE_D, 4, N_LEN::N4 },
-  { NOTE_E, 4, N_LEN::N4 },
-  { NOTE_E, 4, N_LEN::N4 },
-  { NOTE_D, 4, N_LEN::N2 },
-  { NOTE_B, 4, N_LEN::N4 },
-  { NOTE_B, 4, N_LEN::N4 },
-  { NOTE_A, 4, N_LEN::N4 },
-  { NOTE_A, 4, N_LEN::N4 },
-  { NOTE_G, 4, N_LEN::N1 },
-  { REST,   4, N_LEN::N2 },
-};
-constexpr int len_oldMacDonald = sizeof(oldMacDonald) / sizeof(oldMacDonald[0]);
-
-musicNote chomBueb[] =
-{
-  { NOTE_E,  4, N_LEN::N2 },
-  { NOTE_E,  5, N_LEN::N2d },
-  { NOTE_Cs, 5, N_LEN::N4 },
-  { NOTE_A,  4, N_LEN::N4 },
-  { NOTE_Fs, 4, N_LEN::N4 },
-  { NOTE_E,  4, N_LEN::N4d },
-  { NOTE_Fs, 4, N_LEN::N8 },
-  { NOTE_E,  4, N_LEN::N2 },
-  { REST,    4, N_LEN::N1d},  // REST is defined as NOTE_MAX
-};
-constexpr int len_chomBueb = sizeof(chomBueb) / sizeof(chomBueb[0]);
-
-musicNote amLouenesee[] =
-{
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N16 },
-  { NOTE_B ,  4, N_LEN::N8d },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8d },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N4 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N4d },
-  { REST,     4, N_LEN::N8 },
-  { REST,     4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N8d },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8d },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Cs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N4 },
-  { NOTE_E,   4, N_LEN::N8 },
-  { NOTE_Cs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N4d },
-  { REST,     4, N_LEN::N4 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N4 },
-  { NOTE_B,   4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8d },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_E ,  4, N_LEN::N4 },
-  { REST,     4, N_LEN::N4 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N4d },
-  { REST,     4, N_LEN::N8 },
-  { REST,     4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N4 },
-  { NOTE_Fs,  4, N_LEN::N16 },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8d },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Cs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N4 },
-  { NOTE_E,   4, N_LEN::N8 },
-  { NOTE_Cs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N4d },
-  { REST,     4, N_LEN::N4d },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_Cs,  5, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N4 },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_Cs,  5, N_LEN::N8d },
-  { NOTE_Cs,  5, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_Cs,  5, N_LEN::N4d },
-  { REST,     4, N_LEN::N8 },
-  { REST,     4, N_LEN::N8d },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Cs,  5, N_LEN::N8 },
-  { NOTE_Cs,  5, N_LEN::N8d },
-  { NOTE_Cs,  5, N_LEN::N16 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_E,   4, N_LEN::N4 },
-  { REST,     4, N_LEN::N8 },
-  { REST,     4, N_LEN::N8d },
-  { NOTE_E,   4, N_LEN::N16 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Fs,  4, N_LEN::N8 },
-  { NOTE_Gs,  4, N_LEN::N8 },
-  { NOTE_A,   4, N_LEN::N4d },
-  { REST,     4, N_LEN::N4d },
-  { REST,     4, N_LEN::N4d },
-  { REST,     4, N_LEN::N4d },
-  { REST,     4, N_LEN::N8 },
-  { REST,     4, N_LEN::N8 },
-  { NOTE_B,   3, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_B,   4, N_LEN::N8 },
-  { NOTE_A,   4, N_LEN::N16 },
-  { NOTE_Gs,  4, N_LEN::N4d },
-  { REST,     4, N_LEN::N4 },
-  { REST,     4, N_LEN::N4 },
-  { REST,     4, N_LEN::N16 },
-};
-constexpr int len_amLouenesee = sizeof(amLouenesee) / sizeof(amLouenesee[0]);
+// Chom Bueb in ABC notation, parsed while playing
+AbcParser abcParser(abcChomBueb);
 
-musicNote entertainer[] =
-{
-  { NOTE_D,  4, N_LEN::N8 },
-  { NOTE_Eb, 4, N_LEN::N8 },
-  { NOTE_E,  4, N_LEN::N8 },
-  { NOTE_C,  5, N_LEN::N4 },
-  { NOTE_E,  4, N_LEN::N8 },
-  { NOTE_C,  5, N_LEN::N4 },
-  { NOTE_E,  4, N_LEN::N8 },
-  { NOTE_C,  5, N_LEN::N8 },
-  { NOTE_C,  5, N_LEN::N2 },
-  { REST,    5, N_LEN::N8 },
-  { NOTE_C,  5, N_LEN::N8 },
-  { NOTE_D,  5, N_LEN::N8 },
-  { NOTE_Eb, 5, N_LEN::N8 },
-  { NOTE_E,  5, N_LEN::N8 },
-  { NOTE_C,  5, N_LEN::N8 },
-  { NOTE_D,  5, N_LEN::N8 },
-  { NOTE_E,  5, N_LEN::N4 },
-  { NOTE_B,  4, N_LEN::N8 },
-  { NOTE_D,  5, N_LEN::N4 },
-  { NOTE_C,  5, N_LEN::N2d},
-  { REST  ,  5, N_LEN::N1d},
-};
-constexpr int len_entertainer = sizeof(entertainer) / sizeof(entertainer[0]);
+// Melody entered in Music Macro Language over the CLI
+char mmlText[128] = "T120 O4 L8 CDEFGAB>C";
+MmlInterpreter mml(mmlText);
 
-musicNote martinshorn[] =
-{
-  { NOTE_Cs, 4, N_LEN::N4 },
-  { NOTE_Gs, 4, N_LEN::N4 },
-};
+// Melodies loaded at runtime are kept in the arena, not on the heap
+MelodyArena arena;
+ArenaMelody mmlMelody;
 
-musicNote postauto[] =
-{
-  { NOTE_Cs, 5, N_LEN::N4 },
-  { NOTE_E,  4, N_LEN::N4 },
-  { NOTE_A,  4, N_LEN::N4d },
-  { REST,    4, N_LEN::N2d },
-};
-constexpr int len_postauto = sizeof(postauto) / sizeof(postauto[0]);
+// Melodies compiled from the directory melodies/ at build time
+PackedMelody songbookMelody(songbook[0]);
+int songbookIndex = -1;
 
-musicNote pentatonicScale[] =
-{
-  { NOTE_C,  4, N_LEN::N4 },
-  { NOTE_D,  4, N_LEN::N4 },
-  { NOTE_E,  4, N_LEN::N4 },
-  { NOTE_G,  4, N_LEN::N4 },
-  { NOTE_A,  4, N_LEN::N4 },
-  { NOTE_B,  4, N_LEN::N4 },
-};
-constexpr int len_pentatonic = sizeof(pentatonicScale) / sizeof(pentatonicScale[0]);
+// Melody files data/*.mel on LittleFS (pio run -t uploadfs) are streamed, not loaded
+StreamedMelody streamedMelody;
+int fileIndex = -1;
 
-musicNote chromaticScale[] = 
-{
-  { NOTE_C,  4, N_LEN::N4 },
-  { NOTE_Cs, 4, N_LEN::N4 },
-  { NOTE_D , 4, N_LEN::N4 },
-  { NOTE_Eb, 4, N_LEN::N4 },
-  { NOTE_E , 4, N_LEN::N4 },
-  { NOTE_F , 4, N_LEN::N4 },
-  { NOTE_Fs, 4, N_LEN::N4 },
-  { NOTE_G , 4, N_LEN::N4 },
-  { NOTE_Gs, 4, N_LEN::N4 },
-  { NOTE_A,  4, N_LEN::N4 },
-  { NOTE_Bb, 4, N_LEN::N4 },
-  { NOTE_B , 4, N_LEN::N4 },
-  { NOTE_C,  5, N_LEN::N4 },
-};
-constexpr int len_chromatic = sizeof(chromaticScale) / sizeof(chromaticScale[0]); 
+// tune.abc on LittleFS is played and reloaded when it is written again
+#define TUNE_PATH "/littlefs/tune.abc"
+ReloadableMelody tune(arena);
 
 
 MelodyPlayer player(PIN_SPKR, channel);
-constexpr int len_martinshorn = sizeof(martinshorn) / sizeof(martinshorn[0]);
+TuningTable  tuning(440.0f);
+GlideEngine  glide(channel);
+Lfo          lfo(channel);
 
 /**
  * Plays the selected melody nonstop
@@ -393,7 +162,9 @@ constexpr int len_martinshorn = sizeof(martinshorn) / sizeof(martinshorn[0]);
 void playMelody(char ch)
 {
   beatTheBeat = false;
-  player.setVolume(2);
+  siren       = false;
+  playOnce    = false;
+  player.setVolume(10);
   switch(ch)
   {
     case 'a': player.setMelody(amLouenesee, len_amLouenesee);
@@ -420,18 +191,36 @@ void playMelody(char ch)
     case 'P': player.setMelody(pentatonicScale, len_pentatonic);
               Serial.printf("Playing 'Pentatonic Scale' "); 
     break;
+    case 'A': player.setMelody(abcParser);
+              Serial.printf("Playing 'Chom Bueb' from ABC notation "); 
+    break;
     default:
     break;
   }
 }
 
+/**
+ * Sweep up and down like the wail of a siren
+ */
+void playSiren(char ch)
+{
+  beatTheBeat = false;
+  siren       = true;
+  playOnce    = false;
+  player.setVolume(10);
+  player.playGlide(450.0f, 1300.0f, 1500, GLIDE::EXPONENTIAL, true);
+  Serial.printf("%s", "Playing siren ");
+}
+
 /**
  * Beat the beats like a metronom
  */
 void playBeats(char ch)
 {
   beatTheBeat = true;
-  player.setVolume(100);
+  siren       = false;
+  playOnce    = false;
+  player.setVolume(70);
   Serial.printf("%s", "Playing beats ");
 }
 
@@ -510,8 +299,58 @@ void setLegato(char ch)
 }
 
 /**
- * Set volume 0..511 which corresponds
- * to a duty cycle of 0..50%
+ * Set the time in ms to slide from note to note, 0 = off
+ */
+void setPortamento(char ch)
+{
+  int32_t value = 0;
+
+  delay(2000);
+  while (Serial.available())
+  {
+    value = Serial.parseInt();
+  }
+  value = constrain(value, 0, 500);
+  player.setPortamento(&glide, value);
+  Serial.printf("Portamento set to %d ms ", value);
+}
+
+/**
+ * Set the depth of the vibrato in cents at 5.5 Hz, 0 = off
+ */
+void setVibrato(char ch)
+{
+  int32_t value = 0;
+
+  delay(2000);
+  while (Serial.available())
+  {
+    value = Serial.parseInt();
+  }
+  value = constrain(value, 0, LFO_MAX_CENTS);
+  lfo.setVibrato(5.5f, value);
+  Serial.printf("Vibrato set to %d cents ", value);
+}
+
+/**
+ * Set the depth of the tremolo in percent at 4 Hz, 0 = off
+ */
+void setTremolo(char ch)
+{
+  int32_t value = 0;
+
+  delay(2000);
+  while (Serial.available())
+  {
+    value = Serial.parseInt();
+  }
+  value = constrain(value, 0, 100);
+  lfo.setTremolo(4.0f, value);
+  Serial.printf("Tremolo set to %d %% ", value);
+}
+
+/**
+ * Set the perceived volume 0..100
  */
 void setVolume(char ch)
 {
@@ -528,6 +367,296 @@ void setVolume(char ch)
   Serial.print(buf);
 }
 
+/**
+ * Play a melody entered in Music Macro Language, 
+ * the previous one is played again if nothing is entered
+ */
+void playMml(char ch)
+{
+  delay(2000);
+  if (Serial.available())
+  {
+    size_t n = Serial.readBytes(mmlText, sizeof(mmlText) - 1);
+    while (n > 0 && (mmlText[n-1] == '\n' || mmlText[n-1] == '\r')) n--;
+    mmlText[n] = '\0';
+  }
+  beatTheBeat = false;
+  siren       = false;
+  playOnce    = false;
+  player.setVolume(10);
+  mmlMelody.setMelody(MelodyHandle());  // give back the blocks of the previous melody first
+  mmlMelody.setMelody(arena.load(mml));  // parsed once
+  if (mmlMelody.melody().valid()) player.setMelody(mmlMelody);
+  else player.setMelody(mml);  // too long for the arena, parsed while playing
+  Serial.printf("Playing '%s' (%u notes in the arena) ", mmlText, mmlMelody.melody().length());
+}
+
+/**
+ * Stream the melody files of LittleFS one after the other. The file system is 
+ * mounted with the first file and not at boot, a task reads the notes ahead
+ */
+void playFile(char ch)
+{
+  char path[64] = "";
+  int  count    = 0;
+
+  if (! LittleFS.begin())
+  {
+    Serial.printf("%s", "LittleFS can't be mounted ");
+    return;
+  }
+  StreamStats stats = streamedMelody.stats();
+  if (stats.fills > 0) Serial.printf("Last file: %u buffers read, %u underruns, longest wait %u us\r\n", 
+                                     stats.fills, stats.underruns, stats.stallUs);
+  File root = LittleFS.open("/");
+  for (File file = root.openNextFile(); file; file = root.openNextFile())
+  {
+    if (strstr(file.name(), ".mel") == nullptr) continue;
+    if (count++ == fileIndex + 1 || path[0] == '\0') snprintf(path, sizeof(path), "/littlefs/%s", file.name());
+  }
+  if (count == 0)
+  {
+    Serial.printf("%s", "No melody files, upload them with pio run -t uploadfs ");
+    return;
+  }
+  fileIndex = (fileIndex + 1) % count;
+  if (! streamedMelody.open(path))
+  {
+    Serial.printf("Can't read %s ", path);
+    return;
+  }
+  streamedMelody.clearStats();
+  streamedMelody.startPrefetch();
+  beatTheBeat = false;
+  siren       = false;
+  playOnce    = false;
+  player.setVolume(10);
+  player.setMelody(streamedMelody);
+  Serial.printf("Streaming '%s', %d notes ", path, streamedMelody.length());
+}
+
+/**
+ * Write the ABC text pasted into the monitor within 2 s into tune.abc. 
+ * A tune which is playing changes at the next bar
+ */
+void writeTune(char ch)
+{
+  static char text[1024];
+
+  delay(2000);
+  size_t n = Serial.readBytes(text, sizeof(text) - 1);
+  text[n] = '\0';
+  if (n == 0 || ! LittleFS.begin())
+  {
+    Serial.printf("%s", "Nothing written ");
+    return;
+  }
+  FILE *file = fopen(TUNE_PATH, "w");
+  if (file == nullptr || fwrite(text, 1, n, file) != n || fclose(file) != 0)
+  {
+    Serial.printf("Can't write %s ", TUNE_PATH);
+    return;
+  }
+  Serial.printf("%u bytes written to %s ", n, TUNE_PATH);
+}
+
+/**
+ * Play tune.abc (Chom Bueb when it does not exist yet) and watch it. The task 
+ * which watches it parses a new version in the background
+ */
+void playTune(char ch)
+{
+  if (! LittleFS.begin())
+  {
+    Serial.printf("%s", "LittleFS can't be mounted ");
+    return;
+  }
+  FILE *file = fopen(TUNE_PATH, "r");
+  if (file == nullptr && (file = fopen(TUNE_PATH, "w")) != nullptr) fputs(abcChomBueb, file);
+  if (file != nullptr) fclose(file);
+  if (! tune.watch(TUNE_PATH))
+  {
+    Serial.printf("Can't load %s ", TUNE_PATH);
+    return;
+  }
+  tune.startWatching();
+  beatTheBeat = false;
+  siren       = false;
+  playOnce    = false;
+  player.setVolume(10);
+  player.setMelody(tune);
+  ReloadStats stats = tune.stats();
+  Serial.printf("Playing %s, %u reloads, %u swaps, %u failed, last parsed in %u us ", TUNE_PATH, 
+                stats.reloads, stats.swaps, stats.failed, stats.loadUs);
+}
+
+/**
+ * Play the melodies of the songbook one after the other
+ */
+void playSongbook(char ch)
+{
+  if (songbookSize == 0)
+  {
+    Serial.printf("%s", "Songbook is empty ");
+    return;
+  }
+  songbookIndex = (songbookIndex + 1) % songbookSize;
+  songbookMelody.setEntry(songbook[songbookIndex]);
+  beatTheBeat = false;
+  siren       = false;
+  playOnce    = false;
+  player.setVolume(10);
+  player.setMelody(songbookMelody);
+  const MelodyInfo &info = *songbook[songbookIndex].info;  // computed by the compiler
+  uint32_t ms = melodyMs(info, songbook[songbookIndex].tempo, player.getLegato());
+  Serial.printf("Playing '%s' from the songbook (%u notes, %u.%u s, %u semitones, %u%% rests) ", 
+                songbook[songbookIndex].name, info.notes, ms / 1000, ms % 1000 / 100, pitchRange(info), restPercent(info));
+}
+
+TaskHandle_t waiterTask = nullptr;
+uint32_t     msPlayStart;
+
+/**
+ * Task which sleeps until it is notified that the melody is done
+ */
+void waitForMelody(void *arg)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    Serial.printf("Waiter task: melody done after %u ms ", millis() - msPlayStart);
+  }
+}
+
+/**
+ * Play Postauto once and let the waiter task be notified at its end
+ */
+void playAndWait(char ch)
+{
+  if (waiterTask == nullptr) xTaskCreatePinnedToCore(waitForMelody, "waiter", 2048, nullptr, 1, &waiterTask, 1);
+  beatTheBeat = false;
+  siren       = false;
+  playOnce    = true;
+  player.setVolume(10);
+  msPlayStart = millis();
+  MelodyPlayer::PlayHandle handle = player.play(postauto, len_postauto);
+  handle.notify(waiterTask);
+  Serial.printf("Playing 'Postauto' once, the waiter task sleeps ");
+}
+
+#if defined(__cpp_impl_coroutine)
+Sequencer sequencer;
+
+bool bootPressed(void *arg)
+{
+  return digitalRead(GPIO_NUM_0) == LOW;
+}
+
+/**
+ * Martinshorn, wait for the BOOT button, Postauto 3 times, 4 beats
+ */
+Sequence demoSequence(MelodyPlayer &player)
+{
+  co_await player.play(martinshorn, len_martinshorn);
+  Serial.printf("Press BOOT to continue ");
+  co_await until(bootPressed);
+  for (int i = 0; i < 3; i++) co_await player.play(postauto, len_postauto);
+  co_await player.beats(4);
+  Serial.printf("Sequence done, frames in use %d, largest frame %u bytes ", 
+                SequenceFramePool::inUse(), SequenceFramePool::largest());
+}
+
+/**
+ * Start the demo sequence, stop it when it is running
+ */
+void playSequence(char ch)
+{
+  if (sequencer.running())
+  {
+    sequencer.stop();
+    player.mute();
+    Serial.printf("%s", "Sequence stopped ");
+    return;
+  }
+  pinMode(GPIO_NUM_0, INPUT_PULLUP);
+  beatTheBeat = false;
+  siren       = false;
+  playOnce    = false;
+  if (sequencer.start(demoSequence(player))) Serial.printf("%s", "Sequence started ");
+  else Serial.printf("%s", "No frame for the sequence ");
+}
+#endif
+
+/**
+ * Set the timbre given by the pulse width
+ * 1 = 12.5%, 2 = 25%, 3 = 50% (square wave)
+ */
+void setTimbre(char ch)
+{
+  int32_t value = 0;
+
+  delay(2000);
+  while (Serial.available())
+  {
+    value = Serial.parseInt();
+  }
+  switch(value)
+  {
+    case 1:  player.setTimbre(TIMBRE::PULSE_12);
+             Serial.printf("%s", "Timbre set to pulse 12.5% ");
+    break;
+    case 2:  player.setTimbre(TIMBRE::PULSE_25);
+             Serial.printf("%s", "Timbre set to pulse 25% ");
+    break;
+    default: player.setTimbre(TIMBRE::PULSE_50);
+             Serial.printf("%s", "Timbre set to square wave ");
+    break;
+  }
+}
+
+/**
+ * Tune the notes to the reference pitch A4 in Hz and print
+ * the error of each note, 0 returns to ledcWriteNote()
+ */
+void setTuning(char ch)
+{
+  int32_t value = 0;
+
+  delay(2000);
+  while (Serial.available())
+  {
+    value = Serial.parseInt();
+  }
+  if (value == 0)
+  {
+    player.setTuning(nullptr);
+    Serial.printf("%s", "Tuning off ");
+    return;
+  }
+  tuning.setReference((float)value);
+  tuning.report(Serial);
+  player.setTuning(&tuning);
+  Serial.printf("Tuning set to A4 = %.1f Hz ", tuning.getReference());
+}
+
+/**
+ * Toggle between equal temperament and just intonation in C
+ */
+void setIntonation(char ch)
+{
+  if (tuning.getTemperament() == TEMPERAMENT::EQUAL)
+  {
+    tuning.setTemperament(TEMPERAMENT::JUST, NOTE_C);
+    Serial.printf("%s", "Just intonation in C set ");
+  }
+  else
+  {
+    tuning.setTemperament(TEMPERAMENT::EQUAL);
+    Serial.printf("%s", "Equal temperament set ");
+  }
+  player.setTuning(&tuning);
+}
+
 /**
  * Set normal playing mode
  */
@@ -586,6 +715,9 @@ void doMenu()
 
 void setup()
 {
+  player.begin();  // the ledc channel is set up here and not before setup()
+  player.setPortamento(&glide, 0);  // the glide is needed for the siren
+  player.setLfo(&lfo);
   Serial.begin(115200);
   showMenu('S');
 }
@@ -593,8 +725,16 @@ void setup()
 void loop() 
 {
   if (Serial.available()) doMenu();
+  if (siren) return;  // the glide runs in the timer interrupt
+#if defined(__cpp_impl_coroutine)
+  if (sequencer.running()) 
+  {
+    sequencer.run();  // the sequence plays the melodies
+    return;
+  }
+#endif
   if (beatTheBeat) 
     player.playBeats();
   else
-    player.playMelody(true);
-}
\ No newline at end of file
+    player.playMelody(! playOnce);
+}
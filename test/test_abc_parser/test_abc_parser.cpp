@@ -0,0 +1,216 @@
+/**
+ * Test         test_abc_parser.cpp
+ *
+ * Purpose      Host tests of the AbcParser (pio test -e native): header fields,
+ *              keys with modes and explicit accidentals, accidentals valid to the
+ *              end of the bar, octaves and lengths, broken rhythm, tuplets, chords,
+ *              repeats with first and second endings. The benchmark measures how
+ *              many notes per second are parsed.
+ */
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include "AbcParser.h"
+
+#define MAX_NOTES 64
+
+static musicNote notes[MAX_NOTES];
+static int count;
+
+void setUp() { count = 0; }
+void tearDown() {}
+
+/**
+ * Parse the whole tune into notes[]
+ */
+static void parse(AbcParser &abc)
+{
+    musicNote n;
+    while (count < MAX_NOTES && abc.nextNote(n)) notes[count++] = n;
+}
+
+static void parse(const char *text)
+{
+    AbcParser abc(text);
+    parse(abc);
+}
+
+static void assertNote(int i, note_t note, int octave, int len)
+{
+    TEST_ASSERT_EQUAL(note, notes[i].note);
+    TEST_ASSERT_EQUAL(octave, notes[i].octave);
+    TEST_ASSERT_EQUAL(len, (int)notes[i].value);
+}
+
+void test_header()
+{
+    AbcParser abc("X:1\nT:Test\nM:3/4\nL:1/8\nQ:1/4=90\nK:C\nCDE|\n");
+    TEST_ASSERT_EQUAL(90, abc.tempo());
+    TEST_ASSERT_EQUAL(48, abc.barLength());
+    parse(abc);
+    TEST_ASSERT_EQUAL(3, count);
+    assertNote(0, NOTE_C, 4, 8);
+    assertNote(2, NOTE_E, 4, 8);
+
+    AbcParser dotted("X:1\nM:6/8\nQ:3/8=60\nK:C\nC|\n");  // L: from the meter, the beat is a dotted quarter
+    TEST_ASSERT_EQUAL(90, dotted.tempo());
+    TEST_ASSERT_EQUAL(48, dotted.barLength());
+    TEST_ASSERT_EQUAL(8, (int)(parse(dotted), notes[0].value));
+
+    AbcParser units("X:1\nM:2/4\nQ:120\nK:C\nC|\n");      // below 3/4 the unit is a 16th, Q: counts units
+    TEST_ASSERT_EQUAL(30, units.tempo());
+}
+
+void test_key()
+{
+    parse("X:1\nK:G\nFf|\n");
+    assertNote(0, NOTE_Fs, 4, 8);
+    assertNote(1, NOTE_Fs, 5, 8);
+
+    setUp();
+    parse("X:1\nK:Dm\nBE|\n");          // D minor has one flat
+    assertNote(0, NOTE_Bb, 4, 8);
+    assertNote(1, NOTE_E, 4, 8);
+
+    setUp();
+    parse("X:1\nK:Ddor\nFB|\n");        // D dorian has no accidentals
+    assertNote(0, NOTE_F, 4, 8);
+    assertNote(1, NOTE_B, 4, 8);
+
+    setUp();
+    parse("X:1\nK:D ^g _b\nFGB|\n");    // explicit accidentals after the key
+    assertNote(0, NOTE_Fs, 4, 8);
+    assertNote(1, NOTE_Gs, 4, 8);
+    assertNote(2, NOTE_Bb, 4, 8);
+
+    setUp();
+    parse("X:1\nK:F clef=bass\nB|\n");  // key=value is not an accidental
+    assertNote(0, NOTE_Bb, 4, 8);
+
+    setUp();
+    parse("X:1\nK:C\nF[K:F]B|\n");      // inline field
+    assertNote(1, NOTE_Bb, 4, 8);
+}
+
+void test_accidentals()
+{
+    parse("X:1\nK:C\n^FFf|F=F_B|^^C__E|\n");
+    assertNote(0, NOTE_Fs, 4, 8);
+    assertNote(1, NOTE_Fs, 4, 8);   // valid to the end of the bar
+    assertNote(2, NOTE_F, 5, 8);    // only in its octave
+    assertNote(3, NOTE_F, 4, 8);    // forgotten at the bar line
+    assertNote(4, NOTE_F, 4, 8);
+    assertNote(5, NOTE_Bb, 4, 8);
+    assertNote(6, NOTE_D, 4, 8);
+    assertNote(7, NOTE_D, 4, 8);
+
+    setUp();
+    parse("X:1\nK:C\n_C^B|\n");         // across the octave
+    assertNote(0, NOTE_B, 3, 8);
+    assertNote(1, NOTE_C, 5, 8);
+}
+
+void test_octaves_and_lengths()
+{
+    parse("X:1\nL:1/8\nK:C\nC,c'C2C/C3/2C//z4|\n");
+    assertNote(0, NOTE_C, 3, 8);
+    assertNote(1, NOTE_C, 6, 8);
+    assertNote(2, NOTE_C, 4, 16);
+    assertNote(3, NOTE_C, 4, 4);
+    assertNote(4, NOTE_C, 4, 12);
+    assertNote(5, NOTE_C, 4, 2);
+    assertNote(6, REST, 4, 32);
+}
+
+void test_broken_rhythm_and_chords()
+{
+    parse("X:1\nL:1/8\nK:C\nC>DE<FG>>A|[CEG]2[EGc]|\n");
+    TEST_ASSERT_EQUAL(8, count);
+    assertNote(0, NOTE_C, 4, 12);
+    assertNote(1, NOTE_D, 4, 4);
+    assertNote(2, NOTE_E, 4, 4);
+    assertNote(3, NOTE_F, 4, 12);
+    assertNote(4, NOTE_G, 4, 14);
+    assertNote(5, NOTE_A, 4, 2);
+    assertNote(6, NOTE_C, 4, 16);   // the first note of the chord
+    assertNote(7, NOTE_E, 4, 8);
+}
+
+void test_tuplets()
+{
+    parse("X:1\nL:1/8\nK:C\n(3CDE F|(5CDEFG|\n");
+    TEST_ASSERT_EQUAL(9, count);
+    int triplet = (int)notes[0].value + (int)notes[1].value + (int)notes[2].value;
+    TEST_ASSERT_EQUAL(16, triplet);   // three in the time of two, rounded without drift
+    for (int i = 0; i < 3; i++) TEST_ASSERT_INT_WITHIN(1, 5, (int)notes[i].value);
+    assertNote(3, NOTE_F, 4, 8);      // the tuplet is over
+    int quintuplet = 0;
+    for (int i = 4; i < 9; i++) quintuplet += (int)notes[i].value;
+    TEST_ASSERT_EQUAL(16, quintuplet);  // five in the time of two
+}
+
+void test_repeats()
+{
+    parse("X:1\nK:C\n|:CD:|E|\n");
+    const note_t simple[] = { NOTE_C, NOTE_D, NOTE_C, NOTE_D, NOTE_E };
+    TEST_ASSERT_EQUAL(5, count);
+    for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL(simple[i], notes[i].note);
+
+    setUp();
+    parse("X:1\nK:C\n|:C|1D:|2E|F|\n");
+    const note_t endings[] = { NOTE_C, NOTE_D, NOTE_C, NOTE_E, NOTE_F };
+    TEST_ASSERT_EQUAL(5, count);
+    for (int i = 0; i < 5; i++) TEST_ASSERT_EQUAL(endings[i], notes[i].note);
+
+    setUp();
+    parse("X:1\nK:C\nCD:|E::F:|G|\n");  // from the beginning, :: ends and starts a repeat
+    const note_t twice[] = { NOTE_C, NOTE_D, NOTE_C, NOTE_D, NOTE_E, NOTE_E, NOTE_F, NOTE_F, NOTE_G };
+    TEST_ASSERT_EQUAL(9, count);
+    for (int i = 0; i < 9; i++) TEST_ASSERT_EQUAL(twice[i], notes[i].note);
+}
+
+void test_end_and_rewind()
+{
+    AbcParser abc("X:1\nK:C\n\"Am\"!trill!{g}C %comment\nD\n\nE\nX:2\n");
+    parse(abc);
+    TEST_ASSERT_EQUAL(2, count);    // the empty line ends the tune
+    assertNote(1, NOTE_D, 4, 8);
+    abc.rewind();
+    setUp();
+    parse(abc);
+    TEST_ASSERT_EQUAL(2, count);
+    assertNote(0, NOTE_C, 4, 8);
+}
+
+void test_benchmark_parse()
+{
+    std::string tune = "X:1\nT:Bench\nM:6/8\nL:1/8\nQ:3/8=100\nK:Gmix\n";
+    for (int i = 0; i < 200; i++) tune += "|:\"G\"G>AB (3cBA ^F2G|[1 d2e _B/c/d:|[2 g2f e>dc|\n";
+    AbcParser abc(tune.c_str());
+    musicNote n;
+    uint32_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < 20; run++)
+    {
+        abc.rewind();
+        while (abc.nextNote(n)) total++;
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(20 * 200 * 26, total);  // 8 + 5 notes played twice per line
+    printf("ABC: %.1f Mnotes/s parsed, %.0f ns per note\n", total / s / 1e6, s * 1e9 / total);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_header);
+    RUN_TEST(test_key);
+    RUN_TEST(test_accidentals);
+    RUN_TEST(test_octaves_and_lengths);
+    RUN_TEST(test_broken_rhythm_and_chords);
+    RUN_TEST(test_tuplets);
+    RUN_TEST(test_repeats);
+    RUN_TEST(test_end_and_rewind);
+    RUN_TEST(test_benchmark_parse);
+    return UNITY_END();
+}
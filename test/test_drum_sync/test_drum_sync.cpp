@@ -0,0 +1,120 @@
+/**
+ * Test         test_drum_sync.cpp
+ *
+ * Purpose      Host tests of the drums following the melody (pio test -e native).
+ *              A melody of quarter notes is played with the default gap of 10 ms
+ *              between the notes, so it falls behind its tempo by 10 ms per note.
+ *              A kick on the first step of each bar is rendered by the DacSynth
+ *              block by block as the virtual time passes. With follow(player) the
+ *              kick starts with the first note of the bar within a block and stops
+ *              with the melody, without it the free running sequencer runs away 
+ *              from the melody.
+ */
+#include <unity.h>
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "NullOutput.h"
+#include "DacSynth.h"
+
+#define RATE   32000
+#define BARS   8
+#define BLOCK_MS (DAC_BLOCK * 1000 / RATE)     // 8 ms
+
+typedef BasicMelodyPlayer<VirtualClock, NullOutput> Player;
+
+static musicNote melody[4 * BARS];
+static const DrumLane kickLane[] = { { DRUM::KICK, 100, 0b0000000000000001 } };
+static const DrumPattern kickPattern = { 16, 1, kickLane };
+
+static uint32_t barMs[BARS + 1];     // start of the first note of each bar
+static int      bars;
+
+static void onBar(const PlayerEvent &e, void *arg)
+{
+    if (bars <= BARS) barMs[bars++] = e.ms;
+}
+
+void setUp()
+{
+    for (auto &n : melody) n = { NOTE_C, 4, N_LEN::N4 };
+    bars = 0;
+}
+
+void tearDown() {}
+
+/**
+ * Play the melody once, render the synth as the time passes and return 
+ * in kick[] the ms of each kick (the first sound after silence)
+ */
+static int play(bool follow, uint32_t *kick, int maxKicks)
+{
+    static int16_t block[DAC_BLOCK];
+    DacSynth synth(RATE);
+    Player   player;
+    synth.begin();
+    synth.setTempo(120);
+    synth.setPattern(kickPattern);
+    player.setTempo(120);
+    player.addCallback(onBar, nullptr, EVENT_MASK(PLAYER_EVENT::BAR));
+    player.setMelody(melody, 4 * BARS);
+
+    uint32_t rendered = 0;    // ms
+    int  kicks   = 0;
+    int  quiet   = RATE;   // samples of silence up to now
+    bool started = false;
+    while (player.clock().millis() < 4 * BARS * 520)
+    {
+        player.playMelody();
+        if (! started && player.getPosition() > 0)
+        {
+            synth.startPattern();   // with the first note
+            started = true;
+            rendered = player.clock().millis();
+        }
+        player.clock().advance(1);
+        while (started && rendered <= player.clock().millis())   // a block is rendered when it starts to play
+        {
+            if (follow) synth.follow(player);
+            synth.render(block, DAC_BLOCK);
+            for (int i = 0; i < DAC_BLOCK; i++)
+            {
+                if (block[i] == (int16_t)0x8000) { quiet++; continue; }
+                // a kick starts after 20 ms of silence, the wave itself crosses 0
+                if (quiet > RATE / 50 && kicks < maxKicks) kick[kicks++] = rendered + i * 1000 / RATE;
+                quiet = 0;
+            }
+            rendered += BLOCK_MS;
+        }
+    }
+    return kicks;
+}
+
+void test_drums_follow_the_melody()
+{
+    uint32_t kick[BARS + 2];
+    for (int i = 8; i < 12; i++) melody[i].note = REST;   // the drums go on in a bar of rests
+    int kicks = play(true, kick, BARS + 2);
+    TEST_ASSERT_EQUAL(BARS, kicks);
+    TEST_ASSERT_EQUAL(BARS, bars);
+    for (int i = 0; i < BARS; i++)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL(barMs[i], kick[i]);         // never before the note
+        TEST_ASSERT_LESS_OR_EQUAL(barMs[i] + BLOCK_MS, kick[i]);  // within the block of the note
+    }
+}
+
+void test_free_running_drums_drift()
+{
+    uint32_t kick[BARS + 2];
+    play(false, kick, BARS + 2);
+    // the melody is 40 ms per bar slower than its tempo, the kicks are not
+    TEST_ASSERT_GREATER_THAN(200, (int32_t)(barMs[BARS - 1] - kick[BARS - 1]));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_drums_follow_the_melody);
+    RUN_TEST(test_free_running_drums_drift);
+    return UNITY_END();
+}
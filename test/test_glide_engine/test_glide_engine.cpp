@@ -0,0 +1,121 @@
+/**
+ * Test         test_glide_engine.cpp
+ *
+ * Purpose      Host simulation of the GlideEngine (pio test -e native): the table of
+ *              a sweep is prepared as on the ESP32 and advance() is called once per
+ *              tick of the control timer, as the interrupt does. The frequencies
+ *              written tick by tick must start and end at the given frequencies,
+ *              take the given ticks, move in equal steps of pitch (EXPONENTIAL) or
+ *              of frequency (LINEAR) and turn at both ends with pingPong.
+ */
+#include <unity.h>
+#include <math.h>
+#include "GlideEngine.h"
+#include "TuningTable.h"
+
+#define MAX_TICKS 4000
+
+static GlideEngine glide(0);
+static float written[MAX_TICKS];    // frequency in the register after each tick
+static int   lastWrite;             // tick of the last register write
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * Run the interrupt for ticks ticks, the register holds 0 Hz until the first write
+ */
+static void run(int ticks)
+{
+    float f = 0.0f;
+    lastWrite = -1;
+    for (int t = 0; t < ticks; t++)
+    {
+        int step = glide.advance();
+        if (step >= 0)
+        {
+            f = glide.frequency(step);
+            lastWrite = t;
+        }
+        written[t] = f;
+    }
+}
+
+static float cents(float f, float reference)
+{
+    return 1200.0f * log2f(f / reference);
+}
+
+void test_exponential_sweep_in_equal_steps_of_pitch()
+{
+    glide.prepare(440.0f, 880.0f, 100, GLIDE::EXPONENTIAL, false);
+    run(200);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 440.0f, written[0]);     // the start is written at once
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 880.0f, written[199]);
+    TEST_ASSERT_INT_WITHIN(1, 99, lastWrite);                // the last step after 100 ticks
+    TEST_ASSERT_FALSE(glide.isGliding());
+    for (int t = 1; t < 200; t++) TEST_ASSERT_TRUE(written[t] >= written[t - 1]);
+    for (int t = 0; t < 100; t += 10)
+    {
+        TEST_ASSERT_FLOAT_WITHIN(15.0f, 1200.0f * t / 99, cents(written[t], 440.0f));  // a straight line in pitch
+    }
+}
+
+void test_linear_sweep_in_equal_steps_of_frequency()
+{
+    glide.prepare(440.0f, 880.0f, 100, GLIDE::LINEAR, false);
+    run(200);
+    for (int t = 0; t < 100; t += 10)
+    {
+        TEST_ASSERT_FLOAT_WITHIN(5.0f, 440.0f + 440.0f * t / 99, written[t]);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 880.0f, written[199]);
+}
+
+void test_downward_sweep()
+{
+    glide.prepare(1200.0f, 300.0f, 50, GLIDE::EXPONENTIAL, false);
+    run(100);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 1200.0f, written[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 300.0f, written[99]);
+    for (int t = 1; t < 100; t++) TEST_ASSERT_TRUE(written[t] <= written[t - 1]);
+}
+
+void test_long_glide_holds_each_step_for_several_ticks()
+{
+    glide.prepare(200.0f, 2000.0f, 2000, GLIDE::EXPONENTIAL, false);
+    TEST_ASSERT_EQUAL(GLIDE_STEPS, glide.steps());
+    run(MAX_TICKS);
+    TEST_ASSERT_INT_WITHIN(2, 1999, lastWrite);              // still takes 2000 ticks
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 2000.0f, written[MAX_TICKS - 1]);
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, 1200.0f * log2f(10.0f) / 2, cents(written[1000], 200.0f));  // halfway
+}
+
+void test_ping_pong_turns_at_both_ends()
+{
+    glide.prepare(500.0f, 1000.0f, 100, GLIDE::EXPONENTIAL, true);
+    run(400);
+    TEST_ASSERT_TRUE(glide.isGliding());                     // until stop()
+    int turns = 0;
+    for (int t = 2; t < 400; t++)
+    {
+        TEST_ASSERT_TRUE(written[t] >= 499.0f && written[t] <= 1001.0f);
+        if ((written[t] - written[t - 1]) * (written[t - 1] - written[t - 2]) < 0) turns++;
+    }
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 1000.0f, written[99]);    // up
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, 500.0f, written[198]);    // and down again
+    TEST_ASSERT_INT_WITHIN(1, 3, turns);
+    glide.stop();
+    TEST_ASSERT_EQUAL(-1, glide.advance());                  // nothing is written after stop()
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_exponential_sweep_in_equal_steps_of_pitch);
+    RUN_TEST(test_linear_sweep_in_equal_steps_of_frequency);
+    RUN_TEST(test_downward_sweep);
+    RUN_TEST(test_long_glide_holds_each_step_for_several_ticks);
+    RUN_TEST(test_ping_pong_turns_at_both_ends);
+    return UNITY_END();
+}
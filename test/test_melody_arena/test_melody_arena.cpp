@@ -0,0 +1,248 @@
+/**
+ * Test         test_melody_arena.cpp
+ *
+ * Purpose      Host tests of the MelodyArena (pio test -e native): random loads and
+ *              releases of melodies of 1..110 notes with copied and moved handles,
+ *              after which every melody still plays its notes, the statistics match
+ *              the melodies held and all blocks are free again at the end. Tunes 
+ *              with changes of tempo, volume and meter in the middle play the same
+ *              from the arena as from their parser, also after a seek, and notes
+ *              longer than a packed note are split. The benchmark times 100000
+ *              loads as described in README.
+ */
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "MelodyArena.h"
+#include "AbcParser.h"
+#include "MmlInterpreter.h"
+
+#define HELD  8
+#define ROUNDS 20000
+#define LOADS  100000
+
+static MelodyArena arena;
+static uint32_t random32 = 1;
+
+static uint32_t next(uint32_t n)
+{
+    random32 = random32 * 1664525 + 1013904223;
+    return (random32 >> 8) % n;
+}
+
+/**
+ * Note i of the melody with the tag, so each melody has its own notes
+ */
+static musicNote noteOf(uint32_t tag, int i)
+{
+    return { (note_t)((tag + i) % 13), (uint8_t)((tag + 3 * i) % 9), (N_LEN)(1 + (tag + i) % 64) };
+}
+
+static void fill(musicNote *m, uint32_t tag, int len)
+{
+    for (int i = 0; i < len; i++) m[i] = noteOf(tag, i);
+}
+
+static void assertMelody(const MelodyHandle &handle, uint32_t tag, int len)
+{
+    ArenaMelody source(handle);
+    musicNote n;
+    TEST_ASSERT_EQUAL(len, handle.length());
+    for (int i = 0; i < len; i++)
+    {
+        musicNote e = noteOf(tag, i);
+        TEST_ASSERT_TRUE(source.nextNote(n));
+        TEST_ASSERT_EQUAL(e.note, n.note);
+        TEST_ASSERT_EQUAL(e.octave, n.octave);
+        TEST_ASSERT_EQUAL((int)e.value, (int)n.value);
+    }
+    TEST_ASSERT_FALSE(source.nextNote(n));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_alloc_free_stress()
+{
+    MelodyHandle held[HELD];
+    uint32_t tag[HELD] = { 0 };
+    int      len[HELD] = { 0 };
+    musicNote m[110];
+    uint32_t loaded = 0, full = 0;
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        int i = next(HELD);
+        switch (next(4))
+        {
+            case 0:  // replace, the blocks of the old melody are given back
+            case 1:
+            {
+                int n = 1 + next(110);
+                fill(m, round, n);
+                MelodyHandle h = arena.load(m, n);
+                if (! h.valid())
+                {
+                    full++;   // all entries in use or the notes don't fit
+                    TEST_ASSERT_TRUE(arena.stats().melodies == ARENA_MELODIES || arena.freeNotes() < (uint32_t)n);
+                    break;
+                }
+                held[i] = (MelodyHandle &&)h;
+                tag[i]  = round;
+                len[i]  = n;
+                loaded++;
+                break;
+            }
+            case 2:  // a copy keeps the melody when the original is released
+            {
+                int j = next(HELD);
+                held[j] = held[i];
+                tag[j]  = tag[i];
+                len[j]  = len[i];
+                break;
+            }
+            default:
+                held[i].release();
+                break;
+        }
+        if (round % 97 == 0)
+        {
+            for (int k = 0; k < HELD; k++)
+                if (held[k].valid()) assertMelody(held[k], tag[k], len[k]);
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(ROUNDS / 4, loaded);
+    ArenaStats stats = arena.stats();
+    TEST_ASSERT_LESS_OR_EQUAL(ARENA_BLOCKS, stats.blocksHigh);
+    TEST_ASSERT_LESS_OR_EQUAL(HELD, stats.melodies);
+    for (auto &h : held) h.release();
+    stats = arena.stats();
+    TEST_ASSERT_EQUAL(0, stats.blocks);
+    TEST_ASSERT_EQUAL(0, stats.melodies);
+    TEST_ASSERT_EQUAL(0, stats.notes);
+    TEST_ASSERT_EQUAL(ARENA_BLOCKS * ARENA_BLOCK_NOTES, arena.freeNotes());
+    TEST_ASSERT_EQUAL(full, stats.failed);
+}
+
+void test_full_arena_keeps_nothing()
+{
+    static musicNote m[ARENA_BLOCKS * ARENA_BLOCK_NOTES + 1];
+    fill(m, 7, ARENA_BLOCKS * ARENA_BLOCK_NOTES + 1);
+    ArenaStats before = arena.stats();
+    MelodyHandle h = arena.load(m, ARENA_BLOCKS * ARENA_BLOCK_NOTES + 1);
+    TEST_ASSERT_FALSE(h.valid());
+    TEST_ASSERT_EQUAL(0, arena.stats().blocks);
+    TEST_ASSERT_EQUAL(before.failed + 1, arena.stats().failed);
+    h = arena.load(m, ARENA_BLOCKS * ARENA_BLOCK_NOTES);   // exactly fits
+    TEST_ASSERT_TRUE(h.valid());
+    TEST_ASSERT_EQUAL(0, arena.freeNotes());
+    TEST_ASSERT_EQUAL(0, arena.wastePercent());
+}
+
+/**
+ * Load the source into the arena and play both side by side, the arena must deliver
+ * the same notes with the same tempo, volume and bar length. Then seek to each
+ * note of the copy, it must continue with the settings of that note
+ */
+static void assertSameAsSource(NoteSource &source, int changes)
+{
+    static uint16_t position[256];
+    static int      tempo[256], volume[256], barLength[256];
+    MelodyHandle h = arena.load(source);
+    TEST_ASSERT_TRUE(h.valid());
+    ArenaMelody copy(h);
+    musicNote a, b;
+    int notes = 0, changed = 0;
+
+    source.rewind();
+    while (source.nextNote(a) && notes < 256)
+    {
+        position[notes] = copy.position();
+        TEST_ASSERT_TRUE(copy.nextNote(b));
+        TEST_ASSERT_EQUAL(a.note, b.note);
+        TEST_ASSERT_EQUAL(a.octave, b.octave);
+        TEST_ASSERT_EQUAL((int)a.value, (int)b.value);
+        TEST_ASSERT_EQUAL(source.tempo(), copy.tempo());
+        TEST_ASSERT_EQUAL(source.volume(), copy.volume());
+        TEST_ASSERT_EQUAL(source.barLength(), copy.barLength());
+        tempo[notes]     = copy.tempo();
+        volume[notes]    = copy.volume();
+        barLength[notes] = copy.barLength();
+        if (notes > 0 && (tempo[notes] != tempo[notes - 1] || volume[notes] != volume[notes - 1]
+                          || barLength[notes] != barLength[notes - 1])) changed++;
+        notes++;
+    }
+    TEST_ASSERT_FALSE(copy.nextNote(b));
+    TEST_ASSERT_EQUAL(changes, changed);
+    for (int i = 0; i < notes; i++)
+    {
+        TEST_ASSERT_TRUE(copy.seek(position[i]));
+        TEST_ASSERT_TRUE(copy.nextNote(b));
+        TEST_ASSERT_EQUAL(tempo[i], copy.tempo());
+        TEST_ASSERT_EQUAL(volume[i], copy.volume());
+        TEST_ASSERT_EQUAL(barLength[i], copy.barLength());
+    }
+}
+
+void test_mml_changes_in_the_middle_are_kept()
+{
+    MmlInterpreter mml("T120 V8 L8 CDEF T200 GAB>C V15 C4 T60 V4 <C2");
+    assertSameAsSource(mml, 3);
+}
+
+void test_abc_changes_in_the_middle_are_kept()
+{
+    AbcParser abc("X:1\nM:4/4\nL:1/8\nQ:1/4=100\nK:C\nCDEF GABc|[Q:1/4=160]cBAG FEDC|[M:3/4]E2D2C2|\n");
+    assertSameAsSource(abc, 2);
+}
+
+void test_long_notes_are_split()
+{
+    const musicNote m[] = { { NOTE_C, 4, (N_LEN)600 }, { REST, 4, (N_LEN)300 }, { NOTE_D, 4, N_LEN::N4 } };
+    const int parts[] = { 255, 255, 90, 255, 45, 16 };
+    uint32_t failed = arena.stats().failed;
+    MelodyHandle h = arena.load(m, 3);
+    TEST_ASSERT_TRUE(h.valid());
+    TEST_ASSERT_EQUAL(failed + 1, arena.stats().failed);   // the C is struck 3 times, the rest is exact
+    ArenaMelody copy(h);
+    musicNote n;
+    for (int i = 0; i < 6; i++)
+    {
+        TEST_ASSERT_TRUE(copy.nextNote(n));
+        TEST_ASSERT_EQUAL(i < 3 ? NOTE_C : i < 5 ? REST : NOTE_D, n.note);
+        TEST_ASSERT_EQUAL(parts[i], (int)n.value);
+    }
+    TEST_ASSERT_FALSE(copy.nextNote(n));
+}
+
+/**
+ * As in README: 100000 loads of 1..110 notes, the last 8 melodies are kept
+ */
+void test_benchmark_loads()
+{
+    static MelodyHandle held[HELD];
+    static musicNote m[110];
+    uint32_t failed = arena.stats().failed;
+    fill(m, 3, 110);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < LOADS; i++) held[i % HELD] = arena.load(m, 1 + next(110));
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint32_t fails = arena.stats().failed - failed;
+    printf("Arena: %.0f ns per load, %u of %u loads failed, %u blocks high\n", s * 1e9 / LOADS, fails, LOADS, 
+           arena.stats().blocksHigh);
+    for (auto &h : held) h.release();
+    TEST_ASSERT_EQUAL(0, arena.stats().blocks);
+    TEST_ASSERT_LESS_THAN(5000, (int)(s * 1e9 / LOADS));   // far below a note, even on a slow host
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_alloc_free_stress);
+    RUN_TEST(test_full_arena_keeps_nothing);
+    RUN_TEST(test_mml_changes_in_the_middle_are_kept);
+    RUN_TEST(test_abc_changes_in_the_middle_are_kept);
+    RUN_TEST(test_long_notes_are_split);
+    RUN_TEST(test_benchmark_loads);
+    return UNITY_END();
+}
@@ -0,0 +1,123 @@
+/**
+ * Test         test_mml.cpp
+ *
+ * Purpose      Host tests of the MmlInterpreter (pio test -e native): notes with
+ *              accidentals, lengths and dots, octaves, N, tempo and volume, and
+ *              loops, nested, nested too deep and without a count.
+ */
+#include <unity.h>
+#include "MmlInterpreter.h"
+
+#define MAX_NOTES 64
+
+static musicNote notes[MAX_NOTES];
+static int count;
+
+void setUp() { count = 0; }
+void tearDown() {}
+
+static void parse(MmlInterpreter &mml)
+{
+    musicNote n;
+    while (count < MAX_NOTES && mml.nextNote(n)) notes[count++] = n;
+}
+
+static void parse(const char *text)
+{
+    MmlInterpreter mml(text);
+    parse(mml);
+}
+
+static void assertNote(int i, note_t note, int octave, int len)
+{
+    TEST_ASSERT_EQUAL(note, notes[i].note);
+    TEST_ASSERT_EQUAL(octave, notes[i].octave);
+    TEST_ASSERT_EQUAL(len, (int)notes[i].value);
+}
+
+void test_notes()
+{
+    parse("O4 L8 C D+ E- B#4 C-2. R16 >C <<A N57 N0");
+    TEST_ASSERT_EQUAL(10, count);
+    assertNote(0, NOTE_C, 4, 8);
+    assertNote(1, NOTE_Eb, 4, 8);
+    assertNote(2, NOTE_Eb, 4, 8);
+    assertNote(3, NOTE_C, 5, 16);   // B# is in the next octave
+    assertNote(4, NOTE_B, 3, 48);   // C- in the octave below
+    assertNote(5, REST, 4, 4);
+    assertNote(6, NOTE_C, 5, 8);
+    assertNote(7, NOTE_A, 3, 8);
+    assertNote(8, NOTE_A, 4, 8);    // N57 is A4
+    assertNote(9, REST, 3, 8);      // N0 is a rest
+}
+
+void test_triplets_without_drift()
+{
+    parse("L12 CCC CCC");   // eighth triplets are 5.33 64ths
+    TEST_ASSERT_EQUAL(6, count);
+    int total = 0;
+    for (int i = 0; i < count; i++) total += (int)notes[i].value;
+    TEST_ASSERT_EQUAL(32, total);
+}
+
+void test_tempo_and_volume()
+{
+    MmlInterpreter mml("T90 V15 C");
+    TEST_ASSERT_EQUAL(0, mml.tempo());
+    TEST_ASSERT_EQUAL(-1, mml.volume());
+    parse(mml);
+    TEST_ASSERT_EQUAL(90, mml.tempo());
+    TEST_ASSERT_EQUAL(100, mml.volume());   // V15 is the full volume
+    mml.setText("T5 V0 C");
+    setUp();
+    parse(mml);
+    TEST_ASSERT_EQUAL(20, mml.tempo());  // at least 20
+    TEST_ASSERT_EQUAL(0, mml.volume());
+}
+
+void test_loops()
+{
+    parse("[CD]3 E");
+    const note_t simple[] = { NOTE_C, NOTE_D, NOTE_C, NOTE_D, NOTE_C, NOTE_D, NOTE_E };
+    TEST_ASSERT_EQUAL(7, count);
+    for (int i = 0; i < 7; i++) TEST_ASSERT_EQUAL(simple[i], notes[i].note);
+
+    setUp();
+    parse("[C[D]2]2 [E]");  // nested, without count twice
+    const note_t nested[] = { NOTE_C, NOTE_D, NOTE_D, NOTE_C, NOTE_D, NOTE_D, NOTE_E, NOTE_E };
+    TEST_ASSERT_EQUAL(8, count);
+    for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL(nested[i], notes[i].note);
+
+    setUp();
+    parse("[[[[[C]3]2]2]2]2");  // the fifth level is played once
+    TEST_ASSERT_EQUAL(16, count);
+
+    setUp();
+    parse("C]2 [D]1 [E]0");  // unbalanced ] is ignored, 1 and 0 play once
+    TEST_ASSERT_EQUAL(3, count);
+}
+
+void test_rewind()
+{
+    MmlInterpreter mml("T200 O6 L16 [A]2 O2 B");
+    parse(mml);
+    TEST_ASSERT_EQUAL(3, count);
+    assertNote(2, NOTE_B, 2, 4);
+    mml.rewind();
+    TEST_ASSERT_EQUAL(0, mml.tempo());
+    setUp();
+    parse(mml);
+    TEST_ASSERT_EQUAL(3, count);
+    assertNote(0, NOTE_A, 6, 4);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_notes);
+    RUN_TEST(test_triplets_without_drift);
+    RUN_TEST(test_tempo_and_volume);
+    RUN_TEST(test_loops);
+    RUN_TEST(test_rewind);
+    return UNITY_END();
+}
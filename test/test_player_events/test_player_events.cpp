@@ -0,0 +1,197 @@
+/**
+ * Test         test_player_events.cpp
+ *
+ * Purpose      Host tests of the events of the BasicMelodyPlayer (pio test -e native):
+ *              the order of the callbacks, position and bar which are kept also
+ *              without callbacks, the completion of a repeated melody, a melody set
+ *              while a note sounds, which starts at once with its first note, beats 
+ *              which end a sounding note with its NOTE_OFF, and the 
+ *              PlayerEventQueue with a writer and a reader thread, where every 
+ *              event arrives intact and in order or is counted as lost.
+ */
+#include <unity.h>
+#include <thread>
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "NullOutput.h"
+#include "RecordingOutput.h"
+
+typedef BasicMelodyPlayer<VirtualClock, NullOutput> Player;
+
+static musicNote melody[] =
+{
+    { NOTE_C, 4, N_LEN::N2 }, { NOTE_D, 4, N_LEN::N2 }, { REST, 4, N_LEN::N4 }, { NOTE_E, 4, N_LEN::N2d }
+};
+#define MELODY_LEN (int)(sizeof(melody) / sizeof(melody[0]))
+
+static char trace[64];
+static int  traced;
+
+static void onEvent(const PlayerEvent &e, void *arg)
+{
+    static const char code[] = "+-|.";
+    if (traced < (int)sizeof(trace) - 1) trace[traced++] = code[(int)e.type];
+}
+
+/**
+ * Play ms of virtual time, polled once per ms
+ */
+static void run(Player &player, uint32_t ms, bool repeat = false)
+{
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        player.playMelody(repeat);
+        player.clock().advance(1);
+    }
+}
+
+void setUp()
+{
+    memset(trace, 0, sizeof(trace));
+    traced = 0;
+}
+
+void tearDown() {}
+
+void test_callback_order()
+{
+    Player player;
+    player.setTempo(120);   // a quarter is 500 ms
+    player.addCallback(onEvent);
+    player.setMelody(melody, MELODY_LEN);
+    run(player, 5000);
+    TEST_ASSERT_EQUAL_STRING("|+-+-|+-.", trace);   // the rest has no note events
+}
+
+void test_position_without_callbacks()
+{
+    Player player;
+    player.setTempo(120);
+    player.setMelody(melody, MELODY_LEN);
+    run(player, 1);
+    TEST_ASSERT_EQUAL(32, player.getPosition());
+    TEST_ASSERT_EQUAL(1, player.getBar());
+    run(player, 1000 + 10);          // the second half note has started
+    TEST_ASSERT_EQUAL(64, player.getPosition());
+    TEST_ASSERT_EQUAL(1, player.getBar());
+    run(player, 1000);               // the rest in the second bar
+    TEST_ASSERT_EQUAL(80, player.getPosition());
+    TEST_ASSERT_EQUAL(2, player.getBar());
+    run(player, 3000);
+    TEST_ASSERT_EQUAL(0, player.getPosition());  // the melody has ended
+}
+
+void test_repeated_completion()
+{
+    Player player;
+    player.setTempo(240);
+    Player::PlayHandle handle = player.play(melody, MELODY_LEN);
+    TEST_ASSERT_FALSE(handle.isDone());
+    run(player, 3000, true);
+    TEST_ASSERT_TRUE(handle.isDone());
+    Player::PlayHandle again = player.play(melody, MELODY_LEN);
+    TEST_ASSERT_FALSE(again.isDone());
+    run(player, 3000, true);
+    TEST_ASSERT_TRUE(again.isDone());   // also a second time without callbacks
+}
+
+void test_set_melody_while_a_note_sounds()
+{
+    static musicNote whole[] = { { NOTE_C, 4, N_LEN::N1 } };
+    static musicNote other[] = { { NOTE_E, 5, N_LEN::N4 }, { NOTE_G, 5, N_LEN::N4 } };
+    BasicMelodyPlayer<VirtualClock, RecordingOutput<16>> player;
+    player.setTempo(120);
+    player.setMelody(whole, 1);
+    for (int i = 0; i < 500; i++) { player.playMelody(true); player.clock().advance(1); }
+    player.setMelody(other, 2);     // in the middle of the whole note
+    player.playMelody(true);
+    RecordingOutput<16> &out = player.output();
+    TEST_ASSERT_EQUAL(3, out.size());
+    TEST_ASSERT_FALSE(out[1].on);   // C4 is stopped at once
+    TEST_ASSERT_EQUAL(500, out[1].ms - out[0].ms);
+    TEST_ASSERT_TRUE(out[2].on);    // and the first note of the new melody starts
+    TEST_ASSERT_EQUAL(NOTE_E, out[2].note);
+    TEST_ASSERT_EQUAL(out[1].ms, out[2].ms);
+}
+
+void test_beats_end_the_sounding_note()
+{
+    static musicNote whole[] = { { NOTE_C, 4, N_LEN::N1 }, { NOTE_D, 4, N_LEN::N1 } };
+    BasicMelodyPlayer<VirtualClock, RecordingOutput<16>> player;
+    player.setTempo(120);
+    player.addCallback(onEvent);
+    player.play(whole, 2);
+    for (int i = 0; i < 300; i++) { player.playMelody(false); player.clock().advance(1); }
+    auto beats = player.beats(2);
+    TEST_ASSERT_FALSE(beats.poll());
+    RecordingOutput<16> &out = player.output();
+    TEST_ASSERT_EQUAL(3, out.size());
+    TEST_ASSERT_FALSE(out[1].on);                   // C4 is turned off
+    TEST_ASSERT_EQUAL(300, out[1].ms - out[0].ms);
+    TEST_ASSERT_EQUAL(NOTE_A, out[2].note);         // and the beat starts at once
+    TEST_ASSERT_EQUAL_STRING("|+-", trace);         // with its NOTE_OFF
+    while (! beats.poll()) player.clock().advance(1);
+    player.playMelody(false);                       // the melody continues with D4
+    TEST_ASSERT_EQUAL(NOTE_D, out[out.size() - 1].note);
+}
+
+void test_queue_two_threads()
+{
+    static PlayerEventQueue queue;
+    const uint32_t count = 200000;
+    uint32_t received = 0, expected = 0, dropped = 0;
+    bool ordered = true;
+    std::atomic<bool> written { false };
+
+    std::thread writer([&]()
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            PlayerEvent e = { PLAYER_EVENT::NOTE_ON, { (note_t)(i % 12), (uint8_t)(i % 9), N_LEN::N4 }, i, (uint16_t)i };
+            // most events wait for a free place, every 16th is dropped when the queue is full
+            while (! queue.put(e))
+            {
+                if (i % 16 == 0) { dropped++; break; }
+                std::this_thread::yield();
+            }
+        }
+        written = true;
+    });
+    std::thread reader([&]()
+    {
+        PlayerEvent e;
+        for (;;)
+        {
+            bool last = written;
+            if (! queue.get(e))
+            {
+                if (last) break;   // nothing left after the writer has finished
+                std::this_thread::yield();
+                continue;
+            }
+            // an event is either taken or lost, never torn or out of order
+            if (e.ms < expected || e.bar != (uint16_t)e.ms || e.note.note != (note_t)(e.ms % 12) 
+                || e.note.octave != e.ms % 9) ordered = false;
+            expected = e.ms + 1;
+            received++;
+        }
+    });
+    writer.join();
+    reader.join();
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL(count, received + dropped);
+    TEST_ASSERT_GREATER_OR_EQUAL(dropped, queue.lost());   // every failed put is counted
+    printf("queue: %u events received, %u dropped\n", received, dropped);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_callback_order);
+    RUN_TEST(test_position_without_callbacks);
+    RUN_TEST(test_repeated_completion);
+    RUN_TEST(test_set_melody_while_a_note_sounds);
+    RUN_TEST(test_beats_end_the_sounding_note);
+    RUN_TEST(test_queue_two_threads);
+    return UNITY_END();
+}
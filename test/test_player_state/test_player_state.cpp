@@ -0,0 +1,131 @@
+/**
+ * Test         test_player_state.cpp
+ *
+ * Purpose      Host tests of saveState() and restoreState() (pio test -e native):
+ *              a player saves its state in the middle of a note, a second player
+ *              restores it and must continue with the same position and bar and,
+ *              in random mode, play the same notes as the first one, also in
+ *              a note of more than 255 64ths.
+ */
+#include <unity.h>
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "RecordingOutput.h"
+
+#define EVENTS 256
+
+typedef BasicMelodyPlayer<VirtualClock, RecordingOutput<EVENTS>> Player;
+
+static musicNote melody[] =
+{
+    { NOTE_C, 4, N_LEN::N8 }, { NOTE_E, 4, N_LEN::N8 }, { NOTE_G, 4, N_LEN::N4 }, { REST, 4, N_LEN::N16 },
+    { NOTE_A, 4, N_LEN::N8d }, { NOTE_F, 4, N_LEN::N16 }, { NOTE_D, 5, N_LEN::N4 }, { NOTE_B, 3, N_LEN::N2 }
+};
+#define MELODY_LEN (int)(sizeof(melody) / sizeof(melody[0]))
+
+void setUp() {}
+void tearDown() {}
+
+static void prepare(Player &player)
+{
+    player.clock().set(1000);
+    player.setMelody(melody, MELODY_LEN);
+    player.setBarLength(64);
+}
+
+/**
+ * Poll the player once per ms for ms milliseconds
+ */
+static void play(Player &player, uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        player.playMelody(true);
+        player.clock().advance(1);
+    }
+}
+
+/**
+ * Save the first player after saveMs, restore the state into the second one at the
+ * same time and play both on for ms, they must play the same notes
+ */
+static void saveRestoreAndCompare(Player &first, Player &second, uint32_t saveMs, uint32_t ms)
+{
+    PlayerState state;
+    play(first, saveMs);
+    first.saveState(state, 7);
+    first.output().clear();
+
+    second.clock().set(first.clock().millis());
+    TEST_ASSERT_TRUE(second.restoreState(state));
+    TEST_ASSERT_EQUAL(first.getPosition(), second.getPosition());
+    TEST_ASSERT_EQUAL(first.getBar(), second.getBar());
+    TEST_ASSERT_EQUAL(first.getPlayPosition(), second.getPlayPosition());
+
+    second.output().clear();
+    play(first, ms);
+    play(second, ms);
+    TEST_ASSERT_EQUAL(first.output().size(), second.output().size());
+    TEST_ASSERT_GREATER_THAN(10, (int)first.output().size());
+    for (size_t i = 0; i < first.output().size(); i++)
+    {
+        TEST_ASSERT_EQUAL(first.output()[i].ms,   second.output()[i].ms);
+        TEST_ASSERT_EQUAL(first.output()[i].note, second.output()[i].note);
+    }
+    TEST_ASSERT_EQUAL(first.getPosition(), second.getPosition());
+    TEST_ASSERT_EQUAL(first.getBar(), second.getBar());
+}
+
+void test_position_and_bar_are_restored()
+{
+    Player first, second;
+    prepare(first);
+    prepare(second);
+    saveRestoreAndCompare(first, second, 3210, 5000);   // in the second pass of the melody
+    TEST_ASSERT_GREATER_THAN(0, (int)second.getBar());
+}
+
+void test_random_mode_continues_with_the_same_notes()
+{
+    Player first, second;
+    prepare(first);
+    prepare(second);
+    first.clock().setSeed(12345);
+    first.setRandomMode();
+    saveRestoreAndCompare(first, second, 2345, 8000);
+}
+
+void test_note_longer_than_255_64ths_is_restored()
+{
+    static musicNote tied[] = { { NOTE_C, 4, N_LEN::N4 }, { NOTE_E, 4, (N_LEN)256 }, { NOTE_G, 4, N_LEN::N4 } };
+    Player first, second;
+    for (Player *player : { &first, &second })
+    {
+        player->clock().set(1000);
+        player->setMelody(tied, 3);
+        player->setBarLength(64);
+    }
+    saveRestoreAndCompare(first, second, 2000, 40000);  // in the middle of the E
+}
+
+void test_invalid_state_is_rejected()
+{
+    Player first, second;
+    PlayerState state;
+    prepare(first);
+    prepare(second);
+    play(first, 500);
+    first.saveState(state, 7);
+    invalidateState(state);
+    TEST_ASSERT_FALSE(second.restoreState(state));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_position_and_bar_are_restored);
+    RUN_TEST(test_random_mode_continues_with_the_same_notes);
+    RUN_TEST(test_note_longer_than_255_64ths_is_restored);
+    RUN_TEST(test_invalid_state_is_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,76 @@
+/**
+ * Test         test_player_trace.cpp
+ *
+ * Purpose      Host test of the PlayerTrace (pio test -e native): a melody played
+ *              with the VirtualClock is traced with its time stamps, save() writes
+ *              the trace and scripts/trace_to_chrome.py converts the file into
+ *              Chrome trace JSON with a slice per note.
+ */
+#define PLAYER_TRACE
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "NullOutput.h"
+
+#define TRACE_FILE "test_player_trace.bin"
+#define JSON_FILE  "test_player_trace.json"
+
+typedef BasicMelodyPlayer<VirtualClock, NullOutput> Player;
+
+static musicNote melody[] = { { NOTE_C, 4, N_LEN::N4 }, { REST, 4, N_LEN::N8 }, { NOTE_E, 4, N_LEN::N4 } };
+
+void setUp() { PlayerTrace::clear(); }
+
+void tearDown()
+{
+    remove(TRACE_FILE);
+    remove(JSON_FILE);
+}
+
+static std::string readFile(const char *path)
+{
+    std::string text;
+    char buf[256];
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) return text;
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), file)) > 0; ) text.append(buf, n);
+    fclose(file);
+    return text;
+}
+
+void test_saved_trace_is_converted()
+{
+    Player player;
+    player.setTempo(120);   // a quarter is 500 ms
+    player.clock().set(1000);
+    player.setMelody(melody, 3);
+    for (int i = 0; i < 2000; i++)
+    {
+        player.playMelody(false);
+        player.clock().advance(1);
+    }
+    TEST_ASSERT_EQUAL(6, (int)PlayerTrace::size());  // note on and off of each note
+    TEST_ASSERT_TRUE(PlayerTrace::save(TRACE_FILE));
+
+    std::string trace = readFile(TRACE_FILE);
+    TEST_ASSERT_EQUAL(16 + 6 * sizeof(TraceRecord), trace.size());
+    TEST_ASSERT_EQUAL_STRING("MPTR", trace.substr(0, 4).c_str());
+
+    int status = system("python3 scripts/trace_to_chrome.py " TRACE_FILE " " JSON_FILE);
+    if (status != 0) status = system("python scripts/trace_to_chrome.py " TRACE_FILE " " JSON_FILE);
+    TEST_ASSERT_EQUAL(0, status);
+    std::string json = readFile(JSON_FILE);
+    TEST_ASSERT_TRUE(json.find("\"name\": \"C4\", \"ph\": \"X\"") != std::string::npos);
+    TEST_ASSERT_TRUE(json.find("\"name\": \"E4\", \"ph\": \"X\"") != std::string::npos);
+    TEST_ASSERT_TRUE(json.find("\"ts\": 1000000, \"dur\": 501000") != std::string::npos);  // time of the VirtualClock
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_saved_trace_is_converted);
+    return UNITY_END();
+}
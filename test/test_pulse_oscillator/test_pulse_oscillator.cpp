@@ -0,0 +1,168 @@
+/**
+ * Test         test_pulse_oscillator.cpp
+ *
+ * Purpose      Host tests of the PolyBLEP PulseOscillator (pio test -e native):
+ *              the spectrum of a rendered high note, whose aliases must be well
+ *              below the ones of a naive pulse, and the render cost in cycles per
+ *              sample for DAC_VOICES voices at 32 kHz.
+ *
+ *              3520 Hz (NOTE_A, octave 7) at 32 kHz are exactly 352 periods in 3200
+ *              samples, so every harmonic and every alias falls on a bin of the DFT
+ *              and no window is needed.
+ */
+#include <unity.h>
+#include <math.h>
+#include <chrono>
+#include "PulseOscillator.h"
+
+#define RATE    32000
+#define SAMPLES 3200
+#define PERIODS 352                 // 3520 Hz
+#define INC     ((uint32_t)((uint64_t)PERIODS * 4294967296ULL / SAMPLES))
+
+static int32_t buffer[SAMPLES];
+
+void setUp() { memset(buffer, 0, sizeof(buffer)); }
+void tearDown() {}
+
+/**
+ * Power at DFT bin k
+ */
+static double power(const int32_t *x, int k)
+{
+    double re = 0, im = 0;
+    for (int n = 0; n < SAMPLES; n++)
+    {
+        re += x[n] * cos(2 * M_PI * k * n / SAMPLES);
+        im -= x[n] * sin(2 * M_PI * k * n / SAMPLES);
+    }
+    return re * re + im * im;
+}
+
+/**
+ * Power of the aliases relative to the fundamental in dB. The aliases are all
+ * bins up to half the sample rate which are not harmonics of the note 
+ */
+static double aliasDb(const int32_t *x)
+{
+    double fundamental = power(x, PERIODS), alias = 0;
+    for (int k = 32; k < SAMPLES / 2; k += 32)  // harmonics and aliases of 352 Hz steps fall on multiples of 32
+    {
+        if (k % PERIODS != 0) alias += power(x, k);
+    }
+    return 10 * log10(alias / fundamental);
+}
+
+static void renderNaive(int32_t *x, uint32_t width)
+{
+    uint32_t phase = 0;
+    int32_t  dc    = (int32_t)(width >> 16) - 32768;
+    for (int n = 0; n < SAMPLES; n++, phase += INC)
+    {
+        x[n] = ((phase < width ? 32767 : -32767) - dc) * 32767 >> 15;
+    }
+}
+
+void test_square_aliases_are_reduced()
+{
+    static int32_t naive[SAMPLES];
+    PulseOscillator osc;
+    osc.setIncrement(INC);
+    osc.setPulseWidth(50);
+    osc.setLevel(32767);
+    osc.render(buffer, SAMPLES);
+    renderNaive(naive, 0x80000000);
+
+    double blep = aliasDb(buffer), plain = aliasDb(naive);
+    printf("square 3520 Hz: aliases %.1f dB (naive %.1f dB)\n", blep, plain);
+    TEST_ASSERT_LESS_THAN_FLOAT(plain - 10.0, blep);
+    TEST_ASSERT_LESS_THAN_FLOAT(-20.0, blep);
+}
+
+void test_pulse_aliases_are_reduced()
+{
+    static int32_t naive[SAMPLES];
+    PulseOscillator osc;
+    osc.setIncrement(INC);
+    osc.setPulseWidth(25);
+    osc.setLevel(32767);
+    osc.render(buffer, SAMPLES);
+    renderNaive(naive, 25 * 42949673U);
+
+    double blep = aliasDb(buffer), plain = aliasDb(naive);
+    printf("pulse 25%% 3520 Hz: aliases %.1f dB (naive %.1f dB)\n", blep, plain);
+    TEST_ASSERT_LESS_THAN_FLOAT(plain - 10.0, blep);
+}
+
+void test_output_has_no_dc_and_stays_in_range()
+{
+    PulseOscillator osc;
+    osc.setIncrement(INC);
+    osc.setPulseWidth(25);
+    osc.setLevel(32767);
+    osc.render(buffer, SAMPLES);
+
+    int64_t sum = 0;
+    for (int n = 0; n < SAMPLES; n++)
+    {
+        TEST_ASSERT_INT_WITHIN(65536, 0, buffer[n]);
+        sum += buffer[n];
+    }
+    TEST_ASSERT_INT_WITHIN(200, 0, sum / SAMPLES);
+}
+
+void test_notes_above_nyquist_are_muted()
+{
+    PulseOscillator osc;
+    osc.setFrequency(17000, RATE);
+    osc.setLevel(32767);
+    TEST_ASSERT_FALSE(osc.isActive());
+    osc.render(buffer, 16);
+    for (int n = 0; n < 16; n++) TEST_ASSERT_EQUAL(0, buffer[n]);
+}
+
+static inline uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void test_benchmark_eight_voices()
+{
+    static const float hz[8] = { 220, 330, 440, 587, 880, 1319, 2637, 3520 };
+    PulseOscillator osc[8];
+    int32_t block[256];
+
+    for (int v = 0; v < 8; v++)
+    {
+        osc[v].setFrequency(hz[v], RATE);
+        osc[v].setPulseWidth(50);
+        osc[v].setLevel(32767 / 8);
+    }
+    auto     start = std::chrono::steady_clock::now();
+    uint64_t c0    = cycles();
+    for (int b = 0; b < RATE / 256; b++)  // one second of sound
+    {
+        memset(block, 0, sizeof(block));
+        for (int v = 0; v < 8; v++) osc[v].render(block, 256);
+    }
+    uint64_t c = cycles() - c0;
+    double   s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("8 voices at 32 kHz: %.1f host cycles (or ns) per voice and sample, %.2f%% of real time\n",
+           (double)c / (8.0 * RATE), 100 * s);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.0, s);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_square_aliases_are_reduced);
+    RUN_TEST(test_pulse_aliases_are_reduced);
+    RUN_TEST(test_output_has_no_dc_and_stays_in_range);
+    RUN_TEST(test_notes_above_nyquist_are_muted);
+    RUN_TEST(test_benchmark_eight_voices);
+    return UNITY_END();
+}
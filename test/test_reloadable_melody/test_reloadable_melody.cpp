@@ -0,0 +1,104 @@
+/**
+ * Test         test_reloadable_melody.cpp
+ *
+ * Purpose      Host tests of the ReloadableMelody (pio test -e native): poll() only
+ *              loads a changed file and a file which can't be parsed keeps the
+ *              melody which is pending. The new melody is swapped at the next bar
+ *              at the same time since the start, or at the next note where a rest
+ *              fills the gap up to the next note of the new melody.
+ */
+#include <unity.h>
+#include <stdio.h>
+#include "ReloadableMelody.h"
+#include "Songbook.h"
+
+#define PATH "test_reloadable_melody.abc"
+
+static MelodyArena arena;
+
+// no phrase dictionary, the files hold plain notes
+const SongbookPhrase songbookPhrases[] = { { nullptr, 0, 0 } };
+const int songbookPhraseCount = 0;
+
+static void writeFile(const char *text)
+{
+    FILE *file = fopen(PATH, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(text, file);
+    fclose(file);
+}
+
+static void assertNote(ReloadableMelody &melody, note_t note, int len)
+{
+    musicNote n;
+    TEST_ASSERT_TRUE(melody.nextNote(n));
+    TEST_ASSERT_EQUAL(note, n.note);
+    TEST_ASSERT_EQUAL(len, (int)n.value);
+}
+
+void setUp() {}
+void tearDown() { remove(PATH); }
+
+void test_poll()
+{
+    ReloadableMelody melody(arena);
+    writeFile("X:1\nL:1/4\nK:C\nCDEF|\n");
+    TEST_ASSERT_TRUE(melody.watch(PATH));
+    TEST_ASSERT_FALSE(melody.poll());             // unchanged
+    TEST_ASSERT_FALSE(melody.pending());
+
+    writeFile("X:1\nL:1/4\nK:C\nGABcd|\n");
+    TEST_ASSERT_TRUE(melody.poll());
+    TEST_ASSERT_TRUE(melody.pending());
+
+    writeFile("X:1\nK:C\n|\n");                   // no notes
+    TEST_ASSERT_FALSE(melody.poll());
+    TEST_ASSERT_TRUE(melody.pending());           // the melody before is still swapped in
+    TEST_ASSERT_EQUAL(2, (int)melody.stats().reloads);
+    TEST_ASSERT_EQUAL(1, (int)melody.stats().failed);
+
+    melody.rewind();
+    assertNote(melody, NOTE_G, 16);
+    TEST_ASSERT_EQUAL(2, (int)melody.stats().swaps);  // watch() takes the first at once
+}
+
+void test_swap_at_bar_keeps_time()
+{
+    ReloadableMelody melody(arena);
+    writeFile("X:1\nM:4/4\nL:1/4\nK:C\nCDEF|GABc|\n");
+    TEST_ASSERT_TRUE(melody.watch(PATH));
+    assertNote(melody, NOTE_C, 16);
+
+    writeFile("X:1\nM:4/4\nL:1/4\nK:C\nEFGA|Bcde|f4|\n");
+    TEST_ASSERT_TRUE(melody.poll());
+    assertNote(melody, NOTE_D, 16);               // the bar is played to its end
+    assertNote(melody, NOTE_E, 16);
+    assertNote(melody, NOTE_F, 16);
+    assertNote(melody, NOTE_B, 16);               // second bar of the new melody
+    TEST_ASSERT_FALSE(melody.pending());
+    assertNote(melody, NOTE_C, 16);
+}
+
+void test_rest_fills_the_gap()
+{
+    ReloadableMelody melody(arena);
+    melody.setSwapAt(SWAP_AT::NOTE);
+    writeFile("X:1\nL:1/8\nK:C\nCDEFGABc|\n");
+    TEST_ASSERT_TRUE(melody.watch(PATH));
+    assertNote(melody, NOTE_C, 8);
+
+    writeFile("X:1\nL:1/4\nK:C\nEFGA|\n");  // its E began before, a rest up to the F
+    TEST_ASSERT_TRUE(melody.poll());
+    assertNote(melody, REST, 8);
+    assertNote(melody, NOTE_F, 16);
+    assertNote(melody, NOTE_G, 16);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_poll);
+    RUN_TEST(test_swap_at_bar_keeps_time);
+    RUN_TEST(test_rest_fills_the_gap);
+    return UNITY_END();
+}
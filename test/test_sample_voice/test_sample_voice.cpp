@@ -0,0 +1,195 @@
+/**
+ * Test         test_sample_voice.cpp
+ *
+ * Purpose      Host tests of the SampleVoice decoders (pio test -e native): 8 bit
+ *              PCM, IMA ADPCM against a reference encoder, resampling, looping,
+ *              the end of a clip and an empty clip. The benchmark measures the decoder throughput
+ *              and the time to render one DMA buffer (DAC_BLOCK samples at 32 kHz).
+ */
+#include <unity.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "SampleVoice.h"
+#include "VolumeTaper.h"
+
+#define RATE  32000
+#define BLOCK 256
+
+static const int16_t imaStep[89] = 
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int8_t imaIndex[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/**
+ * Reference IMA ADPCM encoder, low nibble first, predictor and index start at 0
+ */
+static std::vector<uint8_t> encodeAdpcm(const std::vector<int16_t> &pcm)
+{
+    std::vector<uint8_t> out((pcm.size() + 1) / 2, 0);
+    int predictor = 0, index = 0;
+    for (size_t i = 0; i < pcm.size(); i++)
+    {
+        int step = imaStep[index], diff = pcm[i] - predictor, nibble = 0;
+        if (diff < 0) { nibble = 8; diff = -diff; }
+        int delta = step >> 3;
+        if (diff >= step)      { nibble |= 4; diff -= step; delta += step; }
+        if (diff >= step >> 1) { nibble |= 2; diff -= step >> 1; delta += step >> 1; }
+        if (diff >= step >> 2) { nibble |= 1; delta += step >> 2; }
+        predictor = constrain((nibble & 8) ? predictor - delta : predictor + delta, -32768, 32767);
+        index     = constrain(index + imaIndex[nibble & 7], 0, 88);
+        out[i / 2] |= (i & 1) ? nibble << 4 : nibble;
+    }
+    return out;
+}
+
+static std::vector<int16_t> sine(int n, float hz, uint32_t rate)
+{
+    std::vector<int16_t> pcm(n);
+    for (int i = 0; i < n; i++) pcm[i] = (int16_t)(16000 * sin(2 * M_PI * hz * i / rate));
+    return pcm;
+}
+
+/**
+ * Render n samples of the voice alone
+ */
+static std::vector<int32_t> render(SampleVoice &voice, int n, uint32_t rate = RATE)
+{
+    std::vector<int32_t> mix(n, 0);
+    for (int i = 0; i < n; i += BLOCK) voice.render(mix.data() + i, min(BLOCK, n - i), rate);
+    return mix;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_pcm8_plays_the_samples()
+{
+    static const uint8_t data[] = { 128, 255, 0, 192, 64 };
+    SampleClip  clip = { data, sizeof(data), RATE, SAMPLE_FORMAT::PCM8 };
+    SampleVoice voice;
+    voice.play(clip);
+    std::vector<int32_t> mix = render(voice, 8);
+
+    for (int i = 0; i < 5; i++) TEST_ASSERT_INT_WITHIN(1, ((int)data[i] - 128) << 8, mix[i]);
+    TEST_ASSERT_FALSE(voice.isPlaying());
+    for (int i = 5; i < 8; i++) TEST_ASSERT_EQUAL(0, mix[i]);
+}
+
+void test_adpcm_decodes_the_reference_encoding()
+{
+    std::vector<int16_t> pcm = sine(4000, 440, 8000);
+    std::vector<uint8_t> adpcm = encodeAdpcm(pcm);
+    SampleClip  clip = { adpcm.data(), (uint32_t)adpcm.size(), 8000, SAMPLE_FORMAT::IMA_ADPCM };
+    SampleVoice voice;
+    voice.play(clip);
+    std::vector<int32_t> mix = render(voice, 4000, 8000);
+
+    double err = 0, sig = 0;
+    for (int i = 400; i < 4000; i++)  // after the decoder has adapted its step
+    {
+        err += (double)(mix[i] - pcm[i]) * (mix[i] - pcm[i]);
+        sig += (double)pcm[i] * pcm[i];
+    }
+    double snr = 10 * log10(sig / err);
+    printf("IMA ADPCM 440 Hz at 8 kHz: SNR %.1f dB\n", snr);
+    TEST_ASSERT_GREATER_THAN_FLOAT(20.0, snr);
+}
+
+void test_clip_is_held_at_a_higher_output_rate()
+{
+    static const uint8_t data[] = { 138, 148, 158, 168 };
+    SampleClip  clip = { data, sizeof(data), 8000, SAMPLE_FORMAT::PCM8 };
+    SampleVoice voice;
+    voice.play(clip);
+    std::vector<int32_t> mix = render(voice, 16);
+
+    for (int i = 0; i < 16; i++) TEST_ASSERT_INT_WITHIN(1, ((int)data[i / 4] - 128) << 8, mix[i]);
+    TEST_ASSERT_FALSE(voice.isPlaying());
+}
+
+void test_looped_clip_restarts()
+{
+    static const uint8_t data[] = { 138, 148, 158 };
+    SampleClip  clip = { data, sizeof(data), RATE, SAMPLE_FORMAT::PCM8 };
+    SampleVoice voice;
+    voice.play(clip, 100, true);
+    std::vector<int32_t> mix = render(voice, 9);
+
+    for (int i = 0; i < 9; i++) TEST_ASSERT_INT_WITHIN(1, ((int)data[i % 3] - 128) << 8, mix[i]);
+    TEST_ASSERT_TRUE(voice.isPlaying());
+    voice.stop();
+    TEST_ASSERT_FALSE(voice.isPlaying());
+}
+
+void test_empty_clip_is_not_played()
+{
+    static const uint8_t data[] = { 255 };
+    SampleClip  clip  = { data, sizeof(data), RATE, SAMPLE_FORMAT::PCM8 };
+    SampleClip  empty = { nullptr, 0, RATE, SAMPLE_FORMAT::IMA_ADPCM };
+    SampleVoice voice;
+    voice.play(clip, 100, true);
+    voice.play(empty);
+    TEST_ASSERT_FALSE(voice.isPlaying());
+    TEST_ASSERT_EQUAL(0, render(voice, 4)[0]);
+}
+
+void test_volume_scales_the_clip()
+{
+    static const uint8_t data[] = { 255, 255 };
+    SampleClip  clip = { data, sizeof(data), RATE, SAMPLE_FORMAT::PCM8 };
+    SampleVoice loud, soft;
+    loud.play(clip, 100);
+    soft.play(clip, 50);
+    int32_t l = render(loud, 1)[0], s = render(soft, 1)[0];
+    TEST_ASSERT_GREATER_THAN(0, s);
+    TEST_ASSERT_INT_WITHIN(2, (int32_t)((int64_t)l * volumeTaper[50] / 65535), s);  // the taper of the notes, -25 dB
+}
+
+void test_benchmark_decoder_and_block()
+{
+    std::vector<int16_t> pcm = sine(RATE * 4, 440, RATE);
+    std::vector<uint8_t> adpcm = encodeAdpcm(pcm);
+    std::vector<uint8_t> pcm8(pcm.size());
+    for (size_t i = 0; i < pcm.size(); i++) pcm8[i] = (uint8_t)((pcm[i] >> 8) + 128);
+    SampleClip clips[2] = { { pcm8.data(), (uint32_t)pcm8.size(), RATE, SAMPLE_FORMAT::PCM8 },
+                            { adpcm.data(), (uint32_t)adpcm.size(), RATE, SAMPLE_FORMAT::IMA_ADPCM } };
+    const char *names[2] = { "PCM8", "IMA ADPCM" };
+    int32_t block[BLOCK];
+
+    for (int c = 0; c < 2; c++)
+    {
+        SampleVoice voice;
+        voice.play(clips[c], 100, true);
+        int  blocks = (int)pcm.size() / BLOCK;
+        auto start  = std::chrono::steady_clock::now();
+        for (int b = 0; b < blocks; b++)
+        {
+            memset(block, 0, sizeof(block));
+            voice.render(block, BLOCK, RATE);
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%-9s: %.1f Msamples/s decoded, %.2f us per block of %d samples (%.1f ms of sound)\n",
+               names[c], pcm.size() / s / 1e6, s * 1e6 / blocks, BLOCK, 1000.0 * BLOCK / RATE);
+        TEST_ASSERT_LESS_THAN_FLOAT(4.0, s);  // faster than real time
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pcm8_plays_the_samples);
+    RUN_TEST(test_adpcm_decodes_the_reference_encoding);
+    RUN_TEST(test_clip_is_held_at_a_higher_output_rate);
+    RUN_TEST(test_looped_clip_restarts);
+    RUN_TEST(test_empty_clip_is_not_played);
+    RUN_TEST(test_volume_scales_the_clip);
+    RUN_TEST(test_benchmark_decoder_and_block);
+    return UNITY_END();
+}
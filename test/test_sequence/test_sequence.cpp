@@ -0,0 +1,189 @@
+/**
+ * Test         test_sequence.cpp
+ *
+ * Purpose      Host tests of the Sequence coroutines and the Sequencer (pio test -e native,
+ *              which compiles with -std=gnu++20): awaiting, nesting, running sequences
+ *              side by side, and the frame pool which must be empty again afterwards
+ *              and make start() fail when it is exhausted. Prints the frame sizes of
+ *              the sequence of the README and of a small loop and the time per resume.
+ */
+#include <unity.h>
+#include <chrono>
+#include "Sequence.h"
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "NullOutput.h"
+#if defined(__cpp_impl_coroutine)
+
+#define RESUMES 10000000
+
+typedef BasicMelodyPlayer<VirtualClock, NullOutput> Player;
+
+/**
+ * Awaitable which is done after it has been polled ticks times
+ */
+class Ticks
+{
+    public:
+        Ticks(int ticks) : _left(ticks) {};
+        bool poll() { return _left-- <= 0; };
+
+    private:
+        int _left;
+};
+
+static char trace[64];
+static int  traced;
+
+static void mark(char c) { if (traced < (int)sizeof(trace) - 1) trace[traced++] = c; }
+
+static Sequence inner(char c)
+{
+    mark(c);
+    co_await Ticks(2);
+    mark(c);
+}
+
+static Sequence outer(char c, int repeat)
+{
+    for (int i = 0; i < repeat; i++) co_await inner(c);
+    mark('.');
+}
+
+static bool flag;
+static bool flagSet(void *arg) { return *(bool *)arg; }
+
+static Sequence waitForFlag()
+{
+    co_await until(flagSet, &flag);
+    mark('!');
+}
+
+static musicNote intro[]  = { { NOTE_C, 4, N_LEN::N4 }, { NOTE_E, 4, N_LEN::N4 } };
+static musicNote chorus[] = { { NOTE_G, 4, N_LEN::N8 }, { NOTE_C, 5, N_LEN::N8 } };
+
+/**
+ * The sequence of the README
+ */
+static Sequence show(Player &player)
+{
+    co_await player.play(intro, 2);
+    co_await until(flagSet, &flag);
+    for (int i = 0; i < 3; i++) co_await player.play(chorus, 2);
+    co_await player.beats(4);
+}
+
+/**
+ * A small loop, each poll of the sequence resumes it once
+ */
+static Sequence spin(int n)
+{
+    for (int i = 0; i < n; i++) co_await Ticks(1);
+}
+
+void setUp()
+{
+    memset(trace, 0, sizeof(trace));
+    traced = 0;
+    flag   = false;
+}
+
+void tearDown() {}
+
+/**
+ * Run the sequencer until all sequences are done, returns the number of polls
+ */
+static int runAll(Sequencer &sequencer)
+{
+    int polls = 0;
+    while (sequencer.run() > 0 && polls < 1000) polls++;
+    return polls;
+}
+
+void test_frame_size_and_resume_time()   // runs first, largest() has seen no other frame
+{
+    Sequence loop = spin(RESUMES);
+    size_t loopFrame = SequenceFramePool::largest();
+    Player player;
+    Sequence sequence = show(player);
+    size_t showFrame = SequenceFramePool::largest();
+    TEST_ASSERT_TRUE(loop.valid() && sequence.valid());
+    TEST_ASSERT_GREATER_THAN(loopFrame, showFrame);
+
+    auto start = std::chrono::steady_clock::now();
+    int polls = 0;
+    while (! loop.poll()) polls++;
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL(RESUMES, polls);
+    printf("Sequence: frame %u bytes (README sequence), %u bytes (loop), %.1f ns per resume\n", 
+           (unsigned)showFrame, (unsigned)loopFrame, s * 1e9 / polls);
+}
+
+void test_nested()
+{
+    Sequencer sequencer;
+    TEST_ASSERT_TRUE(sequencer.start(outer('a', 2)));
+    TEST_ASSERT_EQUAL(0, traced);   // starts suspended
+    runAll(sequencer);
+    TEST_ASSERT_EQUAL_STRING("aaaa.", trace);
+    TEST_ASSERT_EQUAL(0, SequenceFramePool::inUse());
+}
+
+void test_side_by_side()
+{
+    Sequencer sequencer;
+    TEST_ASSERT_TRUE(sequencer.start(outer('a', 1)));
+    TEST_ASSERT_TRUE(sequencer.start(outer('b', 1)));
+    TEST_ASSERT_EQUAL(2, sequencer.running());
+    runAll(sequencer);
+    TEST_ASSERT_EQUAL_STRING("aba.b.", trace);   // polled in turn
+    TEST_ASSERT_EQUAL(0, SequenceFramePool::inUse());
+}
+
+void test_until()
+{
+    Sequencer sequencer;
+    TEST_ASSERT_TRUE(sequencer.start(waitForFlag()));
+    for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL(1, sequencer.run());
+    flag = true;
+    TEST_ASSERT_EQUAL(0, sequencer.run());
+    TEST_ASSERT_EQUAL_STRING("!", trace);
+}
+
+void test_pool_exhausted()
+{
+    Sequencer sequencer;
+    Sequence held[SEQUENCE_FRAMES - 1];
+    for (auto &s : held) s = outer('x', 1);
+    TEST_ASSERT_EQUAL(SEQUENCE_FRAMES - 1, SequenceFramePool::inUse());
+    uint32_t failed = SequenceFramePool::failed();
+    // the outer frame takes the last place, its inner sequence gets none and is empty
+    TEST_ASSERT_TRUE(sequencer.start(outer('y', 1)));
+    runAll(sequencer);
+    TEST_ASSERT_EQUAL(failed + 1, SequenceFramePool::failed());
+    TEST_ASSERT_EQUAL_STRING(".", trace);
+    TEST_ASSERT_TRUE(sequencer.start(outer('z', 1)));    // the last frame
+    TEST_ASSERT_FALSE(sequencer.start(outer('z', 1)));   // none left, the sequence is empty
+    sequencer.stop();
+    for (auto &s : held) s = Sequence();
+    TEST_ASSERT_EQUAL(0, SequenceFramePool::inUse());
+    TEST_ASSERT_LESS_OR_EQUAL(SEQUENCE_FRAME_SIZE, SequenceFramePool::largest());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_size_and_resume_time);
+    RUN_TEST(test_nested);
+    RUN_TEST(test_side_by_side);
+    RUN_TEST(test_until);
+    RUN_TEST(test_pool_exhausted);
+    return UNITY_END();
+}
+#else
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();  // needs -std=gnu++20
+    return UNITY_END();
+}
+#endif
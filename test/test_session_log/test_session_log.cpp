@@ -0,0 +1,149 @@
+/**
+ * Test         test_session_log.cpp
+ *
+ * Purpose      Host tests of the SessionLog (pio test -e native): a session played
+ *              in random mode with tempo and volume changes is recorded with the
+ *              RecordingClock, replayed with the ReplayClock, and both must play
+ *              exactly the same notes at the same times. Also the log survives a
+ *              file round trip and a loop polling once per ms needs few bytes.
+ */
+#include <unity.h>
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "RecordingOutput.h"
+#include "SessionLog.h"
+
+#define EVENTS 512
+#define STEPS  20000    // ms of the session
+
+typedef BasicMelodyPlayer<RecordingClock<VirtualClock>, RecordingOutput<EVENTS>> Recorder;
+typedef BasicMelodyPlayer<ReplayClock, RecordingOutput<EVENTS>> Replayer;
+
+static musicNote melody[] =
+{
+    { NOTE_C, 4, N_LEN::N8 }, { NOTE_E, 4, N_LEN::N8 }, { NOTE_G, 4, N_LEN::N4 }, { REST, 4, N_LEN::N16 },
+    { NOTE_A, 4, N_LEN::N8d }, { NOTE_F, 4, N_LEN::N16 }, { NOTE_D, 5, N_LEN::N4 }, { NOTE_B, 3, N_LEN::N2 }
+};
+#define MELODY_LEN (int)(sizeof(melody) / sizeof(melody[0]))
+
+static SessionLog session;
+static Recorder   recorder;
+static Replayer   replayer;
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * Play STEPS ms polling once per ms, with API calls at some steps which are logged
+ */
+static void record(uint32_t seed)
+{
+    recorder.output().clear();
+    recorder.clock().base().set(12345);
+    recorder.clock().record(&session, seed);
+    recorder.setMelody(melody, MELODY_LEN);
+    recorder.setRandomMode();
+    session.call(SESSION_CALL::RANDOM_MODE, 1);
+    for (uint32_t step = 0; step < STEPS; step++)
+    {
+        if (step == 5000)  { recorder.setTempo(180); session.call(SESSION_CALL::TEMPO, 180); }
+        if (step == 9000)  { recorder.setVolume(30); session.call(SESSION_CALL::VOLUME, 30); }
+        if (step == 14000) { recorder.setNormalMode(); session.call(SESSION_CALL::RANDOM_MODE, 0); }
+        recorder.playMelody(true);
+        recorder.clock().base().advance(1);
+    }
+    recorder.clock().record(nullptr);
+}
+
+/**
+ * Replay the log as shown in README
+ */
+static void replay()
+{
+    replayer.output().clear();
+    replayer.setMelody(melody, MELODY_LEN);
+    replayer.clock().replay(&session);
+    while (! replayer.clock().end())
+    {
+        SessionEntry entry;
+        while (replayer.clock().input(entry))
+        {
+            if (entry.type == SESSION_ENTRY::CALL) TEST_ASSERT_TRUE(replayCall(replayer, entry));
+        }
+        replayer.playMelody(true);
+    }
+}
+
+static void assertSamePlay()
+{
+    RecordingOutput<EVENTS> &a = recorder.output(), &b = replayer.output();
+    TEST_ASSERT_EQUAL(0, a.lost());
+    TEST_ASSERT_GREATER_THAN(100, a.size());
+    TEST_ASSERT_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(a[i].ms, b[i].ms);
+        TEST_ASSERT_EQUAL(a[i].note, b[i].note);
+        TEST_ASSERT_EQUAL(a[i].octave, b[i].octave);
+        TEST_ASSERT_EQUAL(a[i].on, b[i].on);
+    }
+    TEST_ASSERT_EQUAL(a.volume(), b.volume());
+    TEST_ASSERT_EQUAL(recorder.getTempo(), replayer.getTempo());
+    TEST_ASSERT_EQUAL(0, replayer.clock().diverged());
+}
+
+void test_record_replay()
+{
+    record(0xC0FFEE);
+    TEST_ASSERT_FALSE(session.full());
+    replay();
+    assertSamePlay();
+}
+
+void test_other_seed_plays_other_notes()
+{
+    record(1);
+    RecordingOutput<EVENTS> first = recorder.output();
+    record(2);
+    size_t n = min(first.size(), recorder.output().size()), same = 0;
+    for (size_t i = 0; i < n; i++) same += (first[i].note == recorder.output()[i].note);
+    TEST_ASSERT_LESS_THAN(n, same);
+}
+
+void test_file_round_trip()
+{
+    record(42);
+    size_t size = session.size();
+    TEST_ASSERT_TRUE(session.save("session_test.bin"));
+    static SessionLog loaded;
+    TEST_ASSERT_TRUE(loaded.load("session_test.bin"));
+    remove("session_test.bin");
+    TEST_ASSERT_EQUAL(size, loaded.size());
+    TEST_ASSERT_EQUAL(0, memcmp(session.data(), loaded.data(), size));
+    TEST_ASSERT_EQUAL(42, loaded.seed());
+    TEST_ASSERT_FALSE(loaded.load(session.data() + 1, size - 1));  // not a session
+}
+
+void test_runs_are_compact()
+{
+    SessionLog runs;
+    runs.start(1, 0);
+    for (uint32_t ms = 1; ms <= 60000; ms++) runs.sample(ms);   // a minute polled once per ms
+    TEST_ASSERT_LESS_THAN(20, runs.size());
+    runs.rewind();
+    SessionEntry entry;
+    uint32_t samples = 0, last = 0;
+    while (runs.next(entry)) { samples++; last = entry.ms; }
+    TEST_ASSERT_EQUAL(60000, samples);
+    TEST_ASSERT_EQUAL(60000, last);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_record_replay);
+    RUN_TEST(test_other_seed_plays_other_notes);
+    RUN_TEST(test_file_round_trip);
+    RUN_TEST(test_runs_are_compact);
+    return UNITY_END();
+}
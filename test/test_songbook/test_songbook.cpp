@@ -0,0 +1,150 @@
+/**
+ * Test         test_songbook.cpp
+ *
+ * Purpose      Host tests of PackedMelody and of the metadata of the songbook
+ *              (pio test -e native) with a small hand-made songbook: phrase 
+ *              references are followed, nested and out of range ones skipped,
+ *              seek() continues with the same note as playing up to it, and
+ *              packedInfo() computes notes, duration and pitch range at compile time.
+ *              melodyMs() must match the time the player takes for the melody.
+ */
+#include <unity.h>
+#include "Songbook.h"
+#include "BasicMelodyPlayer.h"
+#include "Clocks.h"
+#include "RecordingOutput.h"
+
+static constexpr uint16_t phrase_0[] = { 0x0844, 0x0845 };          // E4 F4 eighths
+static constexpr uint16_t phrase_1[] = { PACKED_PHRASE | 0 << 4, 0x1047 };  // phrase 0, G4 quarter
+static constexpr SongbookPhrase phraseTable[] =
+{
+    { phrase_0, 2, 2 },
+    { phrase_1, 2, 3 },
+};
+
+// C4 quarter, phrase 1, quarter rest, phrase 1, a reference behind the dictionary, D4 half
+static constexpr uint16_t mel_test[] = { 0x1040, PACKED_PHRASE | 1 << 4, 0x104C, PACKED_PHRASE | 1 << 4,
+                                         PACKED_PHRASE | 9 << 4, 0x2042 };
+static constexpr MelodyInfo mel_test_info = packedInfo(mel_test, 0, 6, phraseTable, 2);
+
+static_assert(mel_test_info.notes == 9, "notes with the phrases");
+static_assert(mel_test_info.length64 == 128, "two whole notes");
+static_assert(pitchRange(mel_test_info) == 7, "C4 to G4");
+
+const SongbookPhrase songbookPhrases[] = { phraseTable[0], phraseTable[1] };
+const int songbookPhraseCount = 2;
+const SongbookEntry songbook[] =
+{
+    { "Test", mel_test, 6, 120, &mel_test_info },
+    { nullptr, nullptr, 0, 0, nullptr }
+};
+const int songbookSize = 1;
+
+static const musicNote expected[] =
+{
+    { NOTE_C, 4, N_LEN::N4 }, { NOTE_E, 4, N_LEN::N8 }, { NOTE_F, 4, N_LEN::N8 }, { NOTE_G, 4, N_LEN::N4 },
+    { REST, 4, N_LEN::N4 },   { NOTE_E, 4, N_LEN::N8 }, { NOTE_F, 4, N_LEN::N8 }, { NOTE_G, 4, N_LEN::N4 },
+    { NOTE_D, 4, N_LEN::N2 }
+};
+#define EXPECTED (int)(sizeof(expected) / sizeof(expected[0]))
+
+void setUp() {}
+void tearDown() {}
+
+static void assertNote(const musicNote &e, const musicNote &n)
+{
+    TEST_ASSERT_EQUAL(e.note, n.note);
+    TEST_ASSERT_EQUAL(e.octave, n.octave);
+    TEST_ASSERT_EQUAL((int)e.value, (int)n.value);
+}
+
+void test_phrases_are_expanded()
+{
+    PackedMelody melody(songbook[0]);
+    musicNote n;
+    for (int i = 0; i < EXPECTED; i++)
+    {
+        TEST_ASSERT_EQUAL(i, melody.position());
+        TEST_ASSERT_TRUE(melody.nextNote(n));
+        assertNote(expected[i], n);
+    }
+    TEST_ASSERT_FALSE(melody.nextNote(n));
+    melody.rewind();
+    TEST_ASSERT_TRUE(melody.nextNote(n));
+    assertNote(expected[0], n);
+}
+
+void test_seek()
+{
+    PackedMelody melody(songbook[0]);
+    musicNote n;
+    for (int i = 0; i < EXPECTED; i++)
+    {
+        TEST_ASSERT_TRUE(melody.seek(i));
+        TEST_ASSERT_EQUAL(i, melody.position());
+        TEST_ASSERT_TRUE(melody.nextNote(n));
+        assertNote(expected[i], n);
+    }
+    TEST_ASSERT_TRUE(melody.seek(EXPECTED));    // at the end
+    TEST_ASSERT_FALSE(melody.nextNote(n));
+    TEST_ASSERT_FALSE(melody.seek(EXPECTED + 1));
+    TEST_ASSERT_FALSE(melody.seek(-1));
+}
+
+void test_info()
+{
+    const MelodyInfo &info = *songbook[0].info;
+    TEST_ASSERT_EQUAL(1, info.rests);
+    TEST_ASSERT_EQUAL(16, info.rest64);
+    TEST_ASSERT_EQUAL(12, restPercent(info));
+    TEST_ASSERT_EQUAL(INFO_PITCH(NOTE_C, 4), info.lowest);
+    TEST_ASSERT_EQUAL(INFO_PITCH(NOTE_G, 4), info.highest);
+    TEST_ASSERT_EQUAL(4000 + 9 * 11, melodyMs(info, songbook[0].tempo));  // 8 quarters at 120, 9 gaps
+    TEST_ASSERT_EQUAL(4000 + 9 * 1, melodyMs(info, songbook[0].tempo, 0));
+
+    constexpr musicNote tune[] = { { NOTE_A, 4, N_LEN::N4 }, { REST, 4, N_LEN::N4 } };
+    constexpr MelodyInfo tuneInfo = melodyInfo(tune);
+    static_assert(tuneInfo.length64 == 32 && tuneInfo.rests == 1, "two quarters");
+    constexpr MelodyInfo none = melodyInfo(tune, 1, 2);
+    static_assert(pitchRange(none) == 0 && none.lowest == INFO_NO_PITCH, "only a rest");
+}
+
+/**
+ * Play the melody with the gap of msGap, the loop polls the player twice per ms 
+ * as the main loop does many times, so a note starts right after the gap
+ */
+static uint32_t playedMs(uint32_t msGap)
+{
+    BasicMelodyPlayer<VirtualClock, RecordingOutput<64>> player;
+    PackedMelody melody(songbook[0]);
+    player.clock().set(1000);
+    player.setLegato(msGap);
+    player.setMelody(melody);
+    for (int ms = 0; ms < 10000; ms++)
+    {
+        player.playMelody(false);
+        player.playMelody(false);
+        player.clock().advance(1);
+    }
+    RecordingOutput<64> &out = player.output();
+    TEST_ASSERT_EQUAL(2 * EXPECTED, out.size());
+    return out[out.size() - 1].ms + msGap - out[0].ms;  // up to the end of the last gap
+}
+
+void test_duration_as_played()
+{
+    const SongbookEntry &e = songbook[0];
+    TEST_ASSERT_EQUAL(melodyMs(*e.info, e.tempo), playedMs(10));
+    TEST_ASSERT_EQUAL(melodyMs(*e.info, e.tempo, 0), playedMs(0));
+    TEST_ASSERT_EQUAL(melodyMs(*e.info, e.tempo, 40), playedMs(40));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_phrases_are_expanded);
+    RUN_TEST(test_seek);
+    RUN_TEST(test_info);
+    RUN_TEST(test_duration_as_played);
+    return UNITY_END();
+}
@@ -0,0 +1,153 @@
+/**
+ * Test         test_streamed_melody.cpp
+ *
+ * Purpose      Host tests of the StreamedMelody (pio test -e native) with a melody
+ *              file of NOTES numbered notes and a latency injected into every read.
+ *              The notes must come in order, each buffer read once, whether the
+ *              prefetch task reads ahead, the player reads itself or both call
+ *              refill() at the same time. close() and the destructor stop the
+ *              task in the middle of a slow read.
+ */
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "StreamedMelody.h"
+#include "Songbook.h"
+
+#define FILE_NAME "test_streamed_melody.mel"
+#define NOTES     200
+#define FILLS     ((NOTES + STREAM_BUFFER_NOTES - 1) / STREAM_BUFFER_NOTES)
+
+/**
+ * Note i of the file, all notes differ in a window of 256 notes
+ */
+static musicNote noteOf(int i)
+{
+    return { (note_t)(i % 12), (uint8_t)(i / 12 % 8), (N_LEN)(1 + i / 96) };
+}
+
+void setUp()
+{
+    FILE *f = fopen(FILE_NAME, "wb");
+    uint8_t header[STREAM_HEADER] = { 'M', 'P', 'K', 'M', 120, 0, NOTES & 0xFF, NOTES >> 8 };
+    fwrite(header, sizeof(header), 1, f);
+    for (int i = 0; i < NOTES; i++)
+    {
+        musicNote n = noteOf(i);
+        uint16_t p = PACK_NOTE(n);
+        uint8_t raw[2] = { (uint8_t)(p & 0xFF), (uint8_t)(p >> 8) };
+        fwrite(raw, 2, 1, f);
+    }
+    fclose(f);
+}
+
+void tearDown()
+{
+    remove(FILE_NAME);
+}
+
+/**
+ * Take all notes with usPerNote between them, also calling refill() when
+ * playerRefills, and check them
+ */
+static void playAndCheck(StreamedMelody &streamed, uint32_t usPerNote, bool playerRefills)
+{
+    musicNote n;
+    for (int i = 0; i < NOTES; i++)
+    {
+        TEST_ASSERT_TRUE(streamed.nextNote(n));
+        musicNote expected = noteOf(i);
+        TEST_ASSERT_EQUAL(expected.note, n.note);
+        TEST_ASSERT_EQUAL(expected.octave, n.octave);
+        TEST_ASSERT_EQUAL((int)expected.value, (int)n.value);
+        if (playerRefills) streamed.refill();
+        std::this_thread::sleep_for(std::chrono::microseconds(usPerNote));
+    }
+    TEST_ASSERT_FALSE(streamed.nextNote(n));
+    TEST_ASSERT_EQUAL(FILLS, streamed.stats().fills);
+    TEST_ASSERT_EQUAL(0, streamed.stats().errors);
+}
+
+void test_prefetch_reads_ahead_of_slow_reads()
+{
+    StreamedMelody streamed;
+    TEST_ASSERT_TRUE(streamed.open(FILE_NAME));
+    streamed.setReadLatency(5000);           // 5 ms per read, a buffer lasts 32 ms
+    TEST_ASSERT_TRUE(streamed.startPrefetch());
+    playAndCheck(streamed, 1000, false);
+    TEST_ASSERT_LESS_THAN(FILLS / 2, streamed.stats().underruns);
+}
+
+void test_player_reads_itself_without_prefetch()
+{
+    StreamedMelody streamed;
+    TEST_ASSERT_TRUE(streamed.open(FILE_NAME));
+    streamed.setReadLatency(2000);
+    playAndCheck(streamed, 0, false);
+    TEST_ASSERT_EQUAL(FILLS - 1, streamed.stats().underruns);  // all but the first, read by open()
+}
+
+void test_task_and_idle_refill_together()
+{
+    StreamedMelody streamed;
+    musicNote n;
+    std::atomic<bool> playing { true };
+    TEST_ASSERT_TRUE(streamed.open(FILE_NAME));
+    streamed.setReadLatency(3000);
+    TEST_ASSERT_TRUE(streamed.startPrefetch());
+    std::thread idle([&]()       // refill() in idle time besides the task
+    {
+        while (playing) if (! streamed.refill()) std::this_thread::yield();
+    });
+    while (streamed.nextNote(n));   // no read is going on when the stats are cleared
+    for (int i = 0; i < 5; i++)  // after a seek both buffers are EMPTY, both read at once
+    {
+        streamed.clearStats();
+        TEST_ASSERT_TRUE(streamed.seek(0));
+        playAndCheck(streamed, 100, true);  // each buffer is still read once
+    }
+    playing = false;
+    idle.join();
+}
+
+void test_close_stops_the_task_during_a_read()
+{
+    StreamedMelody streamed;
+    musicNote n;
+    TEST_ASSERT_TRUE(streamed.open(FILE_NAME));
+    streamed.setReadLatency(20000);
+    TEST_ASSERT_TRUE(streamed.startPrefetch());
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));  // the task reads the 2nd buffer
+    streamed.close();
+    TEST_ASSERT_FALSE(streamed.isOpen());
+    TEST_ASSERT_FALSE(streamed.nextNote(n));
+
+    streamed.clearStats();
+    TEST_ASSERT_TRUE(streamed.open(FILE_NAME));  // open and prefetch again
+    streamed.setReadLatency(1000);
+    TEST_ASSERT_TRUE(streamed.startPrefetch());
+    playAndCheck(streamed, 0, false);
+}
+
+void test_destructor_stops_the_task_during_a_read()
+{
+    {
+        StreamedMelody streamed;
+        TEST_ASSERT_TRUE(streamed.open(FILE_NAME));
+        streamed.setReadLatency(20000);
+        TEST_ASSERT_TRUE(streamed.startPrefetch());
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }   // the destructor must not leave the task reading into the freed object
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_prefetch_reads_ahead_of_slow_reads);
+    RUN_TEST(test_player_reads_itself_without_prefetch);
+    RUN_TEST(test_task_and_idle_refill_together);
+    RUN_TEST(test_close_stops_the_task_during_a_read);
+    RUN_TEST(test_destructor_stops_the_task_during_a_read);
+    return UNITY_END();
+}
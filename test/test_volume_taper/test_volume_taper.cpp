@@ -0,0 +1,79 @@
+/**
+ * Test         test_volume_taper.cpp
+ *
+ * Purpose      Host tests of the volume taper combined with the timbres (pio test -e native):
+ *              for every volume and timbre the duty cycle of the 10 bit ledc timer is
+ *              at least 1 above volume 0, never falls when the volume rises, keeps
+ *              the order of the timbres and is exact at full volume.
+ */
+#include <unity.h>
+#include "VolumeTaper.h"
+
+static const TIMBRE timbres[3] = { TIMBRE::PULSE_12, TIMBRE::PULSE_25, TIMBRE::PULSE_50 };
+
+void setUp() {}
+void tearDown() {}
+
+void test_silent_only_at_zero()
+{
+    for (TIMBRE t : timbres)
+    {
+        TEST_ASSERT_EQUAL(0, pulseDuty(pulseLevel(0, t), LEDC_NOTE_RESOLUTION));
+        for (uint32_t v = 1; v <= VOLUME_MAX; v++)
+        {
+            TEST_ASSERT_GREATER_OR_EQUAL(1, pulseDuty(pulseLevel(v, t), LEDC_NOTE_RESOLUTION));
+        }
+    }
+    // the cases which were silent before the floor
+    TEST_ASSERT_EQUAL(1, pulseDuty(pulseLevel(10, TIMBRE::PULSE_12), LEDC_NOTE_RESOLUTION));
+    TEST_ASSERT_EQUAL(1, pulseDuty(pulseLevel(1, TIMBRE::PULSE_12), 8));
+}
+
+void test_monotonic_and_ordered()
+{
+    for (uint8_t bits = 8; bits <= 16; bits++)
+    {
+        for (uint32_t v = 0; v <= VOLUME_MAX; v++)
+        {
+            uint32_t d12 = pulseDuty(pulseLevel(v, TIMBRE::PULSE_12), bits);
+            uint32_t d25 = pulseDuty(pulseLevel(v, TIMBRE::PULSE_25), bits);
+            uint32_t d50 = pulseDuty(pulseLevel(v, TIMBRE::PULSE_50), bits);
+            TEST_ASSERT_LESS_OR_EQUAL(d25, d12);
+            TEST_ASSERT_LESS_OR_EQUAL(d50, d25);
+            if (v > 0)
+            {
+                for (TIMBRE t : timbres)
+                {
+                    TEST_ASSERT_GREATER_OR_EQUAL(pulseDuty(pulseLevel(v - 1, t), bits), pulseDuty(pulseLevel(v, t), bits));
+                }
+            }
+        }
+    }
+}
+
+void test_full_volume()
+{
+    TEST_ASSERT_EQUAL(127, pulseDuty(pulseLevel(VOLUME_MAX, TIMBRE::PULSE_12), LEDC_NOTE_RESOLUTION));
+    TEST_ASSERT_EQUAL(255, pulseDuty(pulseLevel(VOLUME_MAX, TIMBRE::PULSE_25), LEDC_NOTE_RESOLUTION));
+    TEST_ASSERT_EQUAL(511, pulseDuty(pulseLevel(VOLUME_MAX, TIMBRE::PULSE_50), LEDC_NOTE_RESOLUTION));
+    TEST_ASSERT_EQUAL(pulseLevel(VOLUME_MAX, TIMBRE::PULSE_50), pulseLevel(VOLUME_MAX + 50, TIMBRE::PULSE_50));
+}
+
+void test_taper_steps()
+{
+    // 0.5 dB per step: 20 steps are 10 dB, a factor of 3.16
+    for (uint32_t v = 21; v <= VOLUME_MAX; v++)
+    {
+        TEST_ASSERT_INT_WITHIN(3 + volumeTaper[v] / 200, (int)(volumeTaper[v - 20] * 3.1623), (int)volumeTaper[v]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_silent_only_at_zero);
+    RUN_TEST(test_monotonic_and_ordered);
+    RUN_TEST(test_full_volume);
+    RUN_TEST(test_taper_steps);
+    return UNITY_END();
+}